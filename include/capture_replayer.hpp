@@ -0,0 +1,49 @@
+#pragma once
+
+#include "frame_capture.hpp"
+#include "inverter_data.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+enum class replay_speed {
+    RECORDED = 0,  // Frames are released at their recorded offsets
+    MAX            // As fast as decoding allows
+};
+
+struct ReplayStatistics {
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t responses = 0;         // Decoded into the register map
+    uint64_t exceptions = 0;        // Modbus exception responses, as the device sent them
+    uint64_t decryptFailures = 0;
+    uint64_t parseFailures = 0;
+    uint64_t unmatched = 0;         // Responses with no outstanding request
+    uint64_t bytes = 0;             // On-wire bytes of the replayed responses
+    std::chrono::microseconds elapsed{0};
+
+    // Failures that a correct capture never produces
+    bool hasRegressions() const;
+};
+
+// Feeds a capture written by FrameCaptureWriter back through the receive
+// path without a socket: the key exchange replies re-derive each
+// connection's session key, requests are decrypted to learn which
+// registers every response answers, and responses are decrypted, parsed
+// with SungrowTcpClient::parseReadResponse and decoded with the register map.
+class CaptureReplayer {
+public:
+    using ResponseHandler = std::function<void(const InverterData& data)>;
+
+    // Throws std::runtime_error if the file is not a capture
+    explicit CaptureReplayer(const std::string& path);
+
+    const FrameCapture& getCapture() const;
+
+    // onResponse sees the data decoded so far after every response
+    ReplayStatistics replay(replay_speed speed, const ResponseHandler& onResponse = {}) const;
+
+private:
+    FrameCapture _capture;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "register_map.hpp"
+#include "snapshot_publisher.hpp"
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <string_view>
+
+// One bit per numeric field, in register map order
+using FieldMask = std::bitset<RegisterMap::NUMERIC_FIELD_COUNT>;
+
+struct FieldChanges {
+    bool isKeyframe = false;  // Every field is set; exporters resend text fields too
+    FieldMask mask;
+};
+
+// Decides which fields an exporter should send for each new snapshot. A
+// field is sent when it has moved further than its deadband from the value
+// last sent, so slow drift is still reported once it adds up. Every field
+// is resent on a keyframe: the first update and then at a fixed interval,
+// so consumers that join late or drop a message recover.
+class ChangeDetector {
+public:
+    static constexpr std::chrono::seconds DEFAULT_KEYFRAME_INTERVAL{300};
+
+    // Deadbands start from the register map
+    explicit ChangeDetector(std::chrono::seconds keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+    std::chrono::seconds getKeyframeInterval() const;
+    double getDeadband(size_t fieldIndex) const;
+    // Throws std::invalid_argument for a name that is not a numeric field
+    void setDeadband(std::string_view fieldName, double deadband);
+
+    FieldChanges update(const InverterSnapshot& snapshot);
+
+private:
+    std::chrono::seconds _keyframeInterval;
+    std::array<double, RegisterMap::NUMERIC_FIELD_COUNT> _deadbands{};
+    std::array<double, RegisterMap::NUMERIC_FIELD_COUNT> _sentValues{};
+    bool _hasKeyframe = false;
+    std::chrono::system_clock::time_point _lastKeyframe;
+};
@@ -3,10 +3,60 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <span>
+#include <array>
+#include <stdexcept>
 #include <algorithm>
 
+enum class register_type {
+    U16 = 0,
+    S16,
+    U32,
+    UTF8
+};
+
+enum class simd_level {
+    SCALAR = 0,
+    SSE2,
+    AVX2
+};
+
+// Per-lane constants of ModbusDataConverter::decodeLanes, one lane per
+// numeric register field. Arrays rather than a struct per lane, so the SIMD
+// paths load them the same way as the raw values. Lanes past count pad
+// the arrays to whole vectors.
+struct LaneLayout {
+    static constexpr size_t MAX_LANES = 32;
+    
+    size_t count = 0;
+    std::array<uint32_t, MAX_LANES> sentinels{};
+    std::array<uint32_t, MAX_LANES> altSentinels{};  // S16 also reserves 0x7FFF
+    std::array<uint32_t, MAX_LANES> signBits{};  // Set on S16 lanes, whose word is two's complement
+    std::array<double, MAX_LANES> scales{};
+    
+    // Returns the index of the new lane
+    constexpr size_t addLane(register_type type, double scale) {
+        if (count == MAX_LANES || type == register_type::UTF8) {
+            throw std::invalid_argument("Lane layout is full or the register type is not numeric");
+        }
+        sentinels[count] = type == register_type::U32 ? 0xFFFFFFFF : 0xFFFF;
+        altSentinels[count] = type == register_type::S16 ? 0x7FFF : sentinels[count];
+        signBits[count] = type == register_type::S16 ? 0x8000 : 0;
+        scales[count] = scale;
+        return count++;
+    }
+};
+
 class ModbusDataConverter {
 public:
+    // Uses the widest instruction set the CPU supports
+    ModbusDataConverter();
+
+    simd_level getSimdLevel() const;
+    // Levels above the CPU's support are clamped
+    void setSimdLevel(simd_level level);
+
     uint16_t convertU16(uint16_t rawValue) const;
     uint32_t convertU32(uint16_t highWord, uint16_t lowWord) const;
     int16_t convertS16(uint16_t rawValue) const;
@@ -15,4 +65,30 @@ public:
     
     bool isInvalidU16(uint16_t value) const;
     bool isInvalidU32(uint16_t highWord, uint16_t lowWord) const;
-};
\ No newline at end of file
+    
+    // Decodes a whole big-endian response payload of one register type in
+    // a single pass: byte swap, U32 pairing, sentinel masking and scaling.
+    // Value i is written to values[i] (0.0 when invalid) and bit i of
+    // validity is set when it is not a sentinel. values needs
+    // getValueCount(...) slots and validity one bit per value. Returns the
+    // number of values; UTF8 is not a numeric type and decodes nothing.
+    size_t decodeBlock(std::span<const uint8_t> payload, register_type type, double scale,
+                       std::span<double> values, std::span<uint64_t> validity) const;
+    
+    // Decodes the raw values of a register layout in a single pass: sentinel
+    // masking, sign extension and scaling. raw[i] is lane i's register word,
+    // or high word << 16 | low word for U32. Both spans need
+    // LaneLayout::MAX_LANES slots; those past layout.count are scratch.
+    // Invalid lanes decode to 0.0. Returns the validity bitmap, bit i set
+    // when lane i is not a sentinel.
+    uint64_t decodeLanes(const LaneLayout& layout, std::span<const uint32_t> raw, std::span<double> values) const;
+    
+    static size_t getValueCount(size_t payloadSize, register_type type);
+    static simd_level getSupportedSimdLevel();
+    
+    // Byte-swaps count big-endian registers from payload into registers
+    static void swapWords(const uint8_t* payload, size_t count, uint16_t* registers);
+
+private:
+    simd_level _simdLevel;
+};
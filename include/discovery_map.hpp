@@ -0,0 +1,73 @@
+#pragma once
+
+#include "inverter_config.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What register_scanner learned about one unit. Ranges are sorted and
+// merged; registers outside both lists were never probed.
+struct DiscoveredDevice {
+    uint16_t deviceCode = 0;
+    std::string serialNumber;
+    std::vector<RegisterRange> readable;
+    std::vector<RegisterRange> illegal;  // Rejected with Illegal Data Address
+};
+
+// Register discovery results keyed by device code and serial number, kept
+// in a small binary file so the monitor can plan its reads around a unit's
+// firmware without probing it. Saving replaces the file atomically.
+class DiscoveryMap {
+public:
+    // False if the file is missing or is not a discovery map
+    bool load(const std::string& path);
+    // Throws std::runtime_error if the file cannot be written
+    void save(const std::string& path) const;
+
+    const std::vector<DiscoveredDevice>& getDevices() const;
+    // Null when the unit has not been scanned
+    const DiscoveredDevice* findDevice(uint16_t deviceCode, std::string_view serialNumber) const;
+
+    // Adds a scan result; within the address span it answered for it replaces
+    // what the map held, elsewhere earlier scans of the unit are kept
+    void mergeDevice(const DiscoveredDevice& device);
+
+private:
+    std::vector<DiscoveredDevice> _devices;
+};
+
+// What the monitor last knew about the unit at one endpoint: its identity and
+// the illegal ranges its read plan avoids
+struct CachedIdentity {
+    std::string host;
+    uint16_t port = 0;
+    uint8_t slaveId = 0;
+    uint16_t deviceCode = 0;
+    std::string serialNumber;
+    std::vector<RegisterRange> illegal;
+};
+
+// Identity cache keyed by endpoint, in the same binary layout as the
+// discovery map, so a restart can poll a known inverter without first
+// reading its identity. Entries are hints; the inverter revalidates them.
+class IdentityCache {
+public:
+    // False if the file is missing or is not an identity cache
+    bool load(const std::string& path);
+    // Throws std::runtime_error if the file cannot be written
+    void save(const std::string& path) const;
+
+    const CachedIdentity* findEndpoint(const std::string& host, uint16_t port, uint8_t slaveId) const;
+    void setEndpoint(const CachedIdentity& identity);
+
+    // Re-reads, updates and rewrites the file under a process-wide lock, so
+    // inverters polled on different threads can share one cache file
+    static void store(const std::string& path, const CachedIdentity& identity);
+
+private:
+    static std::mutex _storeMutex;
+
+    std::vector<CachedIdentity> _endpoints;
+};
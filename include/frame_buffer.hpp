@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Fixed-capacity byte ring used to reassemble frames from a TCP stream.
+// Storage is owned by the buffer so the receive path never allocates.
+class FrameBuffer {
+public:
+    static constexpr size_t CAPACITY = 4096;
+
+    size_t getSize() const;
+    size_t getFreeSpace() const;
+    bool isEmpty() const;
+
+    // Largest contiguous free region, to be handed to a socket read
+    std::span<uint8_t> getWritableSpan();
+    void commit(size_t count);
+
+    uint8_t peek(size_t offset) const;
+    void copyOut(uint8_t* destination, size_t count) const;
+    void consume(size_t count);
+    void clear();
+
+private:
+    std::array<uint8_t, CAPACITY> _storage{};
+    size_t _head = 0;
+    size_t _size = 0;
+};
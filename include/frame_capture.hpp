@@ -0,0 +1,54 @@
+#pragma once
+
+#include "trace.hpp"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+enum class capture_record {
+    CONNECTED = 0,  // A new TCP connection; its key exchange follows
+    TX,
+    RX
+};
+
+struct CaptureRecord {
+    capture_record type;
+    std::chrono::microseconds offset;  // Since the capture started
+    std::vector<uint8_t> bytes;        // On-wire frame, still encrypted
+};
+
+// A capture file read back into memory
+struct FrameCapture {
+    std::chrono::system_clock::time_point startTime;
+    std::vector<CaptureRecord> records;
+
+    // False if the file is missing or is not a capture; a record cut short
+    // by a crash ends the capture instead
+    bool load(const std::string& path);
+    std::chrono::microseconds getDuration() const;
+};
+
+// Appends every frame one client sends and receives, exactly as on the
+// wire, to a capture file with its time since the capture started. Frames
+// are written from the client's executor only, so there is no locking; give
+// each client its own writer.
+class FrameCaptureWriter {
+public:
+    // Throws std::runtime_error if the file cannot be created
+    explicit FrameCaptureWriter(const std::string& path);
+
+    void recordConnected();
+    void recordFrame(frame_direction direction, std::span<const uint8_t> frame);
+
+    uint64_t getRecordCount() const;
+
+private:
+    void _write(capture_record type, std::span<const uint8_t> bytes);
+
+    std::ofstream _output;
+    std::chrono::steady_clock::time_point _startTime;
+    uint64_t _records = 0;
+};
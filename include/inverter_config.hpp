@@ -8,9 +8,17 @@ struct InverterConfig {
     uint16_t port = 502;
     uint8_t slaveId = 1;
     uint16_t timeoutMs = 10000;
+    uint16_t connectProbeMs = 250;  // Initial key exchange probe deadline
     uint8_t retries = 3;
-    uint8_t scanIntervalSec = 30;
+    uint8_t scanIntervalSec = 30;      // Daily energy and status registers
+    uint8_t powerIntervalSec = 1;      // Instantaneous power registers
+    uint16_t totalsIntervalSec = 300;  // Lifetime energy totals
+    uint8_t pipelineWindow = 1;  // Requests kept in flight per connection
+    uint8_t readPlanMaxGap = 32;  // Unwanted registers read through to merge blocks
     uint8_t level = 1;
+    std::string discoveryPath;  // Map written by register_scanner --discovery; empty to learn at runtime
+    std::string identityCachePath;  // Model, serial and read plan of known endpoints; empty to always detect
+    std::string capturePath;  // Raw frame capture for offline replay; empty to capture nothing
 };
 
 namespace RegisterAddresses {
@@ -18,6 +26,8 @@ namespace RegisterAddresses {
     constexpr uint16_t DEVICE_TYPE_ADDR = 4999;
     constexpr uint16_t SERIAL_START_ADDR = 4989;
     constexpr uint16_t SERIAL_LENGTH = 10;
+    // Serial and device type are adjacent, so one read covers both
+    constexpr uint16_t IDENTITY_LENGTH = DEVICE_TYPE_ADDR - SERIAL_START_ADDR + 1;
     
     // Working register found by scanner
     constexpr uint16_t DAILY_POWER_YIELDS = 5003;  // Confirmed working
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct InverterData {
+    std::string deviceType = "Unknown";
+    std::string serialNumber = "Unknown";
+    std::string runState = "Unknown";
+    std::string timestamp;
+    
+    double dailyPowerYields = 0.0;
+    double totalPowerYields = 0.0;
+    
+    double dailyExportEnergy = 0.0;
+    double totalExportEnergy = 0.0;
+    double dailyImportEnergy = 0.0;
+    double totalImportEnergy = 0.0;
+    
+    double dailyDirectConsumption = 0.0;
+    double totalDirectConsumption = 0.0;
+    
+    double internalTemperature = 0.0;
+    double phaseAVoltage = 0.0;
+    uint32_t totalActivePower = 0;
+    std::string workState1 = "Unknown";
+    uint16_t workStateCode = 0;  // Raw register; workState1 is its name
+    uint16_t dailyRunningTime = 0;
+    
+    uint32_t exportToGrid = 0;
+    uint32_t importFromGrid = 0;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "frame_buffer.hpp"
+#include <utility>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// Register image served by the simulator. Addresses that were never set
+// answer with Illegal Data Address, like gaps on a real inverter.
+class SimulatedRegisterMap {
+public:
+    SimulatedRegisterMap();
+
+    void set(uint8_t functionCode, uint16_t address, uint16_t value);
+    void setU32(uint8_t functionCode, uint16_t address, uint32_t value);
+    void setString(uint8_t functionCode, uint16_t address, const std::string& text, uint16_t registerCount);
+    void setRange(uint8_t functionCode, uint16_t address, uint16_t count, uint16_t value);
+
+    // False if the function code is unsupported or any address is unset
+    bool read(uint8_t functionCode, uint16_t address, uint16_t count, uint16_t* values) const;
+    bool isSupported(uint8_t functionCode) const;
+
+    // Lines of "<input|holding> <address> <value>"; '#' starts a comment
+    bool loadFile(const std::string& path);
+
+    // SG8K-D image seeded from the values in power_status_table.cpp
+    static SimulatedRegisterMap createDefault();
+
+private:
+    static constexpr size_t ADDRESS_SPACE = 65536;
+
+    struct Table {
+        std::vector<uint16_t> values = std::vector<uint16_t>(ADDRESS_SPACE, 0);
+        std::vector<bool> isValid = std::vector<bool>(ADDRESS_SPACE, false);
+    };
+
+    Table* _getTable(uint8_t functionCode);
+    const Table* _getTable(uint8_t functionCode) const;
+
+    Table _holding;
+    Table _input;
+};
+
+// Loopback stand-in for a Sungrow WiNet-S dongle: answers the key
+// exchange, then serves FC 0x03/0x04 reads over AES-ECB framing. Each
+// connection runs on its own strand, so the acceptor's io_context can be
+// driven by as many threads as needed.
+class InverterSimulator {
+public:
+    InverterSimulator(boost::asio::io_context& ioContext, const std::string& bindAddress, uint16_t port,
+                      std::shared_ptr<const SimulatedRegisterMap> registers);
+
+    void start();
+    void stop();
+
+    // Actual listening port; differs from the requested one when it was 0
+    uint16_t getPort() const;
+
+    std::chrono::milliseconds getResponseDelay() const;
+    void setResponseDelay(std::chrono::milliseconds responseDelay);
+    bool isEncryptionEnabled() const;
+    void setEncryptionEnabled(bool isEnabled);
+
+    uint64_t getConnectionCount() const;
+    uint64_t getRequestCount() const;
+
+    // Fault injection for loopback tests; safe to call while sessions run.
+    // Request numbers count every request served, the key exchange
+    // included, the way getRequestCount does.
+    //
+    // Holds responses until count are queued, then sends them newest first
+    void setReorderWindow(size_t count);
+    // Writes responses in pieces of at most bytes, with a short pause after
+    // each, so clients see frames split across reads; 0 writes them whole
+    void setWriteChunkSize(size_t bytes);
+    // Never answers that request
+    void dropResponse(uint64_t requestNumber);
+    // Answers that request with an invalid crypto header, which no client
+    // can frame; only encrypted sessions are affected
+    void corruptResponse(uint64_t requestNumber);
+
+private:
+    friend class SimulatorSession;
+
+    enum class response_fault {
+        NONE,
+        DROP,
+        CORRUPT
+    };
+
+    void _acceptNext();
+    response_fault _takeResponseFault(uint64_t requestNumber);
+    size_t _getReorderWindow() const;
+    size_t _getWriteChunkSize() const;
+
+    boost::asio::io_context& _ioContext;
+    boost::asio::ip::tcp::acceptor _acceptor;
+    std::shared_ptr<const SimulatedRegisterMap> _registers;
+    std::chrono::milliseconds _responseDelay{0};
+    bool _isEncryptionEnabled = true;
+
+    std::atomic<uint64_t> _connectionCount{0};
+    std::atomic<uint64_t> _requestCount{0};
+
+    mutable std::mutex _faultMutex;
+    size_t _reorderWindow = 0;
+    size_t _writeChunkSize = 0;
+    std::set<uint64_t> _droppedResponses;
+    std::set<uint64_t> _corruptedResponses;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// HDR-style histogram of durations in nanoseconds. Buckets are linear
+// within each power of two, so every recorded value keeps about two
+// significant digits (under 1.6% error) from 1 ns to about 68 s, above
+// which values are clamped. Recording is a few shifts and an increment and
+// never allocates.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(std::chrono::nanoseconds value);
+    void merge(const LatencyHistogram& other);
+    void clear();
+
+    uint64_t getCount() const;
+    std::chrono::nanoseconds getMax() const;
+    // Smallest bucket value that at least percentile% of the samples do not exceed
+    std::chrono::nanoseconds getPercentile(double percentile) const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 6;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 36;
+    static constexpr uint64_t MAX_VALUE = (uint64_t{1} << (MAX_EXPONENT + 1)) - 1;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    static size_t _getBucketIndex(uint64_t value);
+    // Highest value that falls into the bucket
+    static uint64_t _getBucketValue(size_t index);
+
+    std::vector<uint32_t> _buckets;
+    uint64_t _count = 0;
+    uint64_t _max = 0;
+};
+
+// Where the time of one Modbus transaction goes
+enum class latency_phase {
+    ENCRYPT = 0,  // Building and encrypting the request
+    WRITE,        // Queued until the socket write carrying it completed
+    FIRST_BYTE,   // Written until the first byte of the response arrived
+    READ,         // First byte until the whole frame was buffered
+    DECRYPT,
+    PARSE,
+    TOTAL         // Built until parsed
+};
+
+constexpr size_t LATENCY_PHASE_COUNT = 7;
+
+std::string_view getLatencyPhaseName(latency_phase phase);
+
+using PhaseDurations = std::array<std::chrono::nanoseconds, LATENCY_PHASE_COUNT>;
+
+// One histogram per phase
+struct PhaseHistograms {
+    std::array<LatencyHistogram, LATENCY_PHASE_COUNT> phases;
+
+    void record(const PhaseDurations& durations);
+    const LatencyHistogram& get(latency_phase phase) const;
+};
+
+// Transaction latencies by function code and by register block, so scan
+// intervals can be set from the inverter's measured response times
+class LatencyStatistics {
+public:
+    // Function code, start address, register count
+    using BlockKey = std::tuple<uint8_t, uint16_t, uint16_t>;
+
+    void record(uint8_t functionCode, uint16_t address, uint16_t count, const PhaseDurations& durations);
+    void merge(const LatencyStatistics& other);
+
+    const std::map<uint8_t, PhaseHistograms>& getByFunctionCode() const;
+    const std::map<BlockKey, PhaseHistograms>& getByBlock() const;
+
+    // p50/p90/p99/max table in milliseconds
+    void print(std::ostream& output) const;
+
+private:
+    std::map<uint8_t, PhaseHistograms> _byFunctionCode;
+    std::map<BlockKey, PhaseHistograms> _byBlock;
+};
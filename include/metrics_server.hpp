@@ -0,0 +1,72 @@
+#pragma once
+
+#include "snapshot_publisher.hpp"
+#include "sungrow_client.hpp"
+#include <utility>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+// Serves the Prometheus text exposition of every inverter at /metrics over
+// HTTP/1.1 with keep-alive. The complete response, headers included, is
+// rendered once per update() into an immutable shared buffer; a request
+// only writes that buffer, so any number of scrapers cost one small write
+// each and never reach the inverters.
+//
+// Runs on the given executor. Destroy it only after the executor's
+// io_context has stopped running.
+class MetricsServer {
+public:
+    // Binds at once so a port clash is reported at startup; port 0 picks a free one
+    MetricsServer(boost::asio::any_io_executor executor, uint16_t port, const std::string& address = "0.0.0.0");
+
+    uint16_t getPort() const;
+
+    void start();
+    // Closes the listener and every connection. Waits for the strand, so
+    // call it while the executor is still running and never from its threads.
+    void stop();
+
+    // Thread-safe; copies the data and re-renders on the server's strand
+    void update(const std::string& deviceId, const InverterSnapshot& snapshot, const ClientStatistics& client);
+
+    uint64_t getRequestCount() const;
+    uint64_t getRenderCount() const;
+
+    // The exposition text for the given devices, keyed by device id
+    static std::string renderExposition(const std::map<std::string, std::pair<InverterSnapshot, ClientStatistics>>& devices);
+
+private:
+    using tcp = boost::asio::ip::tcp;
+
+    struct Connection {
+        explicit Connection(tcp::socket socket);
+
+        tcp::socket socket;
+        boost::asio::streambuf request;
+        boost::asio::steady_timer idleTimer;
+        std::shared_ptr<const std::string> response;  // Keeps the buffer alive during the write
+    };
+
+    static constexpr size_t MAX_REQUEST_SIZE = 8192;
+    static constexpr std::chrono::seconds IDLE_TIMEOUT{60};
+
+    void _accept();
+    void _readRequest(std::shared_ptr<Connection> connection);
+    void _handleRequest(std::shared_ptr<Connection> connection, size_t headerSize);
+    void _close(const std::shared_ptr<Connection>& connection);
+    void _render();
+
+    boost::asio::strand<boost::asio::any_io_executor> _strand;
+    tcp::acceptor _acceptor;
+    std::map<std::string, std::pair<InverterSnapshot, ClientStatistics>> _devices;
+    std::shared_ptr<const std::string> _metricsResponse;
+    std::set<std::shared_ptr<Connection>> _connections;
+
+    std::atomic<uint64_t> _requests{0};
+    std::atomic<uint64_t> _renders{0};
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "change_detector.hpp"
+#include "snapshot_publisher.hpp"
+#include <utility>
+#include <boost/asio.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct MqttConfig {
+    std::string host = "127.0.0.1";
+    uint16_t port = 1883;
+    std::string clientId = "sungrow-monitor";
+    std::string topicPrefix = "sungrow";
+    uint8_t qos = 0;            // 0 or 1
+    bool shouldRetain = true;   // Late subscribers get the last value at once
+    std::chrono::seconds keepAlive{60};
+    std::chrono::seconds keyframeInterval = ChangeDetector::DEFAULT_KEYFRAME_INTERVAL;
+};
+
+struct MqttStatistics {
+    bool isConnected = false;
+    uint64_t batches = 0;       // Writes, one per scrape that had changes
+    uint64_t messages = 0;      // PUBLISH packets sent
+    uint64_t acknowledged = 0;  // PUBACKs received at QoS 1
+    uint64_t coalesced = 0;     // Snapshots replaced by a newer one before they were sent
+    uint64_t reconnects = 0;
+};
+
+// Publishes inverter snapshots to an MQTT 3.1.1 broker, one retained topic
+// per field: <prefix>/<device>/<field name>, named from the register map.
+// The fields that changed in one scrape go out as a single write of
+// back-to-back PUBLISH packets.
+//
+// publish() only posts the snapshot to the publisher's strand, so the
+// polling loop never waits on the broker. While a write is outstanding,
+// the QoS 1 window is full or the broker is unreachable, each device keeps
+// only its newest snapshot; change detection runs when that snapshot is
+// finally sent, so nothing is lost but intermediate values. Every
+// (re)connection starts with a keyframe.
+//
+// Runs on the given executor. Destroy it only after the executor's
+// io_context has stopped running.
+class MqttPublisher {
+public:
+    MqttPublisher(boost::asio::any_io_executor executor, MqttConfig config);
+
+    const MqttConfig& getConfig() const;
+
+    // Connects in the background and keeps reconnecting until stop()
+    void start();
+    // Sends DISCONNECT and closes; pending snapshots are discarded. Waits
+    // for the strand, so call it while the executor is still running and
+    // never from the executor's own threads.
+    void stop();
+
+    // Thread-safe and never blocks. deviceId names the topics when the
+    // snapshot has no serial number yet.
+    void publish(const InverterSnapshot& snapshot, const std::string& deviceId);
+
+    MqttStatistics getStatistics() const;
+
+private:
+    using tcp = boost::asio::ip::tcp;
+
+    struct Device {
+        ChangeDetector detector;
+        InverterSnapshot pending;
+        bool hasPending = false;
+    };
+
+    static constexpr size_t MAX_IN_FLIGHT = 256;     // Unacknowledged QoS 1 packets
+    static constexpr size_t READ_CHUNK_SIZE = 256;
+    static constexpr std::chrono::seconds CONNECT_TIMEOUT{10};
+    static constexpr std::chrono::seconds MIN_RECONNECT_DELAY{1};
+    static constexpr std::chrono::seconds MAX_RECONNECT_DELAY{30};
+
+    void _connect();
+    void _scheduleReconnect();
+    void _closeConnection();
+    void _sendConnect();
+    void _readPackets();
+    void _handlePacket(uint8_t type, const uint8_t* body, size_t length);
+    void _scheduleKeepAlive();
+
+    void _enqueue(const InverterSnapshot& snapshot, const std::string& deviceId);
+    void _flush();
+    void _appendPublish(const std::string& topic, std::string_view payload);
+    void _appendBatch(const std::string& deviceId, Device& device, const FieldChanges& changes);
+    void _write();
+
+    boost::asio::strand<boost::asio::any_io_executor> _strand;
+    MqttConfig _config;
+    tcp::resolver _resolver;
+    tcp::socket _socket;
+    boost::asio::steady_timer _connectTimer;
+    boost::asio::steady_timer _retryTimer;
+    boost::asio::steady_timer _keepAliveTimer;
+    std::chrono::seconds _reconnectDelay = MIN_RECONNECT_DELAY;
+    uint64_t _connectionGeneration = 0;
+    bool _isRunning = false;
+    bool _isSessionOpen = false;  // CONNACK accepted
+    bool _hasConnected = false;
+
+    std::array<uint8_t, READ_CHUNK_SIZE> _readChunk{};
+    std::vector<uint8_t> _received;
+    std::vector<uint8_t> _txBuffer;   // Batch being built
+    std::vector<uint8_t> _txActive;   // Batch owned by async_write
+    bool _isWriting = false;
+    bool _hasWrittenSinceKeepAlive = false;
+    bool _hasReceivedSinceKeepAlive = false;
+    bool _isPingOutstanding = false;
+
+    uint16_t _nextPacketId = 0;
+    std::unordered_set<uint16_t> _inFlight;
+    std::map<std::string, Device> _devices;
+
+    std::atomic<bool> _isConnected{false};
+    std::atomic<uint64_t> _batches{0};
+    std::atomic<uint64_t> _messages{0};
+    std::atomic<uint64_t> _acknowledged{0};
+    std::atomic<uint64_t> _coalesced{0};
+    std::atomic<uint64_t> _reconnects{0};
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "sungrow_inverter.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct DeviceStatistics {
+    std::string host;
+    bool isConnected = false;
+    uint64_t scrapes = 0;
+    uint64_t failures = 0;
+    std::chrono::microseconds totalLatency{0};
+    std::chrono::microseconds maxLatency{0};
+    uint32_t lastActivePower = 0;
+};
+
+// Polls several inverters concurrently on one io_context served by a small
+// thread pool. Each device runs on its own strand, so a slow or dead unit
+// only delays its own session.
+class MultiInverterPoller {
+public:
+    // Runs on the device's strand after every scrape; a failed one left the
+    // latest data as it was but updated the inverter's failure counters
+    using SampleHandler = std::function<void(size_t deviceIndex, const SungrowInverter& inverter, bool isSuccess)>;
+
+    MultiInverterPoller(const std::vector<InverterConfig>& configs, size_t threadCount);
+    ~MultiInverterPoller();
+
+    // Must be set before start()
+    void setSampleHandler(SampleHandler handler);
+
+    void start();
+    void stop();
+
+    // Lets other asynchronous work, such as exporters, share the pool
+    boost::asio::any_io_executor getExecutor();
+
+    std::vector<DeviceStatistics> getStatistics() const;
+    // Only once stopped; the sessions own their inverters until then
+    const SungrowInverter& getInverter(size_t deviceIndex) const;
+    void printStatistics() const;
+
+private:
+    struct Session {
+        boost::asio::strand<boost::asio::io_context::executor_type> strand;
+        std::unique_ptr<SungrowInverter> inverter;
+        boost::asio::steady_timer timer;
+        std::optional<PollScheduler> scheduler;
+        size_t index;
+    };
+
+    static constexpr std::chrono::seconds RECONNECT_DELAY{5};
+
+    void _connectSession(Session& session);
+    void _startPolling(Session& session);
+    void _scheduleReconnect(Session& session);
+    void _scheduleNextPoll(Session& session);
+    void _pollSession(Session& session);
+    void _recordScrape(const Session& session, bool isSuccess);
+    void _setConnected(const Session& session, bool isConnected);
+
+    boost::asio::io_context _ioContext;
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> _workGuard;
+    std::vector<std::unique_ptr<Session>> _sessions;
+    std::vector<std::thread> _threads;
+    size_t _threadCount;
+    std::chrono::steady_clock::time_point _startTime;
+    SampleHandler _sampleHandler;
+
+    mutable std::mutex _statisticsMutex;
+    std::vector<DeviceStatistics> _statistics;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "read_plan.hpp"
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+enum class register_group {
+    POWER = 0,
+    DAILY_ENERGY,
+    LIFETIME_TOTALS,
+    IDENTITY  // Read once at connect, never scheduled
+};
+
+constexpr size_t REGISTER_GROUP_COUNT = 4;
+
+// Indexed by register_group
+using RegisterGroupMask = std::bitset<REGISTER_GROUP_COUNT>;
+
+struct PollGroup {
+    register_group group;
+    std::vector<RegisterSpan> spans;
+    std::chrono::milliseconds period;  // Zero polls the group once
+    std::chrono::milliseconds phase;   // Offset of the first poll from the scheduler epoch
+};
+
+// Tracks a steady_clock deadline per register group. Deadlines advance by
+// whole periods from the epoch, so late ticks never accumulate drift.
+class PollScheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit PollScheduler(clock::time_point epoch);
+
+    void addGroup(const PollGroup& group);
+    const PollGroup& getGroup(size_t index) const;
+
+    // Indices of the groups due at now; their deadlines move past now
+    std::vector<size_t> collectDue(clock::time_point now);
+    clock::time_point getNextDeadline() const;
+
+    // Spans of all the given groups, for one shared read plan
+    std::vector<RegisterSpan> mergeSpans(const std::vector<size_t>& groups) const;
+
+private:
+    struct Entry {
+        PollGroup group;
+        clock::time_point nextDue;
+    };
+
+    clock::time_point _epoch;
+    std::vector<Entry> _entries;
+};
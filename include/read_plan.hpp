@@ -0,0 +1,63 @@
+#pragma once
+
+#include "inverter_config.hpp"
+#include "sungrow_client.hpp"
+#include <cstdint>
+#include <vector>
+
+// A run of registers the caller wants decoded, e.g. two registers for a U32
+struct RegisterSpan {
+    uint8_t functionCode;
+    uint16_t address;
+    uint16_t count;
+};
+
+// Register values gathered from the blocks of one read plan, addressed by
+// register number so decoders do not need to know the block layout
+class RegisterImage {
+public:
+    void clear();
+    void store(uint8_t functionCode, uint16_t startAddr, const std::vector<uint16_t>& values);
+
+    bool contains(uint8_t functionCode, uint16_t address, uint16_t count = 1) const;
+    uint16_t get(uint8_t functionCode, uint16_t address) const;
+
+private:
+    struct Block {
+        uint8_t functionCode;
+        uint16_t startAddr;
+        std::vector<uint16_t> values;
+    };
+
+    const Block* _findBlock(uint8_t functionCode, uint16_t address) const;
+
+    std::vector<Block> _blocks;
+};
+
+// Coalesces the wanted registers into the fewest block reads. Gaps of up to
+// maxGap unwanted registers are read through unless they hold an address
+// known to be illegal on the device.
+class ReadPlanCompiler {
+public:
+    static constexpr uint16_t MAX_BLOCK_REGISTERS = 125;  // Modbus limit for FC 0x03/0x04
+    static constexpr uint16_t DEFAULT_MAX_GAP = 32;
+
+    explicit ReadPlanCompiler(uint16_t maxGap = DEFAULT_MAX_GAP);
+
+    uint16_t getMaxGap() const;
+    void setMaxGap(uint16_t maxGap);
+
+    void addIllegalRange(const RegisterRange& range);
+    const std::vector<RegisterRange>& getIllegalRanges() const;
+    bool isIllegal(uint8_t functionCode, uint16_t address) const;
+
+    std::vector<RegisterRange> compile(std::vector<RegisterSpan> wanted) const;
+
+    static std::vector<ModbusReadRequest> toRequests(const std::vector<RegisterRange>& blocks);
+
+private:
+    bool _isGapReadable(uint8_t functionCode, uint32_t gapStart, uint32_t gapEnd) const;
+
+    uint16_t _maxGap;
+    std::vector<RegisterRange> _illegalRanges;
+};
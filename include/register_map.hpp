@@ -0,0 +1,125 @@
+#pragma once
+
+#include "data_converter.hpp"
+#include "inverter_data.hpp"
+#include "poll_scheduler.hpp"
+#include "read_plan.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// One InverterData field and the registers it is decoded from. The register
+// type is a template parameter, so the decoder generated for each field has
+// no runtime type dispatch.
+template <register_type Type, typename Value>
+struct RegisterField {
+    static constexpr register_type TYPE = Type;
+    
+    uint8_t functionCode;
+    uint16_t address;
+    uint16_t count;
+    register_group group;
+    double scale;
+    std::string_view unit;
+    std::string_view name;  // snake_case, stable for exported metric and topic names
+    Value InverterData::* target;
+    double deadband;  // Changes no larger than this are not reported to exporters
+    
+    constexpr RegisterSpan getSpan() const { return {functionCode, address, count}; }
+    // Decimal places the scale resolves, for printing values without binary noise
+    int getDecimals() const { return scale < 1.0 ? static_cast<int>(std::lround(-std::log10(scale))) : 0; }
+};
+
+namespace RegisterMap {
+    constexpr uint8_t INPUT_REGISTERS = 0x04;
+    constexpr uint16_t U32_LENGTH = 2;
+    
+    template <typename Value>
+    constexpr RegisterField<register_type::U16, Value> u16(uint16_t address, register_group group, double scale, std::string_view unit,
+                                                           std::string_view name, Value InverterData::* target, double deadband = 0.0) {
+        return {INPUT_REGISTERS, address, 1, group, scale, unit, name, target, deadband};
+    }
+    
+    template <typename Value>
+    constexpr RegisterField<register_type::S16, Value> s16(uint16_t address, register_group group, double scale, std::string_view unit,
+                                                           std::string_view name, Value InverterData::* target, double deadband = 0.0) {
+        return {INPUT_REGISTERS, address, 1, group, scale, unit, name, target, deadband};
+    }
+    
+    template <typename Value>
+    constexpr RegisterField<register_type::U32, Value> u32(uint16_t address, register_group group, double scale, std::string_view unit,
+                                                           std::string_view name, Value InverterData::* target, double deadband = 0.0) {
+        return {INPUT_REGISTERS, address, U32_LENGTH, group, scale, unit, name, target, deadband};
+    }
+    
+    constexpr RegisterField<register_type::UTF8, std::string> utf8(uint16_t address, uint16_t count, register_group group,
+                                                                   std::string_view name, std::string InverterData::* target) {
+        return {INPUT_REGISTERS, address, count, group, 1.0, "", name, target, 0.0};
+    }
+    
+    // Zero-based input register addresses of the SG8K-D. Adding a decoded
+    // field takes one line here; the polled spans and decoders follow. The
+    // optional last argument is the exporter deadband for noisy fields.
+    inline constexpr auto FIELDS = std::make_tuple(
+        utf8(4989, 10, register_group::IDENTITY, "serial_number", &InverterData::serialNumber),
+        
+        u32(5031, register_group::POWER, 1.0, "W", "total_active_power", &InverterData::totalActivePower),
+        u16(5038, register_group::POWER, 1.0, "", "work_state_code", &InverterData::workStateCode),
+        
+        u32(5003, register_group::DAILY_ENERGY, 0.1, "kWh", "daily_power_yields", &InverterData::dailyPowerYields),
+        s16(5008, register_group::DAILY_ENERGY, 0.1, "°C", "internal_temperature", &InverterData::internalTemperature, 0.5),
+        u16(5019, register_group::DAILY_ENERGY, 0.1, "V", "phase_a_voltage", &InverterData::phaseAVoltage, 1.0),
+        u32(5092, register_group::DAILY_ENERGY, 0.1, "kWh", "daily_export_energy", &InverterData::dailyExportEnergy),
+        u32(5096, register_group::DAILY_ENERGY, 0.1, "kWh", "daily_import_energy", &InverterData::dailyImportEnergy),
+        u32(5100, register_group::DAILY_ENERGY, 0.1, "kWh", "daily_direct_consumption", &InverterData::dailyDirectConsumption),
+        u16(5113, register_group::DAILY_ENERGY, 1.0, "min", "daily_running_time", &InverterData::dailyRunningTime),
+        
+        u32(5144, register_group::LIFETIME_TOTALS, 0.1, "kWh", "total_power_yields", &InverterData::totalPowerYields),
+        u32(5094, register_group::LIFETIME_TOTALS, 0.1, "kWh", "total_export_energy", &InverterData::totalExportEnergy),
+        u32(5098, register_group::LIFETIME_TOTALS, 0.1, "kWh", "total_import_energy", &InverterData::totalImportEnergy),
+        u32(5102, register_group::LIFETIME_TOTALS, 0.1, "kWh", "total_direct_consumption", &InverterData::totalDirectConsumption)
+    );
+    
+    constexpr size_t FIELD_COUNT = std::tuple_size_v<decltype(FIELDS)>;
+    
+    // Calls visitor with every field descriptor in table order
+    template <typename Visitor>
+    void forEachField(Visitor&& visitor) {
+        std::apply([&visitor](const auto&... fields) { (visitor(fields), ...); }, FIELDS);
+    }
+    
+    // Calls visitor with every field that decodes to a number, in table order
+    template <typename Visitor>
+    void forEachNumericField(Visitor&& visitor) {
+        forEachField([&visitor](const auto& field) {
+            if constexpr (std::decay_t<decltype(field)>::TYPE != register_type::UTF8) {
+                visitor(field);
+            }
+        });
+    }
+    
+    constexpr size_t NUMERIC_FIELD_COUNT = std::apply([](const auto&... fields) {
+        return (size_t{0} + ... + (std::decay_t<decltype(fields)>::TYPE != register_type::UTF8 ? 1 : 0));
+    }, FIELDS);
+    
+    // Position of a numeric field in forEachNumericField order, or
+    // NUMERIC_FIELD_COUNT when no numeric field has that name
+    size_t getNumericFieldIndex(std::string_view name);
+    register_group getNumericFieldGroup(size_t index);
+    
+    // Numeric field values of data in forEachNumericField order
+    std::array<double, NUMERIC_FIELD_COUNT> getNumericValues(const InverterData& data);
+    
+    // Spans of the group's fields in table order
+    const std::vector<RegisterSpan>& getSpans(register_group group);
+    
+    // Decodes the group's fields held in image into data, the numeric ones
+    // in a single ModbusDataConverter::decodeLanes pass. Fields whose
+    // registers are missing keep their previous value. Returns whether
+    // image held every field of the group.
+    bool decode(register_group group, const RegisterImage& image, InverterData& data);
+}
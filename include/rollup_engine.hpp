@@ -0,0 +1,84 @@
+#pragma once
+
+#include "inverter_data.hpp"
+#include "poll_scheduler.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class rollup_resolution {
+    MINUTE = 0,
+    HOUR,
+    DAY
+};
+
+constexpr size_t ROLLUP_RESOLUTION_COUNT = 3;
+
+struct RollupBucket {
+    int64_t start = 0;  // Unix seconds of the bucket's local start
+    uint32_t sampleCount = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double sum = 0.0;
+    double integral = 0.0;  // Trapezoidal, in value-hours (Wh for a power in W)
+
+    double getMean() const;
+};
+
+// Maintains min/max/mean/integral per minute, hour and local day for a few
+// register map fields, in O(1) per sample. A field takes samples only from
+// scrapes that read its register group, so slow groups are not re-counted
+// at the fast groups' rate. Each closed bucket is appended
+// to a fixed-size record file per field and resolution, so a query reads
+// only the records in its range. A bucket still open at shutdown is
+// written too and merged again if the next run continues it.
+class RollupEngine {
+public:
+    // Samples further apart than this are not integrated across
+    static constexpr std::chrono::seconds MAX_INTEGRATION_GAP{120};
+
+    explicit RollupEngine(std::string directory,
+                          std::vector<std::string> fieldNames = {"total_active_power", "phase_a_voltage", "internal_temperature"});
+    ~RollupEngine();
+
+    RollupEngine(const RollupEngine&) = delete;
+    RollupEngine& operator=(const RollupEngine&) = delete;
+
+    const std::string& getDirectory() const;
+    const std::vector<std::string>& getFieldNames() const;
+
+    // Fields outside groups are skipped; their values in data are stale
+    void addSample(const InverterData& data, RegisterGroupMask groups, std::chrono::system_clock::time_point time);
+
+    // Buckets starting in [from, to), including the open one
+    std::vector<RollupBucket> query(const std::string& fieldName, rollup_resolution resolution,
+                                    std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to) const;
+
+private:
+    struct Series {
+        RollupBucket bucket;
+        int64_t end = 0;
+        bool isOpen = false;
+        int fd = -1;
+        int64_t lastPersistedStart = -1;
+    };
+
+    struct TrackedField {
+        size_t valueIndex;
+        register_group group;
+        std::array<Series, ROLLUP_RESOLUTION_COUNT> series;
+        bool hasPrevious = false;
+        double previousTime = 0.0;  // Unix seconds
+        double previousValue = 0.0;
+    };
+
+    void _openSeries(Series& series, const std::string& fieldName, rollup_resolution resolution);
+    void _persist(Series& series);
+    static void _accumulate(Series& series, double value);
+
+    std::string _directory;
+    std::vector<std::string> _fieldNames;
+    std::vector<TrackedField> _fields;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "inverter_data.hpp"
+#include "register_map.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StoredSample {
+    std::chrono::system_clock::time_point time;
+    std::vector<double> values;  // In SampleStore::getColumnNames() order, time excluded
+};
+
+class ColumnFile;
+
+// Append-only columnar store of InverterData samples. Each day gets a
+// directory holding one memory-mapped file per column: the sample time
+// encoded as delta-of-delta, and every numeric register map field as the
+// delta of its raw register value. Both are zigzag varints with runs of
+// zero collapsed, so steady values cost almost nothing.
+//
+// append() copies the sample into a single-producer ring and returns; a
+// writer thread encodes it. Calls to append() must not overlap (one
+// polling thread or one strand per store).
+class SampleStore {
+public:
+    static constexpr size_t QUEUE_CAPACITY = 4096;
+    static constexpr std::chrono::milliseconds TIME_RESOLUTION{100};
+
+    explicit SampleStore(std::string directory);
+    // Drains the queue and trims the files to their used size
+    ~SampleStore();
+
+    SampleStore(const SampleStore&) = delete;
+    SampleStore& operator=(const SampleStore&) = delete;
+
+    const std::string& getDirectory() const;
+    uint64_t getWrittenCount() const;
+    // Samples refused because the writer was QUEUE_CAPACITY samples behind
+    uint64_t getDroppedCount() const;
+
+    // Never blocks; returns false when the queue is full
+    bool append(const InverterData& data, std::chrono::system_clock::time_point time);
+
+    // "time" followed by the register map names of the stored fields
+    static const std::vector<std::string>& getColumnNames();
+
+    // Decodes the samples stored for day, given as YYYY-MM-DD
+    static std::vector<StoredSample> readDay(const std::string& directory, const std::string& day);
+
+private:
+    struct QueuedSample {
+        int64_t time;  // TIME_RESOLUTION ticks since the Unix epoch
+        std::array<int64_t, RegisterMap::NUMERIC_FIELD_COUNT> values;  // Raw register values
+    };
+
+    void _writerLoop();
+    void _write(const QueuedSample& sample);
+    void _openDay(int32_t dayNumber);
+    void _closeDay();
+
+    std::string _directory;
+    std::vector<QueuedSample> _queue;
+    std::atomic<uint64_t> _published{0};
+    std::atomic<uint64_t> _consumed{0};
+    std::atomic<uint64_t> _wakeups{0};  // Bumped on every append and on stop; the writer waits on it
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<bool> _isStopping{false};
+
+    int32_t _openDayNumber = -1;  // Local days since the epoch
+    std::vector<std::unique_ptr<ColumnFile>> _columns;
+    std::thread _writer;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "inverter_data.hpp"
+#include "register_map.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+// Trivially copyable copy of InverterData. Numeric fields are held in
+// register map order, so exporters can walk them with forEachNumericField.
+struct InverterSnapshot {
+    static constexpr size_t TEXT_CAPACITY = 48;
+
+    uint64_t generation = 0;  // Zero until the first publish
+    std::chrono::system_clock::time_point time;
+    std::array<char, TEXT_CAPACITY> deviceType{};
+    std::array<char, TEXT_CAPACITY> serialNumber{};
+    std::array<char, TEXT_CAPACITY> workState{};
+    std::array<double, RegisterMap::NUMERIC_FIELD_COUNT> values{};
+
+    std::string_view getDeviceType() const;
+    std::string_view getSerialNumber() const;
+    std::string_view getWorkState() const;
+    InverterData toInverterData() const;
+};
+
+static_assert(std::is_trivially_copyable_v<InverterSnapshot>);
+
+// Publishes the latest InverterData to any number of reader threads. The
+// writer fills the slot readers are not using and then flips the
+// generation, so it never waits. A reader copies the published slot under
+// a per-slot sequence number and retries only if the writer published
+// twice during its copy, so reads never block and practically never loop.
+// publish() must be called from one thread at a time.
+class SnapshotPublisher {
+public:
+    void publish(const InverterData& data, std::chrono::system_clock::time_point time);
+
+    uint64_t getGeneration() const;
+    InverterSnapshot read() const;
+    // Copies into snapshot only when a generation newer than knownGeneration is published
+    bool readIfNewer(uint64_t knownGeneration, InverterSnapshot& snapshot) const;
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<uint64_t> sequence{0};  // Odd while the writer is filling the slot
+        InverterSnapshot snapshot;
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> _generation{0};
+    std::array<Slot, 2> _slots;
+};
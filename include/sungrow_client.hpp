@@ -1,16 +1,87 @@
 #pragma once
 
+#include <utility>
 #include <boost/asio.hpp>
 #include <vector>
 #include <string>
 #include <cstdint>
 #include <memory>
 #include <chrono>
+#include <stdexcept>
+#include <functional>
+#include <map>
+#include <deque>
+#include <random>
+#include <array>
+#include <span>
 #include "sungrow_crypto.hpp"
+#include "frame_buffer.hpp"
+#include "frame_capture.hpp"
+#include "latency_histogram.hpp"
 
+struct ModbusReadRequest {
+    uint8_t functionCode;
+    uint16_t address;
+    uint16_t count;
+};
+
+struct ModbusReadResult {
+    bool success = false;
+    std::vector<uint16_t> registers;
+    std::string error;
+    uint8_t exceptionCode = 0;  // Modbus exception code when the device rejected the read
+};
+
+struct ClientStatistics {
+    uint64_t requests = 0;
+    uint64_t timeouts = 0;
+    uint64_t retries = 0;
+    uint64_t reconnects = 0;
+    uint64_t decryptFailures = 0;
+    uint64_t responses = 0;  // Matched responses, the samples behind the round-trip times
+    uint64_t scrapeFailures = 0;  // Counted by SungrowInverter; their data was not published
+    std::chrono::microseconds totalRoundTrip{0};
+    std::chrono::microseconds maxRoundTrip{0};
+};
+
+class TimeoutError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Exception response from the device (function code with the 0x80 bit set)
+class ModbusException : public std::runtime_error {
+public:
+    static constexpr uint8_t ILLEGAL_FUNCTION = 1;
+    static constexpr uint8_t ILLEGAL_DATA_ADDRESS = 2;
+    static constexpr uint8_t ILLEGAL_DATA_VALUE = 3;
+    static constexpr uint8_t SERVER_DEVICE_FAILURE = 4;
+    
+    ModbusException(const std::string& message, uint8_t exceptionCode)
+        : std::runtime_error(message), _exceptionCode(exceptionCode) {}
+    
+    uint8_t getExceptionCode() const { return _exceptionCode; }
+
+private:
+    uint8_t _exceptionCode;
+};
+
+// Client for the Sungrow encrypted Modbus TCP variant. All socket work is
+// asynchronous on one executor; the blocking API runs a private io_context
+// until the matching asynchronous operation completes. A client built on a
+// shared executor (normally a strand) only supports the asynchronous API.
+//
+// Every response is awaited under the response timeout. A timeout or a
+// dropped socket closes the connection; after a jittered exponential
+// backoff the client reconnects, redoes the key exchange and replays the
+// requests that were still in flight, up to the configured retry count.
 class SungrowTcpClient {
 public:
+    using ConnectHandler = std::function<void(bool)>;
+    using ReadHandler = std::function<void(std::vector<ModbusReadResult>)>;
+    
     SungrowTcpClient(const std::string& host, uint16_t port, uint8_t slaveId);
+    SungrowTcpClient(boost::asio::any_io_executor executor, const std::string& host, uint16_t port, uint8_t slaveId);
     ~SungrowTcpClient();
 
     bool connect();
@@ -21,23 +92,182 @@ public:
 
     std::vector<uint16_t> readInputRegisters(uint16_t address, uint16_t count);
     std::vector<uint16_t> readHoldingRegisters(uint16_t address, uint16_t count);
+    
+    // Keeps up to the pipeline window of requests in flight and matches the
+    // responses back by MBAP transaction ID. Results are in request order.
+    std::vector<ModbusReadResult> readPipelined(const std::vector<ModbusReadRequest>& requests);
+    
+    // Asynchronous forms; handlers run on the client's executor. Only one
+    // pipelined read may be outstanding per client.
+    void asyncConnect(ConnectHandler handler);
+    void asyncReadPipelined(std::vector<ModbusReadRequest> requests, ReadHandler handler);
+    
+    const std::string& getHost() const;
+    boost::asio::any_io_executor getExecutor() const;
+    
+    uint8_t getPipelineWindow() const;
+    void setPipelineWindow(uint8_t pipelineWindow);
+    
+    // The key exchange is probed with a short deadline that backs off until
+    // the inverter answers or the connect timeout is used up
+    std::chrono::milliseconds getProbeTimeout() const;
+    void setProbeTimeout(std::chrono::milliseconds probeTimeout);
+    std::chrono::milliseconds getConnectTimeout() const;
+    void setConnectTimeout(std::chrono::milliseconds connectTimeout);
+    std::chrono::milliseconds getResponseTimeout() const;
+    void setResponseTimeout(std::chrono::milliseconds responseTimeout);
+    uint8_t getMaxRetries() const;
+    void setMaxRetries(uint8_t maxRetries);
+    
+    const ClientStatistics& getStatistics() const;
+    // Per-transaction phase latencies; read from the client's executor only
+    const LatencyStatistics& getLatencyStatistics() const;
+    
+    // Records every frame sent and received, still encrypted, for replay
+    // with CaptureReplayer. Set it before connecting; null stops capturing.
+    void setCapture(std::unique_ptr<FrameCaptureWriter> capture);
+    
+    static constexpr size_t READ_REQUEST_SIZE = 12;
+    
+    // Writes an MBAP read request into out, which must hold READ_REQUEST_SIZE bytes
+    static void encodeReadRequest(uint8_t* out, uint16_t transactionId, uint8_t slaveId, const ModbusReadRequest& request);
+    
+    // Decodes a plain read response into registers, reusing its capacity.
+    // Throws ModbusException for an exception response.
+    static void parseReadResponse(std::span<const uint8_t> response, std::vector<uint16_t>& registers);
 
 private:
+    using FrameHandler = std::function<void(const boost::system::error_code&)>;
+    
+    using Clock = std::chrono::steady_clock;
+    
+    struct RequestTiming {
+        Clock::time_point built;    // Before encryption
+        Clock::time_point sent;     // Queued for writing, latest send
+        Clock::time_point written;  // Write completed; unset until then
+    };
+    
+    // Timing of the frame in _rxFrame, or of a decrypted batch
+    struct ReceiveTiming {
+        Clock::time_point firstByte;
+        Clock::time_point complete;
+        std::chrono::nanoseconds decrypt{0};
+    };
+    
+    struct PipelineOperation {
+        std::vector<ModbusReadRequest> requests;
+        std::vector<ModbusReadResult> results;
+        std::map<uint16_t, size_t> inFlight;  // transaction ID -> request index
+        std::deque<size_t> pending;  // Request indices not yet sent, replays first
+        std::vector<RequestTiming> timings;  // Per request
+        size_t completed = 0;
+        uint8_t attempt = 0;  // Consecutive failed attempts since the last response
+        ReadHandler handler;
+    };
+    
+    struct KeyExchangeState {
+        std::chrono::steady_clock::time_point startTime;
+        std::chrono::milliseconds probeTimeout;
+        int unansweredProbes = 0;
+        std::vector<uint8_t> publicKey;
+        ConnectHandler handler;
+    };
+    
+    static constexpr size_t MBAP_HEADER_SIZE = 6;
+    static constexpr uint16_t MAX_MBAP_LENGTH = 254;  // Unit ID plus a 253 byte PDU
+    static constexpr size_t MAX_FRAME_SIZE = SungrowCrypto::CRYPTO_HEADER_SIZE + MBAP_HEADER_SIZE + MAX_MBAP_LENGTH + 16;
+    static constexpr std::chrono::milliseconds MAX_PROBE_TIMEOUT{2000};
+    static constexpr size_t PUBLIC_KEY_SIZE = 16;
+    static constexpr std::chrono::milliseconds BASE_BACKOFF{100};
+    static constexpr std::chrono::milliseconds MAX_BACKOFF{5000};
+    static constexpr size_t REQUEST_FRAME_CAPACITY = SungrowCrypto::CRYPTO_HEADER_SIZE + SungrowCrypto::getPaddedSize(READ_REQUEST_SIZE);
+    
+    void _requireOwnContext() const;
+    void _runUntil(const std::function<bool()>& isDone);
+    void _resetConnection();
+    void _asyncOpen(ConnectHandler handler);
+    
+    void _asyncKeyExchange(ConnectHandler handler);
+    void _sendKeyProbe(std::shared_ptr<KeyExchangeState> state);
+    void _drainKeyReplies(std::shared_ptr<KeyExchangeState> state);
+    void _finishKeyExchange(std::shared_ptr<KeyExchangeState> state);
+    
+    void _fillPipeline();
+    void _receiveNextResponse();
+    void _retryPipeline(const std::string& failure);
+    void _completePipeline(const std::string& failure);
+    std::chrono::milliseconds _getBackoffDelay(uint8_t attempt);
+    
+    void _queueWrite(std::span<const uint8_t> frame);
+    void _writeNext();
+    void _markWritten();
+    void _recordLatency(const ModbusReadRequest& request, const RequestTiming& timing, std::chrono::nanoseconds parse);
+    void _asyncReceiveFrame(std::chrono::milliseconds timeout, FrameHandler handler);
+    void _continueReceive(FrameHandler handler);
+    void _finishReceive(const boost::system::error_code& error, FrameHandler& handler);
+    void _decryptBufferedFrames();
+    void _takePlainFrame(FrameHandler& handler);
+    void _clearPlainFrames();
+    
+    std::span<const uint8_t> _buildModbusFrame(const ModbusReadRequest& request);
+    uint16_t _extractTransactionId(const std::vector<uint8_t>& response) const;
+    size_t _nextFrameSize() const;
+    bool _extractPublicKey(const std::vector<uint8_t>& keyResponse, std::vector<uint8_t>& publicKey) const;
+    std::vector<uint16_t> _readSingle(uint8_t functionCode, uint16_t address, uint16_t count);
+    
+    std::span<const uint8_t> _applySungrowEncryption(size_t frameSize);
+    
     std::string _host;
     uint16_t _port;
     uint8_t _slaveId;
     
-    boost::asio::io_context _ioContext;
+    std::unique_ptr<boost::asio::io_context> _ownedContext;  // Null on a shared executor
+    boost::asio::any_io_executor _executor;
+    boost::asio::ip::tcp::resolver _resolver;
     std::unique_ptr<boost::asio::ip::tcp::socket> _socket;
+    boost::asio::steady_timer _receiveTimer;
+    boost::asio::steady_timer _connectTimer;
+    boost::asio::steady_timer _retryTimer;
     std::unique_ptr<SungrowCrypto> _crypto;
     bool _connected;
     uint16_t _transactionId;
+    uint8_t _pipelineWindow;
+    std::chrono::milliseconds _probeTimeout{250};
+    std::chrono::milliseconds _connectTimeout{10000};
+    std::chrono::milliseconds _responseTimeout{10000};  // Zero waits indefinitely
+    uint8_t _maxRetries = 3;
+    uint64_t _connectionGeneration = 0;
+    std::mt19937 _jitter{std::random_device{}()};
+    ClientStatistics _statistics;
+    LatencyStatistics _latency;
+    
+    FrameBuffer _rxBuffer;
+    std::vector<uint8_t> _rxFrame;
+    uint64_t _receiveGeneration = 0;
+    bool _isReceiving = false;
+    bool _hasReceiveTimedOut = false;
+    Clock::time_point _rxFirstByteTime;  // Arrival of the oldest buffered byte
+    Clock::time_point _rxLastReadTime;
+    ReceiveTiming _rxTiming;
     
-    std::vector<uint8_t> _buildModbusFrame(uint8_t functionCode, uint16_t address, uint16_t count);
-    std::vector<uint16_t> _parseModbusResponse(const std::vector<uint8_t>& response);
-    bool _sendFrame(const std::vector<uint8_t>& frame);
-    std::vector<uint8_t> _receiveResponse();
+    // Encrypted responses are taken out of _rxBuffer in runs and decrypted
+    // in place in _rxBatch with one SungrowCrypto::decryptFrames call; the
+    // plain frames are then handed out one receive at a time
+    std::vector<uint8_t> _rxBatch;
+    std::vector<std::span<const uint8_t>> _rxPlainFrames;
+    size_t _rxPlainIndex = 0;
+    bool _hasBatchDecryptFailed = false;  // Reported once the frames before it are taken
+    ReceiveTiming _rxBatchTiming;
     
-    void _applySungrowEncryption(std::vector<uint8_t>& frame);
-    void _removeSungrowEncryption(std::vector<uint8_t>& response);
+    // Requests are built in _requestFrame and appended to _txPending; the
+    // buffers swap when a write completes, so pipelined requests go out in
+    // one write and steady-state sends never allocate
+    std::array<uint8_t, REQUEST_FRAME_CAPACITY> _requestFrame{};
+    std::vector<uint8_t> _txActive;
+    std::vector<uint8_t> _txPending;
+    std::vector<uint16_t> _txActiveIds;   // Transaction IDs of the requests in each buffer
+    std::vector<uint16_t> _txPendingIds;
+    bool _isWriting = false;
+    std::unique_ptr<PipelineOperation> _pipeline;
+    std::unique_ptr<FrameCaptureWriter> _capture;
 };
\ No newline at end of file
@@ -3,9 +3,13 @@
 #include <vector>
 #include <cstdint>
 #include <memory>
+#include <span>
 
 class SungrowCrypto {
 public:
+    static constexpr size_t CRYPTO_HEADER_SIZE = 4;
+    static constexpr size_t BLOCK_SIZE = 16;
+    
     SungrowCrypto();
     ~SungrowCrypto();
 
@@ -13,9 +17,33 @@ public:
     bool isEncryptionEnabled() const;
     
     std::vector<uint8_t> encryptFrame(const std::vector<uint8_t>& frame);
+    
+    // Zero-pads and encrypts the plain frame at buffer + CRYPTO_HEADER_SIZE
+    // in place, then writes the crypto header in front of it. Returns the
+    // on-wire size, or 0 if the buffer cannot hold the padded frame.
+    size_t encryptFrameInPlace(uint8_t* buffer, size_t frameSize, size_t capacity);
     std::vector<uint8_t> decryptFrame(const std::vector<uint8_t>& encryptedFrame);
     
+    // Decrypts one encrypted frame in place. The plain frame is left at
+    // frame + CRYPTO_HEADER_SIZE; returns its length, or 0 if the frame is
+    // malformed or truncated.
+    size_t decryptFrameInPlace(std::span<uint8_t> frame);
+    
+    // Decrypts a run of back-to-back encrypted frames, as received for a
+    // pipelined read, in place. A view of each plain frame is appended to
+    // plainFrames. Returns the number of bytes consumed; a trailing partial
+    // frame is left untouched.
+    size_t decryptFrames(std::span<uint8_t> stream, std::vector<std::span<const uint8_t>>& plainFrames);
+    
     static std::vector<uint8_t> getKeyExchangeCommand();
+    
+    static constexpr size_t getPaddedSize(size_t frameSize) {
+        return (frameSize + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    }
+    
+    // On-wire size of the encrypted frame that starts with the given crypto
+    // header (header plus padded ciphertext), or 0 if the header is malformed
+    static size_t getEncryptedFrameSize(const uint8_t* header, size_t available);
 
 private:
     static constexpr uint8_t PRIVATE_KEY[16] = {
@@ -28,10 +56,9 @@ private:
     
     struct AESContext;
     std::unique_ptr<AESContext> _aesContext;
+    std::unique_ptr<AESContext> _decryptContext;
     
     void _deriveKey(const std::vector<uint8_t>& publicKey);
-    std::vector<uint8_t> _addPadding(const std::vector<uint8_t>& data);
-    std::vector<uint8_t> _removePadding(const std::vector<uint8_t>& data);
-    std::vector<uint8_t> _createCryptoHeader(uint16_t length, uint8_t paddingLength);
-    bool _parseCryptoHeader(const std::vector<uint8_t>& data, uint16_t& length, uint8_t& paddingLength);
+    static void _writeCryptoHeader(uint8_t* header, uint16_t length, uint8_t paddingLength);
+    static bool _parseCryptoHeader(const uint8_t* data, size_t size, uint16_t& length, uint8_t& paddingLength);
 };
\ No newline at end of file
@@ -1,62 +1,84 @@
 #pragma once
 
 #include "sungrow_client.hpp"
-#include "data_converter.hpp"
+#include "inverter_data.hpp"
 #include "inverter_config.hpp"
+#include "read_plan.hpp"
+#include "poll_scheduler.hpp"
+#include "snapshot_publisher.hpp"
 #include <memory>
 #include <string>
-
-struct InverterData {
-    std::string deviceType = "Unknown";
-    std::string serialNumber = "Unknown";
-    std::string runState = "Unknown";
-    std::string timestamp;
-    
-    double dailyPowerYields = 0.0;
-    double totalPowerYields = 0.0;
-    
-    double dailyExportEnergy = 0.0;
-    double totalExportEnergy = 0.0;
-    double dailyImportEnergy = 0.0;
-    double totalImportEnergy = 0.0;
-    
-    double dailyDirectConsumption = 0.0;
-    double totalDirectConsumption = 0.0;
-    
-    double internalTemperature = 0.0;
-    double phaseAVoltage = 0.0;
-    uint32_t totalActivePower = 0;
-    std::string workState1 = "Unknown";
-    uint16_t dailyRunningTime = 0;
-    
-    uint32_t exportToGrid = 0;
-    uint32_t importFromGrid = 0;
-};
+#include <vector>
+#include <chrono>
+#include <functional>
 
 class SungrowInverter {
 public:
     explicit SungrowInverter(const InverterConfig& config);
+    // Runs the client on a shared executor; only the async API is usable
+    SungrowInverter(const InverterConfig& config, boost::asio::any_io_executor executor);
     ~SungrowInverter();
 
     bool connect();
     void disconnect();
     bool isConnected() const;
     
-    bool detectModel();
-    bool detectSerial();
+    // Reads the serial number and device type in one block
+    bool detectIdentity();
+    // Takes the identity and read plan from the identity cache, or from an
+    // earlier detection, so polling can start at once. The next scrape reads
+    // the identity registers along with the data and reconciles them.
+    bool restoreIdentity();
     bool scrapeData();
+    bool scrapeRegisters(const std::vector<RegisterSpan>& wanted);
+    std::vector<PollGroup> getPollGroups() const;
+    
+    // Asynchronous forms; handlers run on the client's executor
+    void asyncConnect(std::function<void(bool)> handler);
+    void asyncDetectIdentity(std::function<void(bool)> handler);
+    void asyncScrapeRegisters(std::vector<RegisterSpan> wanted, std::function<void(bool)> handler);
     
+    // Only for the thread that scrapes; other threads take a snapshot
     const InverterData& getLatestData() const;
+    // Wait-free copy of the data as of the last completed scrape
+    InverterSnapshot getSnapshot() const;
+    const SnapshotPublisher& getSnapshotPublisher() const;
+    std::chrono::microseconds getLastScrapeLatency() const;
+    // Groups whose registers were all read by the last scrape; the other
+    // groups' fields in getLatestData() are from earlier scrapes
+    RegisterGroupMask getScrapedGroups() const;
+    // Only for the thread that scrapes, like getLatestData()
+    ClientStatistics getClientStatistics() const;
+    const LatencyStatistics& getLatencyStatistics() const;
     void printPowerConsumptionStatus() const;
 
 private:
     InverterConfig _config;
     std::unique_ptr<SungrowTcpClient> _client;
-    ModbusDataConverter _converter;
+    ReadPlanCompiler _planCompiler;
+    RegisterImage _registerImage;
     InverterData _latestData;
+    SnapshotPublisher _snapshot;
+    std::chrono::microseconds _lastScrapeLatency{0};
+    uint64_t _scrapeFailures = 0;
+    RegisterGroupMask _scrapedGroups;
+    uint16_t _deviceCode = 0;
+    bool _hasIdentity = false;
+    bool _isIdentityUnverified = false;  // Restored, not yet read back from the unit
+    bool _isDiscoveryLoaded = false;
     
-    bool _readPowerData();
-    bool _readEnergyData();
-    bool _readSystemStatus();
+    void _configureClient();
+    bool _applyDeviceCode(uint16_t deviceCode);
+    bool _applyIdentity(const RegisterImage& identity);
+    void _revalidateIdentity();
+    void _loadDiscoveryMap();
+    void _storeIdentity();
+    std::vector<RegisterSpan> _withIdentitySpan(const std::vector<RegisterSpan>& wanted) const;
+    void _beginScrape();
+    std::vector<RegisterSpan> _storeBlockResults(const std::vector<RegisterRange>& blocks, const std::vector<ModbusReadResult>& results,
+                                                 const std::vector<RegisterSpan>& wanted, std::vector<RegisterRange>& failedBlocks);
+    bool _finishScrape(const std::vector<RegisterSpan>& wanted, size_t blockReads, std::chrono::steady_clock::time_point scrapeStart);
+    void _learnIllegalGaps(const std::vector<RegisterRange>& failedBlocks, const std::vector<RegisterSpan>& wanted);
+    void _decodeRegisters();
     std::string _getWorkStateString(uint16_t stateCode) const;
 };
\ No newline at end of file
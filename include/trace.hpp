@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <string>
+
+enum class trace_level {
+    OFF = 0,
+    INFO,   // One line per connection event or scrape
+    DEBUG,  // One line per frame, decoded
+    FRAME   // Raw frames captured into the in-memory ring
+};
+
+enum class frame_direction {
+    TX = 0,
+    RX
+};
+
+// Levels above this are compiled out entirely; release builds can lower it
+// with -DSUNGROW_TRACE_MAX_LEVEL=<n> so disabled tracing costs nothing
+#ifndef SUNGROW_TRACE_MAX_LEVEL
+#define SUNGROW_TRACE_MAX_LEVEL 3
+#endif
+
+namespace Trace {
+    extern std::atomic<int> currentLevel;
+
+    constexpr bool isCompiledIn(trace_level level) {
+        return static_cast<int>(level) <= SUNGROW_TRACE_MAX_LEVEL;
+    }
+
+    trace_level getLevel();
+    void setLevel(trace_level level);
+    bool parseLevel(const std::string& name, trace_level& level);
+
+    inline bool isEnabled(trace_level level) {
+        return static_cast<int>(level) <= currentLevel.load(std::memory_order_relaxed);
+    }
+
+    void write(const std::string& line);
+
+    // Copies a frame into the capture ring; never blocks or allocates
+    void captureFrame(frame_direction direction, std::span<const uint8_t> frame);
+
+    // Hex dump of the captured frames, oldest first
+    void dumpFrames(std::ostream& output);
+}
+
+// Fixed ring of frame captures shared by all threads. Writers claim a slot
+// with one atomic increment and publish it through a per-slot sequence
+// number, so a reader skips slots that are being overwritten.
+class FrameTraceRing {
+public:
+    static constexpr size_t SLOT_COUNT = 256;
+    static constexpr size_t MAX_CAPTURE_SIZE = 288;  // Largest encrypted Modbus TCP frame
+
+    void capture(frame_direction direction, std::span<const uint8_t> frame);
+    void dump(std::ostream& output) const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};  // Odd while being written
+        uint64_t index = 0;
+        int64_t timestampUs = 0;
+        frame_direction direction = frame_direction::TX;
+        uint16_t size = 0;
+        uint16_t capturedSize = 0;
+        std::array<uint8_t, MAX_CAPTURE_SIZE> bytes{};
+    };
+
+    std::atomic<uint64_t> _nextIndex{0};
+    std::array<Slot, SLOT_COUNT> _slots;
+};
+
+#define SUNGROW_TRACE(level, message)                                  \
+    do {                                                               \
+        if constexpr (Trace::isCompiledIn(level)) {                    \
+            if (Trace::isEnabled(level)) {                             \
+                std::ostringstream traceStream;                        \
+                traceStream << message;                                \
+                Trace::write(traceStream.str());                       \
+            }                                                          \
+        }                                                              \
+    } while (0)
+
+#define SUNGROW_TRACE_FRAME(direction, frame)                          \
+    do {                                                               \
+        if constexpr (Trace::isCompiledIn(trace_level::FRAME)) {       \
+            if (Trace::isEnabled(trace_level::FRAME)) {                \
+                Trace::captureFrame(direction, frame);                 \
+            }                                                          \
+        }                                                              \
+    } while (0)
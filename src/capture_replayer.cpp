@@ -0,0 +1,153 @@
+#include "capture_replayer.hpp"
+#include "read_plan.hpp"
+#include "register_map.hpp"
+#include "sungrow_client.hpp"
+#include "sungrow_crypto.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    constexpr size_t MBAP_HEADER_SIZE = 6;
+    constexpr size_t PUBLIC_KEY_SIZE = 16;
+    constexpr size_t KEY_REPLY_MIN_SIZE = MBAP_HEADER_SIZE + 3 + PUBLIC_KEY_SIZE;
+
+    constexpr register_group DECODED_GROUPS[] = {
+        register_group::IDENTITY, register_group::POWER, register_group::DAILY_ENERGY, register_group::LIFETIME_TOTALS
+    };
+
+    uint16_t readTransactionId(std::span<const uint8_t> frame) {
+        return (static_cast<uint16_t>(frame[0]) << 8) | frame[1];
+    }
+
+    // The plain frame, decrypted in place in scratch when the session is encrypted
+    bool unwrapFrame(SungrowCrypto& crypto, const std::vector<uint8_t>& bytes, std::vector<uint8_t>& scratch,
+                     std::span<const uint8_t>& plain) {
+        scratch.assign(bytes.begin(), bytes.end());
+        if (!crypto.isEncryptionEnabled()) {
+            plain = scratch;
+            return true;
+        }
+        size_t plainSize = crypto.decryptFrameInPlace(scratch);
+        if (plainSize == 0) {
+            return false;
+        }
+        plain = std::span<const uint8_t>(scratch).subspan(SungrowCrypto::CRYPTO_HEADER_SIZE, plainSize);
+        return true;
+    }
+}
+
+bool ReplayStatistics::hasRegressions() const {
+    return decryptFailures != 0 || parseFailures != 0 || unmatched != 0;
+}
+
+CaptureReplayer::CaptureReplayer(const std::string& path) {
+    if (!_capture.load(path)) {
+        throw std::runtime_error(path + " is not a frame capture");
+    }
+}
+
+const FrameCapture& CaptureReplayer::getCapture() const {
+    return _capture;
+}
+
+ReplayStatistics CaptureReplayer::replay(replay_speed speed, const ResponseHandler& onResponse) const {
+    static const std::vector<uint8_t> KEY_EXCHANGE_COMMAND = SungrowCrypto::getKeyExchangeCommand();
+
+    ReplayStatistics statistics;
+    auto crypto = std::make_unique<SungrowCrypto>();
+    std::vector<uint8_t> publicKey;
+    std::map<uint16_t, ModbusReadRequest> inFlight;  // Transaction ID -> request
+    std::vector<uint8_t> scratch;
+    std::vector<uint16_t> registers;
+    RegisterImage image;
+    InverterData data;
+
+    auto replayStart = std::chrono::steady_clock::now();
+    for (const auto& record : _capture.records) {
+        if (speed == replay_speed::RECORDED) {
+            std::this_thread::sleep_until(replayStart + record.offset);
+        }
+
+        if (record.type == capture_record::CONNECTED) {
+            // Every connection negotiates its own session key
+            ++statistics.connections;
+            crypto = std::make_unique<SungrowCrypto>();
+            publicKey.clear();
+            inFlight.clear();
+            continue;
+        }
+
+        if (record.type == capture_record::TX) {
+            if (record.bytes == KEY_EXCHANGE_COMMAND) {
+                continue;
+            }
+            // The client switches to the newest key once the exchange is over
+            if (!crypto->isEncryptionEnabled() && !publicKey.empty()) {
+                crypto->initializeEncryption(publicKey);
+            }
+            std::span<const uint8_t> plain;
+            if (!unwrapFrame(*crypto, record.bytes, scratch, plain) || plain.size() < SungrowTcpClient::READ_REQUEST_SIZE) {
+                ++statistics.decryptFailures;
+                continue;
+            }
+            ModbusReadRequest request{plain[7], static_cast<uint16_t>((plain[8] << 8) | plain[9]),
+                                      static_cast<uint16_t>((plain[10] << 8) | plain[11])};
+            inFlight[readTransactionId(plain)] = request;
+            ++statistics.requests;
+            continue;
+        }
+
+        // Before the first request the plain replies carry the public key
+        if (!crypto->isEncryptionEnabled() && inFlight.empty()) {
+            if (record.bytes.size() >= KEY_REPLY_MIN_SIZE) {
+                publicKey.assign(record.bytes.end() - PUBLIC_KEY_SIZE, record.bytes.end());
+            }
+            continue;
+        }
+
+        statistics.bytes += record.bytes.size();
+        std::span<const uint8_t> plain;
+        if (!unwrapFrame(*crypto, record.bytes, scratch, plain)) {
+            ++statistics.decryptFailures;
+            continue;
+        }
+
+        // Same matching rule as the client: a lone request owns any response
+        auto match = plain.size() < 2 ? inFlight.end()
+                   : inFlight.size() == 1 ? inFlight.begin() : inFlight.find(readTransactionId(plain));
+        if (match == inFlight.end()) {
+            ++statistics.unmatched;
+            continue;
+        }
+        ModbusReadRequest request = match->second;
+        inFlight.erase(match);
+
+        try {
+            SungrowTcpClient::parseReadResponse(plain, registers);
+        }
+        catch (const ModbusException&) {
+            ++statistics.exceptions;
+            continue;
+        }
+        catch (const std::exception&) {
+            ++statistics.parseFailures;
+            continue;
+        }
+
+        image.clear();
+        image.store(request.functionCode, request.address, registers);
+        for (auto group : DECODED_GROUPS) {
+            RegisterMap::decode(group, image, data);
+        }
+        ++statistics.responses;
+        if (onResponse) {
+            onResponse(data);
+        }
+    }
+
+    statistics.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - replayStart);
+    return statistics;
+}
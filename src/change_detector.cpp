@@ -0,0 +1,49 @@
+#include "change_detector.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+ChangeDetector::ChangeDetector(std::chrono::seconds keyframeInterval)
+    : _keyframeInterval(keyframeInterval) {
+    size_t index = 0;
+    RegisterMap::forEachNumericField([&](const auto& field) {
+        _deadbands[index++] = field.deadband;
+    });
+}
+
+std::chrono::seconds ChangeDetector::getKeyframeInterval() const {
+    return _keyframeInterval;
+}
+
+double ChangeDetector::getDeadband(size_t fieldIndex) const {
+    return _deadbands.at(fieldIndex);
+}
+
+void ChangeDetector::setDeadband(std::string_view fieldName, double deadband) {
+    size_t index = RegisterMap::getNumericFieldIndex(fieldName);
+    if (index == RegisterMap::NUMERIC_FIELD_COUNT) {
+        throw std::invalid_argument("Unknown field: " + std::string(fieldName));
+    }
+    _deadbands[index] = deadband;
+}
+
+FieldChanges ChangeDetector::update(const InverterSnapshot& snapshot) {
+    FieldChanges changes;
+    changes.isKeyframe = !_hasKeyframe || snapshot.time - _lastKeyframe >= _keyframeInterval;
+
+    if (changes.isKeyframe) {
+        changes.mask.set();
+        _sentValues = snapshot.values;
+        _hasKeyframe = true;
+        _lastKeyframe = snapshot.time;
+        return changes;
+    }
+
+    for (size_t i = 0; i < snapshot.values.size(); i++) {
+        if (std::fabs(snapshot.values[i] - _sentValues[i]) > _deadbands[i]) {
+            changes.mask.set(i);
+            _sentValues[i] = snapshot.values[i];
+        }
+    }
+    return changes;
+}
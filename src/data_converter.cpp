@@ -1,4 +1,335 @@
 #include "data_converter.hpp"
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define SUNGROW_HAS_SSE2 1
+#if defined(__GNUC__)
+// AVX2 kernels are compiled for that target only and chosen at run time
+#define SUNGROW_HAS_AVX2 1
+#define SUNGROW_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+    constexpr uint16_t INVALID_U16 = 0xFFFF;
+    constexpr uint16_t INVALID_S16 = 0x7FFF;
+    constexpr uint32_t INVALID_U32 = 0xFFFFFFFF;
+    constexpr size_t REGISTER_SIZE = 2;
+    constexpr size_t VALIDITY_WORD_BITS = 64;
+    constexpr uint64_t DOUBLE_EXPONENT_2_52 = 0x4330000000000000;  // Bit pattern of 2^52
+    constexpr double TWO_POW_52 = 4503599627370496.0;
+    
+    uint16_t loadWord(const uint8_t* bytes) {
+        return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+    }
+    
+    // Kernels start at value index first, so the SIMD paths hand the
+    // scalar ones the tail of a block
+    void setValidBits(uint64_t* validity, size_t first, uint64_t bits) {
+        validity[first / VALIDITY_WORD_BITS] |= bits << (first % VALIDITY_WORD_BITS);
+    }
+    
+    void swapWordsScalar(const uint8_t* payload, size_t first, size_t count, uint16_t* registers) {
+        for (size_t i = first; i < count; ++i) {
+            registers[i] = loadWord(payload + REGISTER_SIZE * i);
+        }
+    }
+    
+    void decodeU16Scalar(const uint8_t* payload, size_t first, size_t count, double scale, double* values, uint64_t* validity) {
+        for (size_t i = first; i < count; ++i) {
+            uint16_t word = loadWord(payload + REGISTER_SIZE * i);
+            bool isValid = word != INVALID_U16;
+            values[i] = isValid ? word * scale : 0.0;
+            setValidBits(validity, i, isValid);
+        }
+    }
+    
+    void decodeS16Scalar(const uint8_t* payload, size_t first, size_t count, double scale, double* values, uint64_t* validity) {
+        for (size_t i = first; i < count; ++i) {
+            uint16_t word = loadWord(payload + REGISTER_SIZE * i);
+            bool isValid = word != INVALID_U16 && word != INVALID_S16;
+            values[i] = isValid ? static_cast<int16_t>(word) * scale : 0.0;
+            setValidBits(validity, i, isValid);
+        }
+    }
+    
+    void decodeU32Scalar(const uint8_t* payload, size_t first, size_t count, double scale, double* values, uint64_t* validity) {
+        for (size_t i = first; i < count; ++i) {
+            const uint8_t* pair = payload + 2 * REGISTER_SIZE * i;
+            uint32_t value = (static_cast<uint32_t>(loadWord(pair)) << 16) | loadWord(pair + REGISTER_SIZE);
+            bool isValid = value != INVALID_U32;
+            values[i] = isValid ? value * scale : 0.0;
+            setValidBits(validity, i, isValid);
+        }
+    }
+    
+    // S16 lanes subtract twice their sign bit, which turns the raw word
+    // into its two's complement value without a branch
+    uint64_t decodeLanesScalar(const LaneLayout& layout, const uint32_t* raw, double* values) {
+        uint64_t validity = 0;
+        for (size_t i = 0; i < layout.count; ++i) {
+            uint32_t word = raw[i];
+            bool isValid = word != layout.sentinels[i] && word != layout.altSentinels[i];
+            double value = static_cast<double>(word) - 2.0 * static_cast<double>(word & layout.signBits[i]);
+            values[i] = isValid ? value * layout.scales[i] : 0.0;
+            validity |= static_cast<uint64_t>(isValid) << i;
+        }
+        return validity;
+    }
+
+#if SUNGROW_HAS_SSE2
+    constexpr size_t SSE2_WORDS = 8;
+    constexpr size_t SSE2_PAIRS = 4;
+    constexpr int SWAP_HALVES = 0xB1;  // _MM_SHUFFLE(2, 3, 0, 1)
+    
+    __m128i swapBytesSse2(__m128i words) {
+        return _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+    }
+    
+    // Converts four int32 lanes to scaled doubles
+    void storeScaledSse2(double* out, __m128i lanes, __m128d scale) {
+        _mm_storeu_pd(out, _mm_mul_pd(_mm_cvtepi32_pd(lanes), scale));
+        _mm_storeu_pd(out + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(lanes, 8)), scale));
+    }
+    
+    // One bit per 16-bit lane that is set in the compare mask
+    uint64_t maskWordsSse2(__m128i mask) {
+        return static_cast<uint64_t>(_mm_movemask_epi8(_mm_packs_epi16(mask, _mm_setzero_si128())) & 0xFF);
+    }
+    
+    void swapWordsSse2(const uint8_t* payload, size_t count, uint16_t* registers) {
+        size_t i = 0;
+        for (; i + SSE2_WORDS <= count; i += SSE2_WORDS) {
+            __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(payload + REGISTER_SIZE * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(registers + i), swapBytesSse2(raw));
+        }
+        swapWordsScalar(payload, i, count, registers);
+    }
+    
+    template <bool IsSigned>
+    void decode16Sse2(const uint8_t* payload, size_t count, double scale, double* values, uint64_t* validity) {
+        const __m128i allOnes = _mm_set1_epi16(static_cast<short>(INVALID_U16));
+        const __m128i signedSentinel = _mm_set1_epi16(static_cast<short>(INVALID_S16));
+        const __m128d scaleVector = _mm_set1_pd(scale);
+        size_t i = 0;
+        
+        for (; i + SSE2_WORDS <= count; i += SSE2_WORDS) {
+            __m128i words = swapBytesSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(payload + REGISTER_SIZE * i)));
+            __m128i invalid = _mm_cmpeq_epi16(words, allOnes);
+            if constexpr (IsSigned) {
+                invalid = _mm_or_si128(invalid, _mm_cmpeq_epi16(words, signedSentinel));
+            }
+            words = _mm_andnot_si128(invalid, words);
+            setValidBits(validity, i, ~maskWordsSse2(invalid) & 0xFF);
+            
+            __m128i low;
+            __m128i high;
+            if constexpr (IsSigned) {
+                low = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+                high = _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16);
+            } else {
+                low = _mm_unpacklo_epi16(words, _mm_setzero_si128());
+                high = _mm_unpackhi_epi16(words, _mm_setzero_si128());
+            }
+            storeScaledSse2(values + i, low, scaleVector);
+            storeScaledSse2(values + i + 4, high, scaleVector);
+        }
+        
+        if constexpr (IsSigned) {
+            decodeS16Scalar(payload, i, count, scale, values, validity);
+        } else {
+            decodeU16Scalar(payload, i, count, scale, values, validity);
+        }
+    }
+    
+    void decodeU32Sse2(const uint8_t* payload, size_t count, double scale, double* values, uint64_t* validity) {
+        const __m128i allOnes = _mm_set1_epi32(-1);
+        const __m128i exponent = _mm_set1_epi32(static_cast<int>(DOUBLE_EXPONENT_2_52 >> 32));
+        const __m128d bias = _mm_set1_pd(TWO_POW_52);
+        const __m128d scaleVector = _mm_set1_pd(scale);
+        size_t i = 0;
+        
+        for (; i + SSE2_PAIRS <= count; i += SSE2_PAIRS) {
+            __m128i words = swapBytesSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(payload + 2 * REGISTER_SIZE * i)));
+            // High word first on the wire; swap the halves of each lane
+            __m128i pairs = _mm_shufflehi_epi16(_mm_shufflelo_epi16(words, SWAP_HALVES), SWAP_HALVES);
+            __m128i invalid = _mm_cmpeq_epi32(pairs, allOnes);
+            pairs = _mm_andnot_si128(invalid, pairs);
+            setValidBits(validity, i, ~static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(invalid))) & 0xF);
+            
+            // Unsigned lanes become exact doubles as 2^52 + value, minus 2^52
+            __m128d low = _mm_sub_pd(_mm_castsi128_pd(_mm_unpacklo_epi32(pairs, exponent)), bias);
+            __m128d high = _mm_sub_pd(_mm_castsi128_pd(_mm_unpackhi_epi32(pairs, exponent)), bias);
+            _mm_storeu_pd(values + i, _mm_mul_pd(low, scaleVector));
+            _mm_storeu_pd(values + i + 2, _mm_mul_pd(high, scaleVector));
+        }
+        decodeU32Scalar(payload, i, count, scale, values, validity);
+    }
+    
+    __m128i loadLanesSse2(const uint32_t* lanes) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+    }
+    
+    // Runs whole vectors into the layout's padding lanes, so there is no tail
+    uint64_t decodeLanesSse2(const LaneLayout& layout, const uint32_t* raw, double* values) {
+        const __m128i exponent = _mm_set1_epi32(static_cast<int>(DOUBLE_EXPONENT_2_52 >> 32));
+        const __m128d bias = _mm_set1_pd(TWO_POW_52);
+        uint64_t validity = 0;
+        
+        for (size_t i = 0; i < layout.count; i += SSE2_PAIRS) {
+            __m128i words = loadLanesSse2(raw + i);
+            __m128i invalid = _mm_or_si128(_mm_cmpeq_epi32(words, loadLanesSse2(layout.sentinels.data() + i)),
+                                           _mm_cmpeq_epi32(words, loadLanesSse2(layout.altSentinels.data() + i)));
+            words = _mm_andnot_si128(invalid, words);
+            validity |= (~static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(invalid))) & 0xF) << i;
+            __m128i signs = _mm_and_si128(words, loadLanesSse2(layout.signBits.data() + i));
+            
+            // Unsigned lanes become exact doubles as 2^52 + value, minus 2^52
+            __m128d low = _mm_sub_pd(_mm_castsi128_pd(_mm_unpacklo_epi32(words, exponent)), bias);
+            __m128d high = _mm_sub_pd(_mm_castsi128_pd(_mm_unpackhi_epi32(words, exponent)), bias);
+            __m128d signLow = _mm_cvtepi32_pd(signs);
+            __m128d signHigh = _mm_cvtepi32_pd(_mm_srli_si128(signs, 8));
+            low = _mm_sub_pd(_mm_sub_pd(low, signLow), signLow);
+            high = _mm_sub_pd(_mm_sub_pd(high, signHigh), signHigh);
+            _mm_storeu_pd(values + i, _mm_mul_pd(low, _mm_loadu_pd(layout.scales.data() + i)));
+            _mm_storeu_pd(values + i + 2, _mm_mul_pd(high, _mm_loadu_pd(layout.scales.data() + i + 2)));
+        }
+        return validity;
+    }
+#endif
+
+#if SUNGROW_HAS_AVX2
+    constexpr size_t AVX2_WORDS = 16;
+    constexpr size_t AVX2_PAIRS = 8;
+    
+    SUNGROW_TARGET_AVX2 __m256i swapBytesAvx2(__m256i words) {
+        const __m256i order = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                               1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        return _mm256_shuffle_epi8(words, order);
+    }
+    
+    // Converts eight int32 lanes to scaled doubles
+    SUNGROW_TARGET_AVX2 void storeScaledAvx2(double* out, __m256i lanes, __m256d scale) {
+        _mm256_storeu_pd(out, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(lanes)), scale));
+        _mm256_storeu_pd(out + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(lanes, 1)), scale));
+    }
+    
+    SUNGROW_TARGET_AVX2 void swapWordsAvx2(const uint8_t* payload, size_t count, uint16_t* registers) {
+        size_t i = 0;
+        for (; i + AVX2_WORDS <= count; i += AVX2_WORDS) {
+            __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(payload + REGISTER_SIZE * i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(registers + i), swapBytesAvx2(raw));
+        }
+        swapWordsScalar(payload, i, count, registers);
+    }
+    
+    template <bool IsSigned>
+    SUNGROW_TARGET_AVX2 void decode16Avx2(const uint8_t* payload, size_t count, double scale, double* values, uint64_t* validity) {
+        const __m256i allOnes = _mm256_set1_epi16(static_cast<short>(INVALID_U16));
+        const __m256i signedSentinel = _mm256_set1_epi16(static_cast<short>(INVALID_S16));
+        const __m256d scaleVector = _mm256_set1_pd(scale);
+        size_t i = 0;
+        
+        for (; i + AVX2_WORDS <= count; i += AVX2_WORDS) {
+            __m256i words = swapBytesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(payload + REGISTER_SIZE * i)));
+            __m256i invalid = _mm256_cmpeq_epi16(words, allOnes);
+            if constexpr (IsSigned) {
+                invalid = _mm256_or_si256(invalid, _mm256_cmpeq_epi16(words, signedSentinel));
+            }
+            words = _mm256_andnot_si256(invalid, words);
+            
+            // packs works per 128-bit lane: words 0-7 land in bits 0-7, words 8-15 in bits 16-23
+            uint32_t packed = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_packs_epi16(invalid, _mm256_setzero_si256())));
+            uint64_t invalidBits = (packed & 0xFF) | ((packed >> 8) & 0xFF00);
+            setValidBits(validity, i, ~invalidBits & 0xFFFF);
+            
+            __m256i low;
+            __m256i high;
+            if constexpr (IsSigned) {
+                low = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(words));
+                high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(words, 1));
+            } else {
+                low = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(words));
+                high = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(words, 1));
+            }
+            storeScaledAvx2(values + i, low, scaleVector);
+            storeScaledAvx2(values + i + 8, high, scaleVector);
+        }
+        
+        if constexpr (IsSigned) {
+            decodeS16Scalar(payload, i, count, scale, values, validity);
+        } else {
+            decodeU16Scalar(payload, i, count, scale, values, validity);
+        }
+    }
+    
+    SUNGROW_TARGET_AVX2 void decodeU32Avx2(const uint8_t* payload, size_t count, double scale, double* values, uint64_t* validity) {
+        const __m256i order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                               3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        const __m256i allOnes = _mm256_set1_epi32(-1);
+        const __m256i exponent = _mm256_set1_epi64x(static_cast<long long>(DOUBLE_EXPONENT_2_52));
+        const __m256d bias = _mm256_set1_pd(TWO_POW_52);
+        const __m256d scaleVector = _mm256_set1_pd(scale);
+        size_t i = 0;
+        
+        for (; i + AVX2_PAIRS <= count; i += AVX2_PAIRS) {
+            __m256i pairs = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(payload + 2 * REGISTER_SIZE * i)), order);
+            __m256i invalid = _mm256_cmpeq_epi32(pairs, allOnes);
+            pairs = _mm256_andnot_si256(invalid, pairs);
+            setValidBits(validity, i, ~static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(invalid))) & 0xFF);
+            
+            // Unsigned lanes become exact doubles as 2^52 + value, minus 2^52
+            __m256i low = _mm256_or_si256(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(pairs)), exponent);
+            __m256i high = _mm256_or_si256(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(pairs, 1)), exponent);
+            _mm256_storeu_pd(values + i, _mm256_mul_pd(_mm256_sub_pd(_mm256_castsi256_pd(low), bias), scaleVector));
+            _mm256_storeu_pd(values + i + 4, _mm256_mul_pd(_mm256_sub_pd(_mm256_castsi256_pd(high), bias), scaleVector));
+        }
+        decodeU32Scalar(payload, i, count, scale, values, validity);
+    }
+    
+    SUNGROW_TARGET_AVX2 __m256i loadLanesAvx2(const uint32_t* lanes) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+    }
+    
+    SUNGROW_TARGET_AVX2 uint64_t decodeLanesAvx2(const LaneLayout& layout, const uint32_t* raw, double* values) {
+        const __m256i exponent = _mm256_set1_epi64x(static_cast<long long>(DOUBLE_EXPONENT_2_52));
+        const __m256d bias = _mm256_set1_pd(TWO_POW_52);
+        uint64_t validity = 0;
+        
+        for (size_t i = 0; i < layout.count; i += AVX2_PAIRS) {
+            __m256i words = loadLanesAvx2(raw + i);
+            __m256i invalid = _mm256_or_si256(_mm256_cmpeq_epi32(words, loadLanesAvx2(layout.sentinels.data() + i)),
+                                              _mm256_cmpeq_epi32(words, loadLanesAvx2(layout.altSentinels.data() + i)));
+            words = _mm256_andnot_si256(invalid, words);
+            validity |= (~static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(invalid))) & 0xFF) << i;
+            __m256i signs = _mm256_and_si256(words, loadLanesAvx2(layout.signBits.data() + i));
+            
+            __m256i lowWords = _mm256_or_si256(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(words)), exponent);
+            __m256i highWords = _mm256_or_si256(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(words, 1)), exponent);
+            __m256d low = _mm256_sub_pd(_mm256_castsi256_pd(lowWords), bias);
+            __m256d high = _mm256_sub_pd(_mm256_castsi256_pd(highWords), bias);
+            __m256d signLow = _mm256_cvtepi32_pd(_mm256_castsi256_si128(signs));
+            __m256d signHigh = _mm256_cvtepi32_pd(_mm256_extracti128_si256(signs, 1));
+            low = _mm256_sub_pd(_mm256_sub_pd(low, signLow), signLow);
+            high = _mm256_sub_pd(_mm256_sub_pd(high, signHigh), signHigh);
+            _mm256_storeu_pd(values + i, _mm256_mul_pd(low, _mm256_loadu_pd(layout.scales.data() + i)));
+            _mm256_storeu_pd(values + i + 4, _mm256_mul_pd(high, _mm256_loadu_pd(layout.scales.data() + i + 4)));
+        }
+        return validity;
+    }
+#endif
+}
+
+ModbusDataConverter::ModbusDataConverter() : _simdLevel(getSupportedSimdLevel()) {}
+
+simd_level ModbusDataConverter::getSimdLevel() const {
+    return _simdLevel;
+}
+
+void ModbusDataConverter::setSimdLevel(simd_level level) {
+    _simdLevel = std::min(level, getSupportedSimdLevel());
+}
 
 uint16_t ModbusDataConverter::convertU16(uint16_t rawValue) const {
     if (isInvalidU16(rawValue)) return 0;
@@ -36,4 +367,102 @@ bool ModbusDataConverter::isInvalidU16(uint16_t value) const {
 
 bool ModbusDataConverter::isInvalidU32(uint16_t highWord, uint16_t lowWord) const {
     return highWord == 0xFFFF && lowWord == 0xFFFF;
+}
+
+size_t ModbusDataConverter::decodeBlock(std::span<const uint8_t> payload, register_type type, double scale,
+                                        std::span<double> values, std::span<uint64_t> validity) const {
+    size_t count = getValueCount(payload.size(), type);
+    if (values.size() < count || validity.size() * VALIDITY_WORD_BITS < count) {
+        throw std::invalid_argument("Decode buffers too small for the register block");
+    }
+    std::fill(validity.begin(), validity.begin() + (count + VALIDITY_WORD_BITS - 1) / VALIDITY_WORD_BITS, 0);
+    
+    const uint8_t* bytes = payload.data();
+    switch (type) {
+        case register_type::U16:
+#if SUNGROW_HAS_AVX2
+            if (_simdLevel == simd_level::AVX2) { decode16Avx2<false>(bytes, count, scale, values.data(), validity.data()); break; }
+#endif
+#if SUNGROW_HAS_SSE2
+            if (_simdLevel >= simd_level::SSE2) { decode16Sse2<false>(bytes, count, scale, values.data(), validity.data()); break; }
+#endif
+            decodeU16Scalar(bytes, 0, count, scale, values.data(), validity.data());
+            break;
+        case register_type::S16:
+#if SUNGROW_HAS_AVX2
+            if (_simdLevel == simd_level::AVX2) { decode16Avx2<true>(bytes, count, scale, values.data(), validity.data()); break; }
+#endif
+#if SUNGROW_HAS_SSE2
+            if (_simdLevel >= simd_level::SSE2) { decode16Sse2<true>(bytes, count, scale, values.data(), validity.data()); break; }
+#endif
+            decodeS16Scalar(bytes, 0, count, scale, values.data(), validity.data());
+            break;
+        case register_type::U32:
+#if SUNGROW_HAS_AVX2
+            if (_simdLevel == simd_level::AVX2) { decodeU32Avx2(bytes, count, scale, values.data(), validity.data()); break; }
+#endif
+#if SUNGROW_HAS_SSE2
+            if (_simdLevel >= simd_level::SSE2) { decodeU32Sse2(bytes, count, scale, values.data(), validity.data()); break; }
+#endif
+            decodeU32Scalar(bytes, 0, count, scale, values.data(), validity.data());
+            break;
+        case register_type::UTF8:
+            break;
+    }
+    return count;
+}
+
+uint64_t ModbusDataConverter::decodeLanes(const LaneLayout& layout, std::span<const uint32_t> raw, std::span<double> values) const {
+    if (raw.size() < LaneLayout::MAX_LANES || values.size() < LaneLayout::MAX_LANES) {
+        throw std::invalid_argument("Decode buffers need a slot for every lane of a layout");
+    }
+    
+    // The vector paths also judge the padding lanes past count
+    uint64_t laneMask = (uint64_t{1} << layout.count) - 1;
+#if SUNGROW_HAS_AVX2
+    if (_simdLevel == simd_level::AVX2) {
+        return decodeLanesAvx2(layout, raw.data(), values.data()) & laneMask;
+    }
+#endif
+#if SUNGROW_HAS_SSE2
+    if (_simdLevel >= simd_level::SSE2) {
+        return decodeLanesSse2(layout, raw.data(), values.data()) & laneMask;
+    }
+#endif
+    return decodeLanesScalar(layout, raw.data(), values.data());
+}
+
+size_t ModbusDataConverter::getValueCount(size_t payloadSize, register_type type) {
+    switch (type) {
+        case register_type::U16:
+        case register_type::S16: return payloadSize / REGISTER_SIZE;
+        case register_type::U32: return payloadSize / (2 * REGISTER_SIZE);
+        case register_type::UTF8: return 0;
+    }
+    return 0;
+}
+
+simd_level ModbusDataConverter::getSupportedSimdLevel() {
+#if SUNGROW_HAS_AVX2
+    static const simd_level SUPPORTED = __builtin_cpu_supports("avx2") ? simd_level::AVX2 : simd_level::SSE2;
+    return SUPPORTED;
+#elif SUNGROW_HAS_SSE2
+    return simd_level::SSE2;
+#else
+    return simd_level::SCALAR;
+#endif
+}
+
+void ModbusDataConverter::swapWords(const uint8_t* payload, size_t count, uint16_t* registers) {
+#if SUNGROW_HAS_AVX2
+    if (getSupportedSimdLevel() == simd_level::AVX2) {
+        swapWordsAvx2(payload, count, registers);
+        return;
+    }
+#endif
+#if SUNGROW_HAS_SSE2
+    swapWordsSse2(payload, count, registers);
+#else
+    swapWordsScalar(payload, 0, count, registers);
+#endif
 }
\ No newline at end of file
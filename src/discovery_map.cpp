@@ -0,0 +1,292 @@
+#include "discovery_map.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+    constexpr char DISCOVERY_MAGIC[8] = {'S', 'G', 'D', 'M', 'A', 'P', 0, 1};
+    constexpr char IDENTITY_MAGIC[8] = {'S', 'G', 'I', 'D', 'C', 'A', 0, 1};
+
+    // Fixed-size records in host byte order, like the sample store
+    struct DeviceHeader {
+        uint16_t deviceCode;
+        uint16_t serialLength;
+        uint16_t readableCount;
+        uint16_t illegalCount;
+    };
+
+    struct EndpointHeader {
+        uint16_t port;
+        uint8_t slaveId;
+        uint8_t reserved;
+        uint16_t hostLength;
+        uint16_t deviceCode;
+        uint16_t serialLength;
+        uint16_t illegalCount;
+    };
+
+    struct RangeRecord {
+        uint16_t startAddr;
+        uint16_t count;
+        uint8_t functionCode;
+        uint8_t reserved[3];
+    };
+
+    template <typename Record>
+    bool readRecord(const std::vector<char>& bytes, size_t& offset, Record& record) {
+        if (bytes.size() - offset < sizeof(Record)) {
+            return false;
+        }
+        std::memcpy(&record, bytes.data() + offset, sizeof(Record));
+        offset += sizeof(Record);
+        return true;
+    }
+
+    bool readRanges(const std::vector<char>& bytes, size_t& offset, uint16_t count, std::vector<RegisterRange>& ranges) {
+        for (uint16_t i = 0; i < count; i++) {
+            RangeRecord record;
+            if (!readRecord(bytes, offset, record)) {
+                return false;
+            }
+            ranges.push_back({record.startAddr, record.count, record.functionCode});
+        }
+        return true;
+    }
+
+    bool readString(const std::vector<char>& bytes, size_t& offset, uint16_t length, std::string& text) {
+        if (bytes.size() - offset < length) {
+            return false;
+        }
+        text.assign(bytes.data() + offset, length);
+        offset += length;
+        return true;
+    }
+
+    // The file's bytes after its magic and record count, or false if it is not of that kind
+    bool readFile(const std::string& path, const char (&magic)[8], std::vector<char>& bytes, size_t& offset, uint32_t& recordCount) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            return false;
+        }
+        bytes.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        offset = sizeof(magic);
+        return bytes.size() >= offset && std::memcmp(bytes.data(), magic, sizeof(magic)) == 0 &&
+               readRecord(bytes, offset, recordCount);
+    }
+
+    // Writes to a temporary file and renames it over path, so readers see
+    // the old file or the new one, never a partial write
+    template <typename WriteRecords>
+    void writeFile(const std::string& path, const char (&magic)[8], uint32_t recordCount, WriteRecords writeRecords) {
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!output) {
+                throw std::runtime_error("Cannot write " + temporaryPath);
+            }
+            output.write(magic, sizeof(magic));
+            output.write(reinterpret_cast<const char*>(&recordCount), sizeof(recordCount));
+            writeRecords(output);
+            if (!output.flush()) {
+                throw std::runtime_error("Cannot write " + temporaryPath);
+            }
+        }
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Cannot replace " + path + ": " + std::strerror(errno));
+        }
+    }
+
+    void writeRanges(std::ofstream& output, const std::vector<RegisterRange>& ranges) {
+        for (const auto& range : ranges) {
+            RangeRecord record{range.startAddr, range.count, range.functionCode, {}};
+            output.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        }
+    }
+
+    struct ScannedArea {
+        uint8_t functionCode;
+        uint32_t start;
+        uint32_t end;
+    };
+
+    // Removes what the areas cover from ranges, trimming ranges that straddle an edge
+    void clipRanges(std::vector<RegisterRange>& ranges, const std::vector<ScannedArea>& areas) {
+        std::vector<RegisterRange> kept;
+        for (const auto& range : ranges) {
+            uint32_t start = range.startAddr;
+            uint32_t end = start + range.count;
+            for (const auto& area : areas) {
+                if (area.functionCode != range.functionCode || area.end <= start || area.start >= end) {
+                    continue;
+                }
+                if (area.start > start) {
+                    kept.push_back({static_cast<uint16_t>(start), static_cast<uint16_t>(area.start - start), range.functionCode});
+                }
+                start = std::max(start, area.end);
+            }
+            if (start < end) {
+                kept.push_back({static_cast<uint16_t>(start), static_cast<uint16_t>(end - start), range.functionCode});
+            }
+        }
+        ranges = std::move(kept);
+    }
+
+    void replaceRanges(std::vector<RegisterRange>& ranges, const std::vector<RegisterRange>& replacements,
+                       const std::vector<ScannedArea>& areas) {
+        clipRanges(ranges, areas);
+        ranges.insert(ranges.end(), replacements.begin(), replacements.end());
+        std::sort(ranges.begin(), ranges.end(), [](const RegisterRange& a, const RegisterRange& b) {
+            return a.functionCode != b.functionCode ? a.functionCode < b.functionCode : a.startAddr < b.startAddr;
+        });
+    }
+}
+
+bool DiscoveryMap::load(const std::string& path) {
+    std::vector<char> bytes;
+    size_t offset = 0;
+    uint32_t deviceCount = 0;
+    if (!readFile(path, DISCOVERY_MAGIC, bytes, offset, deviceCount)) {
+        return false;
+    }
+
+    std::vector<DiscoveredDevice> devices;
+    for (uint32_t i = 0; i < deviceCount; i++) {
+        DeviceHeader header;
+        DiscoveredDevice device;
+        if (!readRecord(bytes, offset, header) || !readString(bytes, offset, header.serialLength, device.serialNumber) ||
+            !readRanges(bytes, offset, header.readableCount, device.readable) ||
+            !readRanges(bytes, offset, header.illegalCount, device.illegal)) {
+            return false;
+        }
+        device.deviceCode = header.deviceCode;
+        devices.push_back(std::move(device));
+    }
+
+    _devices = std::move(devices);
+    return true;
+}
+
+void DiscoveryMap::save(const std::string& path) const {
+    writeFile(path, DISCOVERY_MAGIC, static_cast<uint32_t>(_devices.size()), [this](std::ofstream& output) {
+        for (const auto& device : _devices) {
+            DeviceHeader header{device.deviceCode, static_cast<uint16_t>(device.serialNumber.size()),
+                                static_cast<uint16_t>(device.readable.size()), static_cast<uint16_t>(device.illegal.size())};
+            output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            output.write(device.serialNumber.data(), static_cast<std::streamsize>(device.serialNumber.size()));
+            writeRanges(output, device.readable);
+            writeRanges(output, device.illegal);
+        }
+    });
+}
+
+const std::vector<DiscoveredDevice>& DiscoveryMap::getDevices() const {
+    return _devices;
+}
+
+const DiscoveredDevice* DiscoveryMap::findDevice(uint16_t deviceCode, std::string_view serialNumber) const {
+    auto device = std::find_if(_devices.begin(), _devices.end(), [&](const DiscoveredDevice& candidate) {
+        return candidate.deviceCode == deviceCode && candidate.serialNumber == serialNumber;
+    });
+    return device != _devices.end() ? &*device : nullptr;
+}
+
+void DiscoveryMap::mergeDevice(const DiscoveredDevice& device) {
+    auto existing = std::find_if(_devices.begin(), _devices.end(), [&](const DiscoveredDevice& candidate) {
+        return candidate.deviceCode == device.deviceCode && candidate.serialNumber == device.serialNumber;
+    });
+    if (existing == _devices.end()) {
+        _devices.push_back(device);
+        return;
+    }
+
+    // The new scan is authoritative from its first to its last answered register
+    std::vector<ScannedArea> areas;
+    for (const auto* ranges : {&device.readable, &device.illegal}) {
+        for (const auto& range : *ranges) {
+            uint32_t end = static_cast<uint32_t>(range.startAddr) + range.count;
+            auto area = std::find_if(areas.begin(), areas.end(), [&](const ScannedArea& candidate) {
+                return candidate.functionCode == range.functionCode;
+            });
+            if (area == areas.end()) {
+                areas.push_back({range.functionCode, range.startAddr, end});
+            } else {
+                area->start = std::min<uint32_t>(area->start, range.startAddr);
+                area->end = std::max(area->end, end);
+            }
+        }
+    }
+    replaceRanges(existing->readable, device.readable, areas);
+    replaceRanges(existing->illegal, device.illegal, areas);
+}
+
+std::mutex IdentityCache::_storeMutex;
+
+bool IdentityCache::load(const std::string& path) {
+    std::vector<char> bytes;
+    size_t offset = 0;
+    uint32_t endpointCount = 0;
+    if (!readFile(path, IDENTITY_MAGIC, bytes, offset, endpointCount)) {
+        return false;
+    }
+
+    std::vector<CachedIdentity> endpoints;
+    for (uint32_t i = 0; i < endpointCount; i++) {
+        EndpointHeader header;
+        CachedIdentity identity;
+        if (!readRecord(bytes, offset, header) || !readString(bytes, offset, header.hostLength, identity.host) ||
+            !readString(bytes, offset, header.serialLength, identity.serialNumber) ||
+            !readRanges(bytes, offset, header.illegalCount, identity.illegal)) {
+            return false;
+        }
+        identity.port = header.port;
+        identity.slaveId = header.slaveId;
+        identity.deviceCode = header.deviceCode;
+        endpoints.push_back(std::move(identity));
+    }
+
+    _endpoints = std::move(endpoints);
+    return true;
+}
+
+void IdentityCache::save(const std::string& path) const {
+    writeFile(path, IDENTITY_MAGIC, static_cast<uint32_t>(_endpoints.size()), [this](std::ofstream& output) {
+        for (const auto& identity : _endpoints) {
+            EndpointHeader header{identity.port, identity.slaveId, 0, static_cast<uint16_t>(identity.host.size()), identity.deviceCode,
+                                  static_cast<uint16_t>(identity.serialNumber.size()), static_cast<uint16_t>(identity.illegal.size())};
+            output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            output.write(identity.host.data(), static_cast<std::streamsize>(identity.host.size()));
+            output.write(identity.serialNumber.data(), static_cast<std::streamsize>(identity.serialNumber.size()));
+            writeRanges(output, identity.illegal);
+        }
+    });
+}
+
+const CachedIdentity* IdentityCache::findEndpoint(const std::string& host, uint16_t port, uint8_t slaveId) const {
+    auto identity = std::find_if(_endpoints.begin(), _endpoints.end(), [&](const CachedIdentity& candidate) {
+        return candidate.host == host && candidate.port == port && candidate.slaveId == slaveId;
+    });
+    return identity != _endpoints.end() ? &*identity : nullptr;
+}
+
+void IdentityCache::setEndpoint(const CachedIdentity& identity) {
+    auto existing = std::find_if(_endpoints.begin(), _endpoints.end(), [&](const CachedIdentity& candidate) {
+        return candidate.host == identity.host && candidate.port == identity.port && candidate.slaveId == identity.slaveId;
+    });
+    if (existing == _endpoints.end()) {
+        _endpoints.push_back(identity);
+    } else {
+        *existing = identity;
+    }
+}
+
+void IdentityCache::store(const std::string& path, const CachedIdentity& identity) {
+    std::lock_guard<std::mutex> lock(_storeMutex);
+    IdentityCache cache;
+    cache.load(path);
+    cache.setEndpoint(identity);
+    cache.save(path);
+}
@@ -0,0 +1,54 @@
+#include "frame_buffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+size_t FrameBuffer::getSize() const {
+    return _size;
+}
+
+size_t FrameBuffer::getFreeSpace() const {
+    return CAPACITY - _size;
+}
+
+bool FrameBuffer::isEmpty() const {
+    return _size == 0;
+}
+
+std::span<uint8_t> FrameBuffer::getWritableSpan() {
+    if (_size == 0) {
+        _head = 0;
+    }
+
+    size_t tail = (_head + _size) % CAPACITY;
+    size_t contiguous = (tail >= _head && _size != CAPACITY) ? CAPACITY - tail : _head - tail;
+    return {_storage.data() + tail, contiguous};
+}
+
+void FrameBuffer::commit(size_t count) {
+    if (count > getFreeSpace()) {
+        throw std::length_error("FrameBuffer overflow");
+    }
+    _size += count;
+}
+
+uint8_t FrameBuffer::peek(size_t offset) const {
+    return _storage[(_head + offset) % CAPACITY];
+}
+
+void FrameBuffer::copyOut(uint8_t* destination, size_t count) const {
+    size_t firstPart = std::min(count, CAPACITY - _head);
+    std::memcpy(destination, _storage.data() + _head, firstPart);
+    std::memcpy(destination + firstPart, _storage.data(), count - firstPart);
+}
+
+void FrameBuffer::consume(size_t count) {
+    count = std::min(count, _size);
+    _head = (_head + count) % CAPACITY;
+    _size -= count;
+}
+
+void FrameBuffer::clear() {
+    _head = 0;
+    _size = 0;
+}
@@ -0,0 +1,96 @@
+#include "frame_capture.hpp"
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+    constexpr char CAPTURE_MAGIC[8] = {'S', 'G', 'C', 'A', 'P', 'T', 0, 1};
+
+    // Fixed-size records in host byte order, like the sample store
+    struct FileHeader {
+        int64_t startTimeUs;  // System clock, microseconds since the epoch
+    };
+
+    struct RecordHeader {
+        int64_t offsetUs;
+        uint16_t size;
+        uint8_t type;
+        uint8_t reserved[5];
+    };
+}
+
+bool FrameCapture::load(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return false;
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    FileHeader header;
+    size_t offset = sizeof(CAPTURE_MAGIC) + sizeof(header);
+    if (bytes.size() < offset || std::memcmp(bytes.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+        return false;
+    }
+    std::memcpy(&header, bytes.data() + sizeof(CAPTURE_MAGIC), sizeof(header));
+
+    std::vector<CaptureRecord> loaded;
+    RecordHeader record;
+    while (bytes.size() - offset >= sizeof(record)) {
+        std::memcpy(&record, bytes.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        if (record.type > static_cast<uint8_t>(capture_record::RX) || bytes.size() - offset < record.size) {
+            break;
+        }
+        const uint8_t* frame = reinterpret_cast<const uint8_t*>(bytes.data() + offset);
+        loaded.push_back({static_cast<capture_record>(record.type), std::chrono::microseconds(record.offsetUs),
+                          std::vector<uint8_t>(frame, frame + record.size)});
+        offset += record.size;
+    }
+
+    startTime = std::chrono::system_clock::time_point(std::chrono::microseconds(header.startTimeUs));
+    records = std::move(loaded);
+    return true;
+}
+
+std::chrono::microseconds FrameCapture::getDuration() const {
+    return records.empty() ? std::chrono::microseconds(0) : records.back().offset;
+}
+
+FrameCaptureWriter::FrameCaptureWriter(const std::string& path)
+    : _output(path, std::ios::binary | std::ios::trunc), _startTime(std::chrono::steady_clock::now()) {
+    if (!_output) {
+        throw std::runtime_error("Cannot create capture file " + path);
+    }
+
+    FileHeader header{std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count()};
+    _output.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    _output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    _output.flush();
+}
+
+void FrameCaptureWriter::recordConnected() {
+    _write(capture_record::CONNECTED, {});
+}
+
+void FrameCaptureWriter::recordFrame(frame_direction direction, std::span<const uint8_t> frame) {
+    _write(direction == frame_direction::TX ? capture_record::TX : capture_record::RX, frame);
+}
+
+uint64_t FrameCaptureWriter::getRecordCount() const {
+    return _records;
+}
+
+void FrameCaptureWriter::_write(capture_record type, std::span<const uint8_t> bytes) {
+    auto offset = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _startTime);
+    RecordHeader record{offset.count(), static_cast<uint16_t>(bytes.size()), static_cast<uint8_t>(type), {}};
+    _output.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    _output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    // A response ends an exchange; flushing there keeps a killed monitor's
+    // capture replayable up to its last answered request
+    if (type != capture_record::TX) {
+        _output.flush();
+    }
+    ++_records;
+}
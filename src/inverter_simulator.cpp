@@ -0,0 +1,558 @@
+#include "inverter_simulator.hpp"
+#include "sungrow_crypto.hpp"
+#include "trace.hpp"
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using boost::asio::ip::tcp;
+
+namespace {
+    constexpr uint8_t READ_HOLDING_REGISTERS = 0x03;
+    constexpr uint8_t READ_INPUT_REGISTERS = 0x04;
+    constexpr uint8_t EXCEPTION_FLAG = 0x80;
+    constexpr uint8_t ILLEGAL_FUNCTION = 1;
+    constexpr uint8_t ILLEGAL_DATA_ADDRESS = 2;
+    constexpr uint8_t ILLEGAL_DATA_VALUE = 3;
+
+    constexpr size_t MBAP_HEADER_SIZE = 6;
+    constexpr size_t READ_REQUEST_SIZE = 12;
+    constexpr uint16_t MAX_READ_REGISTERS = 125;
+    constexpr uint16_t MAX_MBAP_LENGTH = 254;
+    constexpr size_t PUBLIC_KEY_SIZE = 16;
+    constexpr size_t CRYPTO_PADDING_OFFSET = 3;  // Padding length byte of the crypto header
+    constexpr auto WRITE_CHUNK_PAUSE = std::chrono::milliseconds(2);
+
+    // Key exchange command: unit 0xF7 reading 8 input registers from 2791
+    constexpr uint8_t KEY_EXCHANGE_UNIT = 0xF7;
+    constexpr uint16_t KEY_EXCHANGE_ADDRESS = 0x0AE7;
+
+    constexpr size_t MAX_RESPONSE_SIZE = MBAP_HEADER_SIZE + 3 + MAX_READ_REGISTERS * 2;
+    constexpr size_t RESPONSE_CAPACITY = SungrowCrypto::CRYPTO_HEADER_SIZE + SungrowCrypto::getPaddedSize(MAX_RESPONSE_SIZE);
+
+    uint16_t readU16(const uint8_t* data) {
+        return (static_cast<uint16_t>(data[0]) << 8) | data[1];
+    }
+
+    void writeU16(uint8_t* data, uint16_t value) {
+        data[0] = (value >> 8) & 0xFF;
+        data[1] = value & 0xFF;
+    }
+}
+
+SimulatedRegisterMap::SimulatedRegisterMap() = default;
+
+void SimulatedRegisterMap::set(uint8_t functionCode, uint16_t address, uint16_t value) {
+    if (Table* table = _getTable(functionCode)) {
+        table->values[address] = value;
+        table->isValid[address] = true;
+    }
+}
+
+void SimulatedRegisterMap::setU32(uint8_t functionCode, uint16_t address, uint32_t value) {
+    set(functionCode, address, static_cast<uint16_t>(value >> 16));
+    set(functionCode, address + 1, static_cast<uint16_t>(value & 0xFFFF));
+}
+
+void SimulatedRegisterMap::setString(uint8_t functionCode, uint16_t address, const std::string& text, uint16_t registerCount) {
+    for (uint16_t i = 0; i < registerCount; i++) {
+        size_t offset = 2 * static_cast<size_t>(i);
+        uint8_t high = offset < text.size() ? text[offset] : 0;
+        uint8_t low = offset + 1 < text.size() ? text[offset + 1] : 0;
+        set(functionCode, address + i, (static_cast<uint16_t>(high) << 8) | low);
+    }
+}
+
+void SimulatedRegisterMap::setRange(uint8_t functionCode, uint16_t address, uint16_t count, uint16_t value) {
+    for (uint16_t i = 0; i < count; i++) {
+        set(functionCode, address + i, value);
+    }
+}
+
+bool SimulatedRegisterMap::read(uint8_t functionCode, uint16_t address, uint16_t count, uint16_t* values) const {
+    const Table* table = _getTable(functionCode);
+    if (!table || static_cast<size_t>(address) + count > ADDRESS_SPACE) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (!table->isValid[address + i]) {
+            return false;
+        }
+        values[i] = table->values[address + i];
+    }
+    return true;
+}
+
+bool SimulatedRegisterMap::isSupported(uint8_t functionCode) const {
+    return _getTable(functionCode) != nullptr;
+}
+
+bool SimulatedRegisterMap::loadFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open register image " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        std::string kind;
+        std::string address;
+        std::string value;
+        if (!(fields >> kind)) {
+            continue;
+        }
+
+        try {
+            fields >> address >> value;
+            uint8_t functionCode = kind == "holding" ? READ_HOLDING_REGISTERS : READ_INPUT_REGISTERS;
+            if (kind != "holding" && kind != "input") {
+                throw std::invalid_argument(kind);
+            }
+            set(functionCode, static_cast<uint16_t>(std::stoul(address, nullptr, 0)), static_cast<uint16_t>(std::stoul(value, nullptr, 0)));
+        }
+        catch (const std::exception&) {
+            std::cerr << path << ":" << lineNumber << ": expected \"<input|holding> <address> <value>\"" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+SimulatedRegisterMap SimulatedRegisterMap::createDefault() {
+    SimulatedRegisterMap registers;
+    const uint8_t INPUT = READ_INPUT_REGISTERS;
+    const uint8_t HOLDING = READ_HOLDING_REGISTERS;
+
+    // The whole documented SG8K-D block answers; unlisted registers read 0
+    registers.setRange(INPUT, 4989, 5200 - 4989, 0);
+    registers.setRange(HOLDING, 4999, 5010 - 4999, 0);
+
+    registers.setString(INPUT, 4989, "A211055509", 10);
+    registers.set(INPUT, 4999, 0x2403);                // SG8K-D device code
+    registers.setU32(INPUT, 5003, 168);                // Production today, 16.8 kWh
+    registers.set(INPUT, 5008, 217);                   // Internal temperature, 21.7 C
+    registers.set(INPUT, 5019, 2444);                  // Phase A voltage, 244.4 V
+    registers.set(INPUT, 5022, 31);                    // Phase A current, 3.1 A
+    registers.setU32(INPUT, 5031, 0);                  // Total active power, W
+    registers.set(INPUT, 5035, 500);                   // Grid frequency, 50.0 Hz
+    registers.set(INPUT, 5038, 0x1300);                // Work state: initial standby
+    registers.set(INPUT, 5071, 993);                   // Insulation resistance, k-ohm
+    registers.setU32(INPUT, 5082, 746);                // Meter power, W
+    registers.setU32(INPUT, 5090, 746);                // Load power, W
+    registers.setU32(INPUT, 5092, 131);                // Daily export, 13.1 kWh
+    registers.setU32(INPUT, 5094, 212708);             // Total export, 21270.8 kWh
+    registers.setU32(INPUT, 5096, 118);                // Daily import, 11.8 kWh
+    registers.setU32(INPUT, 5098, 237925);             // Total import, 23792.5 kWh
+    registers.setU32(INPUT, 5100, 37);                 // Daily direct consumption, 3.7 kWh
+    registers.setU32(INPUT, 5102, 217543);             // Total direct consumption, 21754.3 kWh
+    registers.set(INPUT, 5113, 1305);                  // Daily running time, min
+    registers.setU32(INPUT, 5144, 430251);             // Total power yields, 43025.1 kWh
+
+    registers.set(HOLDING, 4999, 2025);
+    registers.set(HOLDING, 5000, 8);
+    registers.set(HOLDING, 5001, 7);
+    registers.set(HOLDING, 5002, 21);
+    registers.set(HOLDING, 5003, 42);
+    registers.set(HOLDING, 5004, 13);
+    registers.set(HOLDING, 5006, 0xCF);                // Start/stop: started
+
+    return registers;
+}
+
+SimulatedRegisterMap::Table* SimulatedRegisterMap::_getTable(uint8_t functionCode) {
+    return const_cast<Table*>(static_cast<const SimulatedRegisterMap*>(this)->_getTable(functionCode));
+}
+
+const SimulatedRegisterMap::Table* SimulatedRegisterMap::_getTable(uint8_t functionCode) const {
+    switch (functionCode) {
+        case READ_HOLDING_REGISTERS: return &_holding;
+        case READ_INPUT_REGISTERS: return &_input;
+        default: return nullptr;
+    }
+}
+
+// One client connection. Requests are answered strictly in order, one at a
+// time, like the single-threaded Modbus task on the real dongle, unless a
+// reorder window is set for testing.
+class SimulatorSession : public std::enable_shared_from_this<SimulatorSession> {
+public:
+    SimulatorSession(InverterSimulator& simulator, tcp::socket socket)
+        : _simulator(simulator), _socket(std::move(socket)), _delayTimer(_socket.get_executor()),
+          _chunkTimer(_socket.get_executor()) {
+        _txActive.reserve(RESPONSE_CAPACITY * 4);
+        _txPending.reserve(RESPONSE_CAPACITY * 4);
+    }
+
+    void start() {
+        _readMore();
+    }
+
+private:
+    void _readMore() {
+        auto writable = _rxBuffer.getWritableSpan();
+        if (writable.empty()) {
+            std::cerr << "Simulator: request buffer full, dropping connection" << std::endl;
+            return;
+        }
+
+        _socket.async_read_some(boost::asio::buffer(writable.data(), writable.size()),
+            [self = shared_from_this()](const boost::system::error_code& error, size_t bytesRead) {
+                if (error) {
+                    return;
+                }
+                self->_rxBuffer.commit(bytesRead);
+                self->_processRequests();
+            });
+    }
+
+    void _processRequests() {
+        while (!_isDelaying) {
+            size_t frameSize = _nextFrameSize();
+            if (frameSize == 0 || _rxBuffer.getSize() < frameSize) {
+                break;
+            }
+            if (frameSize > _request.size()) {
+                std::cerr << "Simulator: malformed request stream, dropping connection" << std::endl;
+                return;
+            }
+
+            _rxBuffer.copyOut(_request.data(), frameSize);
+            _rxBuffer.consume(frameSize);
+            _handleRequest(std::span<uint8_t>(_request.data(), frameSize));
+
+            if (_simulator._responseDelay > std::chrono::milliseconds::zero()) {
+                _isDelaying = true;
+                _delayTimer.expires_after(_simulator._responseDelay);
+                _delayTimer.async_wait([self = shared_from_this()](const boost::system::error_code& error) {
+                    if (error) {
+                        return;
+                    }
+                    self->_isDelaying = false;
+                    self->_flushResponse();
+                    self->_processRequests();
+                });
+                return;
+            }
+            _flushResponse();
+        }
+
+        _readMore();
+    }
+
+    size_t _nextFrameSize() const {
+        if (_isEncrypted) {
+            if (_rxBuffer.getSize() < SungrowCrypto::CRYPTO_HEADER_SIZE) {
+                return 0;
+            }
+            uint8_t header[SungrowCrypto::CRYPTO_HEADER_SIZE];
+            _rxBuffer.copyOut(header, sizeof(header));
+            size_t frameSize = SungrowCrypto::getEncryptedFrameSize(header, sizeof(header));
+            return frameSize == 0 ? _request.size() + 1 : frameSize;
+        }
+
+        if (_rxBuffer.getSize() < MBAP_HEADER_SIZE) {
+            return 0;
+        }
+        uint16_t length = (static_cast<uint16_t>(_rxBuffer.peek(4)) << 8) | _rxBuffer.peek(5);
+        return length == 0 || length > MAX_MBAP_LENGTH ? _request.size() + 1 : MBAP_HEADER_SIZE + length;
+    }
+
+    void _handleRequest(std::span<uint8_t> frame) {
+        const uint8_t* request = frame.data();
+        size_t requestSize = frame.size();
+
+        if (_isEncrypted) {
+            size_t plainSize = _crypto.decryptFrameInPlace(frame);
+            if (plainSize == 0) {
+                std::cerr << "Simulator: request could not be decrypted" << std::endl;
+                return;
+            }
+            request += SungrowCrypto::CRYPTO_HEADER_SIZE;
+            requestSize = plainSize;
+        }
+
+        if (requestSize < READ_REQUEST_SIZE) {
+            return;
+        }
+        auto fault = _simulator._takeResponseFault(++_simulator._requestCount);
+        if (fault == InverterSimulator::response_fault::DROP) {
+            return;
+        }
+
+        uint16_t transactionId = readU16(request);
+        uint8_t unitId = request[6];
+        uint8_t functionCode = request[7];
+        uint16_t address = readU16(request + 8);
+        uint16_t count = readU16(request + 10);
+
+        if (!_isEncrypted && unitId == KEY_EXCHANGE_UNIT && address == KEY_EXCHANGE_ADDRESS) {
+            _answerKeyExchange(transactionId, unitId, functionCode);
+            return;
+        }
+
+        uint8_t* response = _response.data() + SungrowCrypto::CRYPTO_HEADER_SIZE;
+        size_t responseSize = 0;
+
+        std::array<uint16_t, MAX_READ_REGISTERS> values;
+        if (!_simulator._registers->isSupported(functionCode)) {
+            responseSize = _writeException(response, transactionId, unitId, functionCode, ILLEGAL_FUNCTION);
+        } else if (count == 0 || count > MAX_READ_REGISTERS) {
+            responseSize = _writeException(response, transactionId, unitId, functionCode, ILLEGAL_DATA_VALUE);
+        } else if (!_simulator._registers->read(functionCode, address, count, values.data())) {
+            responseSize = _writeException(response, transactionId, unitId, functionCode, ILLEGAL_DATA_ADDRESS);
+        } else {
+            writeU16(response, transactionId);
+            writeU16(response + 2, 0);
+            writeU16(response + 4, static_cast<uint16_t>(3 + count * 2));
+            response[6] = unitId;
+            response[7] = functionCode;
+            response[8] = static_cast<uint8_t>(count * 2);
+            for (uint16_t i = 0; i < count; i++) {
+                writeU16(response + 9 + i * 2, values[i]);
+            }
+            responseSize = MBAP_HEADER_SIZE + 3 + count * 2;
+        }
+
+        _queueResponse(responseSize);
+        if (fault == InverterSimulator::response_fault::CORRUPT && _isEncrypted) {
+            _response[CRYPTO_PADDING_OFFSET] = 0xFF;
+        }
+    }
+
+    void _answerKeyExchange(uint16_t transactionId, uint8_t unitId, uint8_t functionCode) {
+        uint8_t* response = _response.data() + SungrowCrypto::CRYPTO_HEADER_SIZE;
+
+        if (!_simulator._isEncryptionEnabled) {
+            _queueResponse(_writeException(response, transactionId, unitId, functionCode, ILLEGAL_DATA_ADDRESS));
+            return;
+        }
+
+        std::random_device random;
+        std::vector<uint8_t> publicKey(PUBLIC_KEY_SIZE);
+        for (auto& byte : publicKey) {
+            byte = static_cast<uint8_t>(random());
+        }
+
+        writeU16(response, transactionId);
+        writeU16(response + 2, 0);
+        writeU16(response + 4, static_cast<uint16_t>(3 + PUBLIC_KEY_SIZE));
+        response[6] = unitId;
+        response[7] = functionCode;
+        response[8] = PUBLIC_KEY_SIZE;
+        std::copy(publicKey.begin(), publicKey.end(), response + 9);
+
+        // The reply itself still goes out in plain Modbus
+        _queueResponse(MBAP_HEADER_SIZE + 3 + PUBLIC_KEY_SIZE);
+        _isEncrypted = _crypto.initializeEncryption(publicKey);
+    }
+
+    size_t _writeException(uint8_t* response, uint16_t transactionId, uint8_t unitId, uint8_t functionCode, uint8_t exceptionCode) {
+        writeU16(response, transactionId);
+        writeU16(response + 2, 0);
+        writeU16(response + 4, 3);
+        response[6] = unitId;
+        response[7] = functionCode | EXCEPTION_FLAG;
+        response[8] = exceptionCode;
+        return MBAP_HEADER_SIZE + 3;
+    }
+
+    void _queueResponse(size_t responseSize) {
+        if (_isEncrypted) {
+            size_t encryptedSize = _crypto.encryptFrameInPlace(_response.data(), responseSize, _response.size());
+            _responseBytes = std::span<const uint8_t>(_response.data(), encryptedSize);
+        } else {
+            _responseBytes = std::span<const uint8_t>(_response.data() + SungrowCrypto::CRYPTO_HEADER_SIZE, responseSize);
+        }
+    }
+
+    void _flushResponse() {
+        if (_responseBytes.empty()) {
+            return;
+        }
+
+        size_t reorderWindow = _simulator._getReorderWindow();
+        if (reorderWindow > 1) {
+            _heldResponses.emplace_back(_responseBytes.begin(), _responseBytes.end());
+            _responseBytes = {};
+            if (_heldResponses.size() < reorderWindow) {
+                return;
+            }
+            for (auto it = _heldResponses.rbegin(); it != _heldResponses.rend(); ++it) {
+                _txPending.insert(_txPending.end(), it->begin(), it->end());
+            }
+            _heldResponses.clear();
+        } else {
+            _txPending.insert(_txPending.end(), _responseBytes.begin(), _responseBytes.end());
+            _responseBytes = {};
+        }
+
+        if (!_isWriting) {
+            _writeNext();
+        }
+    }
+
+    void _writeNext() {
+        _isWriting = true;
+        std::swap(_txActive, _txPending);
+        _txPending.clear();
+        _txOffset = 0;
+        _writeChunk();
+    }
+
+    void _writeChunk() {
+        size_t chunkSize = _simulator._getWriteChunkSize();
+        size_t remaining = _txActive.size() - _txOffset;
+        size_t size = chunkSize == 0 ? remaining : std::min(chunkSize, remaining);
+
+        boost::asio::async_write(_socket, boost::asio::buffer(_txActive.data() + _txOffset, size),
+            [self = shared_from_this()](const boost::system::error_code& error, size_t bytesWritten) {
+                if (error) {
+                    return;
+                }
+                self->_txOffset += bytesWritten;
+                if (self->_txOffset < self->_txActive.size()) {
+                    self->_chunkTimer.expires_after(WRITE_CHUNK_PAUSE);
+                    self->_chunkTimer.async_wait([self](const boost::system::error_code& error) {
+                        if (!error) {
+                            self->_writeChunk();
+                        }
+                    });
+                } else if (self->_txPending.empty()) {
+                    self->_isWriting = false;
+                } else {
+                    self->_writeNext();
+                }
+            });
+    }
+
+    InverterSimulator& _simulator;
+    tcp::socket _socket;
+    boost::asio::steady_timer _delayTimer;
+    boost::asio::steady_timer _chunkTimer;
+    SungrowCrypto _crypto;
+    bool _isEncrypted = false;
+    bool _isDelaying = false;
+    bool _isWriting = false;
+
+    FrameBuffer _rxBuffer;
+    std::array<uint8_t, RESPONSE_CAPACITY> _request{};
+    std::array<uint8_t, RESPONSE_CAPACITY> _response{};
+    std::span<const uint8_t> _responseBytes;
+    std::vector<uint8_t> _txActive;
+    std::vector<uint8_t> _txPending;
+    size_t _txOffset = 0;
+    std::vector<std::vector<uint8_t>> _heldResponses;
+};
+
+InverterSimulator::InverterSimulator(boost::asio::io_context& ioContext, const std::string& bindAddress, uint16_t port,
+                                     std::shared_ptr<const SimulatedRegisterMap> registers)
+    : _ioContext(ioContext),
+      _acceptor(ioContext, tcp::endpoint(boost::asio::ip::make_address(bindAddress), port)),
+      _registers(std::move(registers)) {}
+
+void InverterSimulator::start() {
+    _acceptNext();
+}
+
+void InverterSimulator::stop() {
+    boost::system::error_code ignored;
+    _acceptor.close(ignored);
+}
+
+uint16_t InverterSimulator::getPort() const {
+    return _acceptor.local_endpoint().port();
+}
+
+std::chrono::milliseconds InverterSimulator::getResponseDelay() const {
+    return _responseDelay;
+}
+
+void InverterSimulator::setResponseDelay(std::chrono::milliseconds responseDelay) {
+    _responseDelay = responseDelay;
+}
+
+bool InverterSimulator::isEncryptionEnabled() const {
+    return _isEncryptionEnabled;
+}
+
+void InverterSimulator::setEncryptionEnabled(bool isEnabled) {
+    _isEncryptionEnabled = isEnabled;
+}
+
+uint64_t InverterSimulator::getConnectionCount() const {
+    return _connectionCount.load();
+}
+
+uint64_t InverterSimulator::getRequestCount() const {
+    return _requestCount.load();
+}
+
+void InverterSimulator::setReorderWindow(size_t count) {
+    std::lock_guard<std::mutex> lock(_faultMutex);
+    _reorderWindow = count;
+}
+
+void InverterSimulator::setWriteChunkSize(size_t bytes) {
+    std::lock_guard<std::mutex> lock(_faultMutex);
+    _writeChunkSize = bytes;
+}
+
+void InverterSimulator::dropResponse(uint64_t requestNumber) {
+    std::lock_guard<std::mutex> lock(_faultMutex);
+    _droppedResponses.insert(requestNumber);
+}
+
+void InverterSimulator::corruptResponse(uint64_t requestNumber) {
+    std::lock_guard<std::mutex> lock(_faultMutex);
+    _corruptedResponses.insert(requestNumber);
+}
+
+InverterSimulator::response_fault InverterSimulator::_takeResponseFault(uint64_t requestNumber) {
+    std::lock_guard<std::mutex> lock(_faultMutex);
+    if (_droppedResponses.erase(requestNumber) != 0) {
+        return response_fault::DROP;
+    }
+    if (_corruptedResponses.erase(requestNumber) != 0) {
+        return response_fault::CORRUPT;
+    }
+    return response_fault::NONE;
+}
+
+size_t InverterSimulator::_getReorderWindow() const {
+    std::lock_guard<std::mutex> lock(_faultMutex);
+    return _reorderWindow;
+}
+
+size_t InverterSimulator::_getWriteChunkSize() const {
+    std::lock_guard<std::mutex> lock(_faultMutex);
+    return _writeChunkSize;
+}
+
+void InverterSimulator::_acceptNext() {
+    _acceptor.async_accept(boost::asio::make_strand(_ioContext),
+        [this](const boost::system::error_code& error, tcp::socket socket) {
+            if (error) {
+                if (error != boost::asio::error::operation_aborted) {
+                    std::cerr << "Simulator: accept failed: " << error.message() << std::endl;
+                }
+                return;
+            }
+
+            ++_connectionCount;
+            boost::system::error_code ignored;
+            socket.set_option(tcp::no_delay(true), ignored);
+            SUNGROW_TRACE(trace_level::INFO, "Simulator: connection from " << socket.remote_endpoint(ignored));
+
+            std::make_shared<SimulatorSession>(*this, std::move(socket))->start();
+            _acceptNext();
+        });
+}
@@ -0,0 +1,176 @@
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+    constexpr std::array<std::string_view, LATENCY_PHASE_COUNT> PHASE_NAMES = {
+        "encrypt", "write", "first byte", "read", "decrypt", "parse", "total"
+    };
+
+    constexpr std::array<double, 3> REPORTED_PERCENTILES = {50.0, 90.0, 99.0};
+
+    std::string_view getFunctionName(uint8_t functionCode) {
+        switch (functionCode) {
+            case 0x03: return "holding registers";
+            case 0x04: return "input registers";
+            default: return "function";
+        }
+    }
+
+    double toMilliseconds(std::chrono::nanoseconds value) {
+        return std::chrono::duration<double, std::milli>(value).count();
+    }
+
+    void printPhases(std::ostream& output, const PhaseHistograms& histograms) {
+        for (size_t i = 0; i < LATENCY_PHASE_COUNT; i++) {
+            const auto& histogram = histograms.phases[i];
+            output << "  " << std::left << std::setw(14) << PHASE_NAMES[i] << std::right << std::setw(10) << histogram.getCount();
+            for (double percentile : REPORTED_PERCENTILES) {
+                output << std::setw(10) << toMilliseconds(histogram.getPercentile(percentile));
+            }
+            output << std::setw(10) << toMilliseconds(histogram.getMax()) << '\n';
+        }
+    }
+}
+
+LatencyHistogram::LatencyHistogram() : _buckets(BUCKET_COUNT) {
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds value) {
+    uint64_t nanoseconds = static_cast<uint64_t>(std::max<int64_t>(value.count(), 0));
+    nanoseconds = std::min(nanoseconds, MAX_VALUE);
+    ++_buckets[_getBucketIndex(nanoseconds)];
+    ++_count;
+    _max = std::max(_max, nanoseconds);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        _buckets[i] += other._buckets[i];
+    }
+    _count += other._count;
+    _max = std::max(_max, other._max);
+}
+
+void LatencyHistogram::clear() {
+    std::fill(_buckets.begin(), _buckets.end(), 0);
+    _count = 0;
+    _max = 0;
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return _count;
+}
+
+std::chrono::nanoseconds LatencyHistogram::getMax() const {
+    return std::chrono::nanoseconds(_max);
+}
+
+std::chrono::nanoseconds LatencyHistogram::getPercentile(double percentile) const {
+    if (_count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    double clamped = std::clamp(percentile, 0.0, 100.0);
+    uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(_count))), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            // The bucket's upper edge can overshoot the largest sample in it
+            return std::chrono::nanoseconds(std::min(_getBucketValue(i), _max));
+        }
+    }
+    return std::chrono::nanoseconds(_max);
+}
+
+size_t LatencyHistogram::_getBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    // Values in [2^exponent, 2^(exponent+1)) share SUB_BUCKET_COUNT linear buckets
+    int exponent = std::bit_width(value) - 1;
+    uint64_t mantissa = (value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+    return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + mantissa);
+}
+
+uint64_t LatencyHistogram::_getBucketValue(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = static_cast<int>(index / SUB_BUCKET_COUNT) - 1;
+    uint64_t low = (SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+    return low + (uint64_t{1} << shift) - 1;
+}
+
+std::string_view getLatencyPhaseName(latency_phase phase) {
+    return PHASE_NAMES[static_cast<size_t>(phase)];
+}
+
+void PhaseHistograms::record(const PhaseDurations& durations) {
+    for (size_t i = 0; i < LATENCY_PHASE_COUNT; i++) {
+        phases[i].record(durations[i]);
+    }
+}
+
+const LatencyHistogram& PhaseHistograms::get(latency_phase phase) const {
+    return phases[static_cast<size_t>(phase)];
+}
+
+void LatencyStatistics::record(uint8_t functionCode, uint16_t address, uint16_t count, const PhaseDurations& durations) {
+    _byFunctionCode[functionCode].record(durations);
+    _byBlock[{functionCode, address, count}].record(durations);
+}
+
+void LatencyStatistics::merge(const LatencyStatistics& other) {
+    for (const auto& [functionCode, histograms] : other._byFunctionCode) {
+        auto& merged = _byFunctionCode[functionCode];
+        for (size_t i = 0; i < LATENCY_PHASE_COUNT; i++) {
+            merged.phases[i].merge(histograms.phases[i]);
+        }
+    }
+    for (const auto& [block, histograms] : other._byBlock) {
+        auto& merged = _byBlock[block];
+        for (size_t i = 0; i < LATENCY_PHASE_COUNT; i++) {
+            merged.phases[i].merge(histograms.phases[i]);
+        }
+    }
+}
+
+const std::map<uint8_t, PhaseHistograms>& LatencyStatistics::getByFunctionCode() const {
+    return _byFunctionCode;
+}
+
+const std::map<LatencyStatistics::BlockKey, PhaseHistograms>& LatencyStatistics::getByBlock() const {
+    return _byBlock;
+}
+
+void LatencyStatistics::print(std::ostream& output) const {
+    if (_byFunctionCode.empty()) {
+        output << "No transactions recorded" << std::endl;
+        return;
+    }
+
+    auto flags = output.flags();
+    auto precision = output.precision();
+    output << std::left << std::setw(16) << "Latency (ms)" << std::right << std::setw(10) << "Count"
+           << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max" << '\n';
+    output << std::fixed << std::setprecision(3);
+
+    for (const auto& [functionCode, histograms] : _byFunctionCode) {
+        output << getFunctionName(functionCode) << " (0x" << std::hex << std::setw(2) << std::setfill('0')
+               << static_cast<int>(functionCode) << std::dec << std::setfill(' ') << ")\n";
+        printPhases(output, histograms);
+    }
+    for (const auto& [block, histograms] : _byBlock) {
+        const auto& [functionCode, address, count] = block;
+        output << "block 0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(functionCode)
+               << std::dec << std::setfill(' ') << " " << address << "-" << (address + count - 1) << " (" << count << " registers)\n";
+        printPhases(output, histograms);
+    }
+    output.flush();
+    output.flags(flags);
+    output.precision(precision);
+}
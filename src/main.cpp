@@ -1,17 +1,39 @@
 #include "sungrow_inverter.hpp"
+#include "multi_inverter_poller.hpp"
+#include "sample_store.hpp"
+#include "rollup_engine.hpp"
+#include "mqtt_publisher.hpp"
+#include "metrics_server.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
 #include <csignal>
 #include <atomic>
+#include <algorithm>
+#include <sstream>
+#include <optional>
 
 std::atomic<bool> running{true};
+std::atomic<bool> shouldDumpFrames{false};
 
 void signalHandler(int signal) {
     std::cout << "\nReceived signal " << signal << ". Shutting down..." << std::endl;
     running = false;
 }
 
+void dumpSignalHandler(int) {
+    shouldDumpFrames = true;
+}
+
+// The dump itself allocates and takes locks, so it runs on the main loop
+// rather than inside the signal handler
+void dumpFramesIfRequested() {
+    if (shouldDumpFrames.exchange(false)) {
+        Trace::dumpFrames(std::cerr);
+    }
+}
+
 void printHeader() {
     std::cout << "\n";
     std::cout << "╔════════════════════════════════════════════════════════════════════════╗\n";
@@ -26,15 +48,298 @@ void printUsage(const char* programName) {
     std::cout << "Options:\n";
     std::cout << "  --host <ip>      Inverter IP address (default: 192.168.1.249)\n";
     std::cout << "  --port <port>    Inverter port (default: 502)\n";
-    std::cout << "  --interval <sec> Scan interval in seconds (default: 30)\n";
+    std::cout << "  --interval <sec> Energy scan interval in seconds (default: 30)\n";
+    std::cout << "  --power-interval <sec>  Power scan interval in seconds (default: 1)\n";
+    std::cout << "  --totals-interval <sec> Lifetime totals scan interval in seconds (default: 300)\n";
+    std::cout << "  --window <n>     Modbus requests kept in flight (default: 1)\n";
+    std::cout << "  --discovery <file>     Plan reads from a register_scanner discovery map\n";
+    std::cout << "  --identity-cache <file>  Remember each inverter's model, serial and read\n";
+    std::cout << "                   plan, so a restart polls at once and checks them later\n";
+    std::cout << "  --hosts <a,b,..> Poll several inverters concurrently\n";
+    std::cout << "  --threads <n>    Worker threads for --hosts (default: 2)\n";
+    std::cout << "  --store <dir>    Append every sample to a columnar store in dir, with\n";
+    std::cout << "                   minute/hour/day rollups in dir/rollups\n";
+    std::cout << "                   (one subdirectory per host with --hosts)\n";
+    std::cout << "  --mqtt <host[:port]>   Publish changed fields to an MQTT broker (port 1883)\n";
+    std::cout << "  --mqtt-prefix <topic>  Topic prefix (default: sungrow)\n";
+    std::cout << "  --mqtt-qos <0|1>       Publish QoS (default: 0)\n";
+    std::cout << "  --metrics-port <port>  Serve Prometheus metrics at http://<host>:<port>/metrics\n";
+    std::cout << "  --capture <file> Record every raw frame for protocol_bench --replay\n";
+    std::cout << "                   (file.<host> per inverter with --hosts)\n";
+    std::cout << "  --trace <level>  off, info, debug or frame (default: info)\n";
+    std::cout << "                   With frame, SIGUSR1 dumps the captured frames\n";
+    std::cout << "  --stats          Print p50/p90/p99/max latency per request phase at exit\n";
     std::cout << "  --once           Read once and exit\n";
     std::cout << "  --help           Show this help message\n";
     std::cout << std::endl;
 }
 
+void printTimeToFirstSample(std::chrono::steady_clock::time_point startTime) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+    std::cout << "Time to first sample: " << elapsed.count() << " ms" << std::endl;
+}
+
+bool containsGroup(const PollScheduler& scheduler, const std::vector<size_t>& due, register_group group) {
+    return std::any_of(due.begin(), due.end(), [&](size_t index) {
+        return scheduler.getGroup(index).group == group;
+    });
+}
+
+// Network exporters shared by every inverter; null when not enabled
+struct Exporters {
+    std::unique_ptr<MqttPublisher> mqtt;
+    std::unique_ptr<MetricsServer> metrics;
+};
+
+Exporters openExporters(boost::asio::any_io_executor executor, const std::optional<MqttConfig>& mqttConfig,
+                        const std::optional<uint16_t>& metricsPort) {
+    Exporters exporters;
+    if (mqttConfig) {
+        exporters.mqtt = std::make_unique<MqttPublisher>(executor, *mqttConfig);
+        exporters.mqtt->start();
+    }
+    if (metricsPort) {
+        exporters.metrics = std::make_unique<MetricsServer>(executor, *metricsPort);
+        exporters.metrics->start();
+        std::cout << "Serving metrics at http://0.0.0.0:" << exporters.metrics->getPort() << "/metrics" << std::endl;
+    }
+    return exporters;
+}
+
+// Consumers of every successful scrape of one inverter
+struct SampleSinks {
+    std::unique_ptr<SampleStore> store;
+    std::unique_ptr<RollupEngine> rollups;
+    MqttPublisher* mqtt = nullptr;
+    MetricsServer* metrics = nullptr;
+    std::string deviceId;
+};
+
+SampleSinks openSampleSinks(const std::string& storeDirectory, const Exporters& exporters, const std::string& deviceId) {
+    SampleSinks sinks;
+    if (!storeDirectory.empty()) {
+        sinks.store = std::make_unique<SampleStore>(storeDirectory);
+        sinks.rollups = std::make_unique<RollupEngine>(storeDirectory + "/rollups");
+    }
+    sinks.mqtt = exporters.mqtt.get();
+    sinks.metrics = exporters.metrics.get();
+    sinks.deviceId = deviceId;
+    return sinks;
+}
+
+void recordSample(SampleSinks& sinks, const SungrowInverter& inverter) {
+    auto now = std::chrono::system_clock::now();
+    const InverterData& data = inverter.getLatestData();
+    if (sinks.store && !sinks.store->append(data, now)) {
+        std::cerr << "WARNING: Sample store is behind; sample dropped" << std::endl;
+    }
+    if (sinks.rollups) {
+        sinks.rollups->addSample(data, inverter.getScrapedGroups(), now);
+    }
+    if (sinks.mqtt || sinks.metrics) {
+        InverterSnapshot snapshot = inverter.getSnapshot();
+        if (sinks.mqtt) {
+            sinks.mqtt->publish(snapshot, sinks.deviceId);
+        }
+        if (sinks.metrics) {
+            sinks.metrics->update(sinks.deviceId, snapshot, inverter.getClientStatistics());
+        }
+    }
+}
+
+// Keeps the failure counters current; the published sample stays as it was
+void recordFailure(SampleSinks& sinks, const SungrowInverter& inverter) {
+    InverterSnapshot snapshot = inverter.getSnapshot();
+    if (sinks.metrics && snapshot.generation != 0) {
+        sinks.metrics->update(sinks.deviceId, snapshot, inverter.getClientStatistics());
+    }
+}
+
+void printMqttStatistics(const MqttPublisher& mqtt) {
+    MqttStatistics statistics = mqtt.getStatistics();
+    std::cout << "MQTT " << (statistics.isConnected ? "connected" : "disconnected") << ": "
+              << statistics.messages << " messages in " << statistics.batches << " batches, "
+              << statistics.acknowledged << " acknowledged, " << statistics.coalesced << " coalesced, "
+              << statistics.reconnects << " reconnects" << std::endl;
+}
+
+// Stops the exporters while their executor still runs
+void stopExporters(Exporters& exporters) {
+    if (exporters.mqtt) {
+        exporters.mqtt->stop();
+        printMqttStatistics(*exporters.mqtt);
+    }
+    if (exporters.metrics) {
+        exporters.metrics->stop();
+        std::cout << "Metrics: " << exporters.metrics->getRequestCount() << " requests served from "
+                  << exporters.metrics->getRenderCount() << " renders" << std::endl;
+    }
+}
+
+// Gives the exporters an event loop of their own in single-inverter mode,
+// where the inverter's io_context only runs inside its blocking calls.
+// Declare it after the Exporters it serves, so it stops first.
+class ServiceThread {
+public:
+    ServiceThread() : _workGuard(_ioContext.get_executor()) {
+        _thread = std::thread([this] { _ioContext.run(); });
+    }
+
+    ~ServiceThread() {
+        _ioContext.stop();
+        _thread.join();
+    }
+
+    boost::asio::any_io_executor getExecutor() {
+        return _ioContext.get_executor();
+    }
+
+private:
+    boost::asio::io_context _ioContext;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> _workGuard;
+    std::thread _thread;
+};
+
+bool parseBrokerAddress(const std::string& address, MqttConfig& config) {
+    size_t colon = address.rfind(':');
+    config.host = address.substr(0, colon);
+    if (colon != std::string::npos) {
+        int port = std::stoi(address.substr(colon + 1));
+        if (port <= 0 || port > 65535) {
+            return false;
+        }
+        config.port = static_cast<uint16_t>(port);
+    }
+    return !config.host.empty();
+}
+
+void runMonitoringLoop(SungrowInverter& inverter, SampleSinks& sinks, std::chrono::steady_clock::time_point programStart) {
+    // Never wait longer than this between checks of the shutdown flag
+    constexpr auto SHUTDOWN_POLL = std::chrono::milliseconds(250);
+    
+    PollScheduler scheduler(std::chrono::steady_clock::now());
+    for (const auto& group : inverter.getPollGroups()) {
+        scheduler.addGroup(group);
+    }
+    
+    bool hasFirstSample = false;
+    while (running) {
+        auto due = scheduler.collectDue(std::chrono::steady_clock::now());
+        
+        if (!due.empty()) {
+            if (inverter.scrapeRegisters(scheduler.mergeSpans(due))) {
+                recordSample(sinks, inverter);
+                if (!hasFirstSample) {
+                    printTimeToFirstSample(programStart);
+                    hasFirstSample = true;
+                }
+                
+                if (containsGroup(scheduler, due, register_group::DAILY_ENERGY)) {
+                    inverter.printPowerConsumptionStatus();
+                } else {
+                    std::cout << "Current Generation: " << inverter.getLatestData().totalActivePower << " W" << std::endl;
+                }
+            } else {
+                recordFailure(sinks, inverter);
+                std::cerr << "WARNING: Failed to read data from inverter" << std::endl;
+            }
+        }
+        
+        auto deadline = scheduler.getNextDeadline();
+        while (running && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_until(std::min(deadline, std::chrono::steady_clock::now() + SHUTDOWN_POLL));
+            dumpFramesIfRequested();
+        }
+    }
+}
+
+std::vector<std::string> splitHosts(const std::string& list) {
+    std::vector<std::string> hosts;
+    std::stringstream stream(list);
+    std::string host;
+    while (std::getline(stream, host, ',')) {
+        if (!host.empty()) {
+            hosts.push_back(host);
+        }
+    }
+    return hosts;
+}
+
+int runMultiInverter(const InverterConfig& baseConfig, const std::vector<std::string>& hosts, size_t threadCount,
+                     const std::string& storeDirectory, const std::optional<MqttConfig>& mqttConfig,
+                     const std::optional<uint16_t>& metricsPort, bool isStatsEnabled) {
+    constexpr auto STATISTICS_INTERVAL = std::chrono::seconds(10);
+    constexpr auto SHUTDOWN_POLL = std::chrono::milliseconds(250);
+    
+    std::vector<InverterConfig> configs;
+    for (const auto& host : hosts) {
+        InverterConfig config = baseConfig;
+        config.host = host;
+        if (!config.capturePath.empty()) {
+            config.capturePath += "." + host;  // A capture replays one connection at a time
+        }
+        configs.push_back(config);
+    }
+    
+    std::cout << "Polling " << configs.size() << " inverters on " << threadCount << " threads" << std::endl;
+    std::cout << "Press Ctrl+C to stop..." << std::endl;
+    
+    MultiInverterPoller poller(configs, threadCount);
+    
+    // The exporters share the pollers' threads; scrapes only post to them
+    Exporters exporters = openExporters(poller.getExecutor(), mqttConfig, metricsPort);
+    
+    std::vector<SampleSinks> sinks;
+    if (!storeDirectory.empty() || exporters.mqtt || exporters.metrics) {
+        for (const auto& host : hosts) {
+            sinks.push_back(openSampleSinks(storeDirectory.empty() ? "" : storeDirectory + "/" + host, exporters, host));
+        }
+        poller.setSampleHandler([&sinks](size_t deviceIndex, const SungrowInverter& inverter, bool isSuccess) {
+            if (isSuccess) {
+                recordSample(sinks[deviceIndex], inverter);
+            } else {
+                recordFailure(sinks[deviceIndex], inverter);
+            }
+        });
+    }
+    poller.start();
+    
+    auto nextReport = std::chrono::steady_clock::now() + STATISTICS_INTERVAL;
+    while (running) {
+        std::this_thread::sleep_for(SHUTDOWN_POLL);
+        dumpFramesIfRequested();
+        if (std::chrono::steady_clock::now() >= nextReport) {
+            poller.printStatistics();
+            if (exporters.mqtt) {
+                printMqttStatistics(*exporters.mqtt);
+            }
+            nextReport += STATISTICS_INTERVAL;
+        }
+    }
+    
+    stopExporters(exporters);
+    poller.stop();
+    poller.printStatistics();
+    if (isStatsEnabled) {
+        for (size_t i = 0; i < hosts.size(); i++) {
+            std::cout << "\nLatency for " << hosts[i] << std::endl;
+            poller.getInverter(i).getLatencyStatistics().print(std::cout);
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     InverterConfig config;
     bool readOnce = false;
+    bool isStatsEnabled = false;
+    std::vector<std::string> hosts;
+    size_t threadCount = 2;
+    std::string storeDirectory;
+    std::optional<MqttConfig> mqttConfig;
+    std::string mqttPrefix;
+    int mqttQos = 0;
+    std::optional<uint16_t> metricsPort;
     
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -52,6 +357,66 @@ int main(int argc, char* argv[]) {
         else if (arg == "--interval" && i + 1 < argc) {
             config.scanIntervalSec = std::stoi(argv[++i]);
         }
+        else if (arg == "--power-interval" && i + 1 < argc) {
+            config.powerIntervalSec = std::stoi(argv[++i]);
+        }
+        else if (arg == "--totals-interval" && i + 1 < argc) {
+            config.totalsIntervalSec = std::stoi(argv[++i]);
+        }
+        else if (arg == "--window" && i + 1 < argc) {
+            config.pipelineWindow = std::stoi(argv[++i]);
+        }
+        else if (arg == "--discovery" && i + 1 < argc) {
+            config.discoveryPath = argv[++i];
+        }
+        else if (arg == "--identity-cache" && i + 1 < argc) {
+            config.identityCachePath = argv[++i];
+        }
+        else if (arg == "--capture" && i + 1 < argc) {
+            config.capturePath = argv[++i];
+        }
+        else if (arg == "--hosts" && i + 1 < argc) {
+            hosts = splitHosts(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threadCount = std::stoul(argv[++i]);
+        }
+        else if (arg == "--store" && i + 1 < argc) {
+            storeDirectory = argv[++i];
+        }
+        else if (arg == "--mqtt" && i + 1 < argc) {
+            mqttConfig.emplace();
+            if (!parseBrokerAddress(argv[++i], *mqttConfig)) {
+                std::cerr << "Invalid MQTT broker address: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--mqtt-prefix" && i + 1 < argc) {
+            mqttPrefix = argv[++i];
+        }
+        else if (arg == "--mqtt-qos" && i + 1 < argc) {
+            mqttQos = std::stoi(argv[++i]);
+            if (mqttQos < 0 || mqttQos > 1) {
+                std::cerr << "MQTT QoS must be 0 or 1" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--metrics-port" && i + 1 < argc) {
+            metricsPort = static_cast<uint16_t>(std::stoi(argv[++i]));
+        }
+        else if (arg == "--trace" && i + 1 < argc) {
+            trace_level level;
+            if (!Trace::parseLevel(argv[++i], level)) {
+                std::cerr << "Unknown trace level: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            Trace::setLevel(level);
+        }
+        else if (arg == "--stats") {
+            isStatsEnabled = true;
+        }
         else if (arg == "--once") {
             readOnce = true;
         }
@@ -62,15 +427,35 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (mqttConfig) {
+        if (!mqttPrefix.empty()) {
+            mqttConfig->topicPrefix = mqttPrefix;
+        }
+        mqttConfig->qos = static_cast<uint8_t>(mqttQos);
+    }
+    
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signal(SIGUSR1, dumpSignalHandler);
     
     printHeader();
     
+    if (!hosts.empty()) {
+        return runMultiInverter(config, hosts, threadCount, storeDirectory, mqttConfig, metricsPort, isStatsEnabled);
+    }
+    
+    auto programStart = std::chrono::steady_clock::now();
     std::cout << "Connecting to SG8K-D inverter at " << config.host << ":" << config.port << std::endl;
     
     try {
         SungrowInverter inverter(config);
+        Exporters exporters;
+        std::optional<ServiceThread> services;
+        if (mqttConfig || metricsPort) {
+            services.emplace();
+            exporters = openExporters(services->getExecutor(), mqttConfig, metricsPort);
+        }
+        SampleSinks sinks = openSampleSinks(storeDirectory, exporters, config.host);
         
         if (!inverter.connect()) {
             std::cerr << "ERROR: Failed to connect to inverter at " << config.host << ":" << config.port << std::endl;
@@ -84,15 +469,16 @@ int main(int argc, char* argv[]) {
         
         std::cout << "Connection established successfully!" << std::endl;
         
-        std::cout << "\nDetecting inverter model..." << std::endl;
-        inverter.detectModel();
-        
-        std::cout << "Reading serial number..." << std::endl;
-        inverter.detectSerial();
+        if (!inverter.restoreIdentity()) {
+            std::cout << "\nDetecting inverter model and serial number..." << std::endl;
+            inverter.detectIdentity();
+        }
         
         if (readOnce) {
             std::cout << "\nReading power consumption data..." << std::endl;
             if (inverter.scrapeData()) {
+                recordSample(sinks, inverter);
+                printTimeToFirstSample(programStart);
                 inverter.printPowerConsumptionStatus();
             } else {
                 std::cerr << "ERROR: Failed to read inverter data" << std::endl;
@@ -100,35 +486,19 @@ int main(int argc, char* argv[]) {
             }
         }
         else {
-            std::cout << "\nStarting continuous monitoring (interval: " << config.scanIntervalSec << " seconds)" << std::endl;
+            std::cout << "\nStarting continuous monitoring (power every " << static_cast<int>(config.powerIntervalSec)
+                      << " s, energy every " << static_cast<int>(config.scanIntervalSec)
+                      << " s, totals every " << config.totalsIntervalSec << " s)" << std::endl;
             std::cout << "Press Ctrl+C to stop..." << std::endl;
             
-            while (running) {
-                auto startTime = std::chrono::steady_clock::now();
-                
-                std::cout << "\n--- Reading inverter data ---" << std::endl;
-                
-                if (inverter.scrapeData()) {
-                    inverter.printPowerConsumptionStatus();
-                } else {
-                    std::cerr << "WARNING: Failed to read data from inverter" << std::endl;
-                }
-                
-                if (!running) break;
-                
-                auto endTime = std::chrono::steady_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::seconds>(endTime - startTime);
-                auto sleepTime = config.scanIntervalSec - duration.count();
-                
-                if (sleepTime > 0) {
-                    std::cout << "\nWaiting " << sleepTime << " seconds until next reading..." << std::endl;
-                    for (int i = 0; i < sleepTime && running; i++) {
-                        std::this_thread::sleep_for(std::chrono::seconds(1));
-                    }
-                }
-            }
+            runMonitoringLoop(inverter, sinks, programStart);
         }
         
+        stopExporters(exporters);
+        if (isStatsEnabled) {
+            std::cout << std::endl;
+            inverter.getLatencyStatistics().print(std::cout);
+        }
         std::cout << "\nDisconnecting from inverter..." << std::endl;
         inverter.disconnect();
         std::cout << "Program terminated successfully." << std::endl;
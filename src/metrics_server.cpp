@@ -0,0 +1,312 @@
+#include "metrics_server.hpp"
+#include "register_map.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <future>
+
+namespace {
+    constexpr std::string_view METRICS_PATH = "/metrics";
+    constexpr std::string_view EXPOSITION_CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+    constexpr std::string_view HEADER_END = "\r\n\r\n";
+    constexpr size_t NUMBER_TEXT_CAPACITY = 32;
+
+    struct ClientCounter {
+        std::string_view name;
+        std::string_view help;
+        uint64_t ClientStatistics::* value;
+    };
+
+    constexpr std::array<ClientCounter, 7> CLIENT_COUNTERS{{
+        {"sungrow_client_requests_total", "Modbus requests sent", &ClientStatistics::requests},
+        {"sungrow_client_responses_total", "Modbus responses matched to a request", &ClientStatistics::responses},
+        {"sungrow_client_timeouts_total", "Responses that did not arrive in time", &ClientStatistics::timeouts},
+        {"sungrow_client_retries_total", "Pipelined reads retried on a new connection", &ClientStatistics::retries},
+        {"sungrow_client_reconnects_total", "Reconnections after a failed read", &ClientStatistics::reconnects},
+        {"sungrow_client_decrypt_failures_total", "Responses that could not be decrypted", &ClientStatistics::decryptFailures},
+        {"sungrow_scrape_failures_total", "Scrapes with registers missing, not published", &ClientStatistics::scrapeFailures},
+    }};
+
+    // Prometheus base units, so dashboards can convert without guessing
+    std::string_view getUnitSuffix(std::string_view unit) {
+        if (unit == "W") return "_watts";
+        if (unit == "kWh") return "_kilowatt_hours";
+        if (unit == "V") return "_volts";
+        if (unit == "°C") return "_celsius";
+        if (unit == "min") return "_minutes";
+        return "";
+    }
+
+    void appendEscaped(std::string& out, std::string_view value) {
+        for (char c : value) {
+            switch (c) {
+                case '\\': out += "\\\\"; break;
+                case '"': out += "\\\""; break;
+                case '\n': out += "\\n"; break;
+                default: out += c; break;
+            }
+        }
+    }
+
+    void appendNumber(std::string& out, double value, int decimals) {
+        std::array<char, NUMBER_TEXT_CAPACITY> text;
+        auto result = std::to_chars(text.data(), text.data() + text.size(), value, std::chars_format::fixed, decimals);
+        out.append(text.data(), result.ptr - text.data());
+    }
+
+    void appendNumber(std::string& out, double value) {
+        std::array<char, NUMBER_TEXT_CAPACITY> text;
+        auto result = std::to_chars(text.data(), text.data() + text.size(), value);
+        out.append(text.data(), result.ptr - text.data());
+    }
+
+    void appendFamily(std::string& out, std::string_view name, std::string_view type, std::string_view help) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    // Metric name and the labels every series carries, with the label set left open
+    void appendSeries(std::string& out, std::string_view name, const std::string& deviceId, const InverterSnapshot& snapshot) {
+        out += name;
+        out += "{device=\"";
+        appendEscaped(out, deviceId);
+        out += "\",serial=\"";
+        appendEscaped(out, snapshot.getSerialNumber());
+        out += '"';
+    }
+
+    void appendSample(std::string& out, std::string_view name, const std::string& deviceId,
+                      const InverterSnapshot& snapshot, double value) {
+        appendSeries(out, name, deviceId, snapshot);
+        out += "} ";
+        appendNumber(out, value);
+        out += '\n';
+    }
+
+    std::string buildResponse(std::string_view status, std::string_view contentType, std::string_view body) {
+        std::string response = "HTTP/1.1 ";
+        response += status;
+        response += "\r\nContent-Type: ";
+        response += contentType;
+        response += "\r\nContent-Length: ";
+        response += std::to_string(body.size());
+        response += "\r\n\r\n";
+        response += body;
+        return response;
+    }
+
+    bool containsIgnoringCase(std::string_view text, std::string_view lowercasePattern) {
+        auto match = std::search(text.begin(), text.end(), lowercasePattern.begin(), lowercasePattern.end(), [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == b;
+        });
+        return match != text.end();
+    }
+}
+
+MetricsServer::Connection::Connection(tcp::socket socket)
+    : socket(std::move(socket)), request(MAX_REQUEST_SIZE), idleTimer(this->socket.get_executor()) {
+}
+
+MetricsServer::MetricsServer(boost::asio::any_io_executor executor, uint16_t port, const std::string& address)
+    : _strand(boost::asio::make_strand(std::move(executor))),
+      _acceptor(_strand, tcp::endpoint(boost::asio::ip::make_address(address), port)) {
+    _render();
+}
+
+uint16_t MetricsServer::getPort() const {
+    return _acceptor.local_endpoint().port();
+}
+
+void MetricsServer::start() {
+    boost::asio::post(_strand, [this] { _accept(); });
+}
+
+void MetricsServer::stop() {
+    std::promise<void> stopped;
+    boost::asio::post(_strand, [this, &stopped] {
+        boost::system::error_code ignored;
+        _acceptor.close(ignored);
+        while (!_connections.empty()) {
+            auto connection = *_connections.begin();
+            _close(connection);
+        }
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+}
+
+void MetricsServer::update(const std::string& deviceId, const InverterSnapshot& snapshot, const ClientStatistics& client) {
+    boost::asio::post(_strand, [this, deviceId, snapshot, client] {
+        _devices[deviceId] = {snapshot, client};
+        _render();
+    });
+}
+
+uint64_t MetricsServer::getRequestCount() const {
+    return _requests.load(std::memory_order_relaxed);
+}
+
+uint64_t MetricsServer::getRenderCount() const {
+    return _renders.load(std::memory_order_relaxed);
+}
+
+std::string MetricsServer::renderExposition(const std::map<std::string, std::pair<InverterSnapshot, ClientStatistics>>& devices) {
+    std::string out;
+    if (devices.empty()) {
+        return out;
+    }
+
+    // Every sample of a family has to follow its HELP and TYPE lines
+    // The work state label follows the inverter; sungrow_work_state_code carries the same state as a number
+    appendFamily(out, "sungrow_info", "gauge", "Inverter identity and work state; the value is always 1");
+    for (const auto& [deviceId, entry] : devices) {
+        const InverterSnapshot& snapshot = entry.first;
+        appendSeries(out, "sungrow_info", deviceId, snapshot);
+        out += ",device_type=\"";
+        appendEscaped(out, snapshot.getDeviceType());
+        out += "\",work_state=\"";
+        appendEscaped(out, snapshot.getWorkState());
+        out += "\"} 1\n";
+    }
+
+    appendFamily(out, "sungrow_last_sample_timestamp_seconds", "gauge", "Time of the last successful scrape");
+    for (const auto& [deviceId, entry] : devices) {
+        appendSample(out, "sungrow_last_sample_timestamp_seconds", deviceId, entry.first,
+                     std::chrono::duration<double>(entry.first.time.time_since_epoch()).count());
+    }
+
+    size_t index = 0;
+    std::string name;
+    std::string help;
+    RegisterMap::forEachNumericField([&](const auto& field) {
+        name = "sungrow_";
+        name += field.name;
+        name += getUnitSuffix(field.unit);
+        help = "Input register ";
+        help += std::to_string(field.address);
+        if (!field.unit.empty()) {
+            help += ", ";
+            help += field.unit;
+        }
+        appendFamily(out, name, "gauge", help);
+        for (const auto& [deviceId, entry] : devices) {
+            appendSeries(out, name, deviceId, entry.first);
+            out += "} ";
+            appendNumber(out, entry.first.values[index], field.getDecimals());
+            out += '\n';
+        }
+        ++index;
+    });
+
+    for (const auto& counter : CLIENT_COUNTERS) {
+        appendFamily(out, counter.name, "counter", counter.help);
+        for (const auto& [deviceId, entry] : devices) {
+            appendSample(out, counter.name, deviceId, entry.first, static_cast<double>(entry.second.*counter.value));
+        }
+    }
+
+    appendFamily(out, "sungrow_client_round_trip_seconds", "summary", "Time from sending a Modbus request to its response");
+    for (const auto& [deviceId, entry] : devices) {
+        appendSample(out, "sungrow_client_round_trip_seconds_sum", deviceId, entry.first,
+                     std::chrono::duration<double>(entry.second.totalRoundTrip).count());
+        appendSample(out, "sungrow_client_round_trip_seconds_count", deviceId, entry.first,
+                     static_cast<double>(entry.second.responses));
+    }
+    appendFamily(out, "sungrow_client_round_trip_max_seconds", "gauge", "Slowest Modbus round trip since startup");
+    for (const auto& [deviceId, entry] : devices) {
+        appendSample(out, "sungrow_client_round_trip_max_seconds", deviceId, entry.first,
+                     std::chrono::duration<double>(entry.second.maxRoundTrip).count());
+    }
+    return out;
+}
+
+void MetricsServer::_render() {
+    _metricsResponse = std::make_shared<const std::string>(
+        buildResponse("200 OK", EXPOSITION_CONTENT_TYPE, renderExposition(_devices)));
+    ++_renders;
+}
+
+void MetricsServer::_accept() {
+    _acceptor.async_accept(_strand, [this](const boost::system::error_code& error, tcp::socket socket) {
+        if (error == boost::asio::error::operation_aborted || !_acceptor.is_open()) {
+            return;
+        }
+        if (!error) {
+            auto connection = std::make_shared<Connection>(std::move(socket));
+            _connections.insert(connection);
+            _readRequest(connection);
+        }
+        _accept();
+    });
+}
+
+void MetricsServer::_readRequest(std::shared_ptr<Connection> connection) {
+    connection->idleTimer.expires_after(IDLE_TIMEOUT);
+    connection->idleTimer.async_wait([this, connection](const boost::system::error_code& error) {
+        if (!error) {
+            _close(connection);
+        }
+    });
+
+    boost::asio::async_read_until(connection->socket, connection->request, HEADER_END,
+        [this, connection](const boost::system::error_code& error, size_t headerSize) {
+            if (error) {
+                _close(connection);
+                return;
+            }
+            _handleRequest(connection, headerSize);
+        });
+}
+
+void MetricsServer::_handleRequest(std::shared_ptr<Connection> connection, size_t headerSize) {
+    static const auto NOT_FOUND = std::make_shared<const std::string>(buildResponse("404 Not Found", "text/plain", "Not found\n"));
+    static const auto NOT_ALLOWED = std::make_shared<const std::string>(buildResponse("405 Method Not Allowed", "text/plain", "Only GET is supported\n"));
+
+    ++_requests;
+    auto data = connection->request.data();
+    std::string_view header(static_cast<const char*>(data.data()), headerSize);
+
+    // Request line: method, target, version
+    std::string_view line = header.substr(0, header.find("\r\n"));
+    size_t methodEnd = line.find(' ');
+    size_t targetEnd = line.find(' ', methodEnd + 1);
+    std::string_view method = line.substr(0, methodEnd);
+    std::string_view target = methodEnd == std::string_view::npos ? std::string_view() : line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    std::string_view version = targetEnd == std::string_view::npos ? std::string_view() : line.substr(targetEnd + 1);
+    std::string_view path = target.substr(0, target.find('?'));
+
+    bool isKeepAlive = version == "HTTP/1.1" && !containsIgnoringCase(header, "connection: close");
+    if (method != "GET") {
+        connection->response = NOT_ALLOWED;
+    } else if (path == METRICS_PATH) {
+        connection->response = _metricsResponse;
+    } else {
+        connection->response = NOT_FOUND;
+    }
+    connection->request.consume(headerSize);
+
+    boost::asio::async_write(connection->socket, boost::asio::buffer(*connection->response),
+        [this, connection, isKeepAlive](const boost::system::error_code& error, size_t) {
+            connection->response.reset();
+            if (error || !isKeepAlive) {
+                _close(connection);
+                return;
+            }
+            _readRequest(connection);
+        });
+}
+
+void MetricsServer::_close(const std::shared_ptr<Connection>& connection) {
+    boost::system::error_code ignored;
+    connection->socket.close(ignored);
+    connection->idleTimer.cancel();
+    _connections.erase(connection);
+}
@@ -0,0 +1,451 @@
+#include "mqtt_publisher.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <charconv>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    // MQTT 3.1.1 control packet types, already shifted into the fixed header
+    constexpr uint8_t PACKET_CONNECT = 0x10;
+    constexpr uint8_t PACKET_CONNACK = 0x20;
+    constexpr uint8_t PACKET_PUBLISH = 0x30;
+    constexpr uint8_t PACKET_PUBACK = 0x40;
+    constexpr uint8_t PACKET_PINGREQ = 0xC0;
+    constexpr uint8_t PACKET_PINGRESP = 0xD0;
+    constexpr uint8_t PACKET_DISCONNECT = 0xE0;
+    constexpr uint8_t PACKET_TYPE_MASK = 0xF0;
+
+    constexpr uint8_t PROTOCOL_LEVEL = 4;
+    constexpr uint8_t CONNECT_CLEAN_SESSION = 0x02;
+    constexpr uint8_t PUBLISH_RETAIN = 0x01;
+    constexpr int PUBLISH_QOS_SHIFT = 1;
+    constexpr uint8_t CONNACK_ACCEPTED = 0;
+    constexpr std::string_view PROTOCOL_NAME = "MQTT";
+
+    // Remaining length is a base-128 varint of at most four bytes
+    constexpr uint8_t LENGTH_CONTINUATION = 0x80;
+    constexpr uint8_t LENGTH_DIGIT_MASK = 0x7F;
+    constexpr int LENGTH_DIGIT_BITS = 7;
+    constexpr size_t MAX_LENGTH_BYTES = 4;
+
+    // Text fields resent with every keyframe
+    constexpr size_t TEXT_FIELD_COUNT = 3;
+    constexpr size_t MAX_BATCH_MESSAGES = RegisterMap::NUMERIC_FIELD_COUNT + TEXT_FIELD_COUNT;
+    constexpr size_t VALUE_TEXT_CAPACITY = 32;
+
+    void appendLength(std::vector<uint8_t>& buffer, size_t length) {
+        do {
+            uint8_t digit = length & LENGTH_DIGIT_MASK;
+            length >>= LENGTH_DIGIT_BITS;
+            buffer.push_back(length > 0 ? digit | LENGTH_CONTINUATION : digit);
+        } while (length > 0);
+    }
+
+    void appendU16(std::vector<uint8_t>& buffer, uint16_t value) {
+        buffer.push_back(static_cast<uint8_t>(value >> 8));
+        buffer.push_back(static_cast<uint8_t>(value & 0xFF));
+    }
+
+    void appendString(std::vector<uint8_t>& buffer, std::string_view text) {
+        appendU16(buffer, static_cast<uint16_t>(text.size()));
+        buffer.insert(buffer.end(), text.begin(), text.end());
+    }
+
+    bool isKnown(std::string_view text) {
+        return !text.empty() && text != "Unknown";
+    }
+}
+
+MqttPublisher::MqttPublisher(boost::asio::any_io_executor executor, MqttConfig config)
+    : _strand(boost::asio::make_strand(std::move(executor))), _config(std::move(config)),
+      _resolver(_strand), _socket(_strand), _connectTimer(_strand), _retryTimer(_strand), _keepAliveTimer(_strand) {
+    if (_config.qos > 1) {
+        throw std::invalid_argument("MQTT QoS must be 0 or 1");
+    }
+}
+
+const MqttConfig& MqttPublisher::getConfig() const {
+    return _config;
+}
+
+void MqttPublisher::start() {
+    boost::asio::post(_strand, [this] {
+        _isRunning = true;
+        _connect();
+    });
+}
+
+void MqttPublisher::stop() {
+    std::promise<void> stopped;
+    boost::asio::post(_strand, [this, &stopped] {
+        _isRunning = false;
+        if (_isSessionOpen && !_isWriting) {
+            // Two bytes; the broker then discards the session without a will
+            std::array<uint8_t, 2> disconnect{PACKET_DISCONNECT, 0};
+            boost::system::error_code ignored;
+            boost::asio::write(_socket, boost::asio::buffer(disconnect), ignored);
+        }
+        _closeConnection();
+        _retryTimer.cancel();
+        _devices.clear();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+}
+
+void MqttPublisher::publish(const InverterSnapshot& snapshot, const std::string& deviceId) {
+    boost::asio::post(_strand, [this, snapshot, deviceId] {
+        _enqueue(snapshot, deviceId);
+    });
+}
+
+MqttStatistics MqttPublisher::getStatistics() const {
+    MqttStatistics statistics;
+    statistics.isConnected = _isConnected.load(std::memory_order_relaxed);
+    statistics.batches = _batches.load(std::memory_order_relaxed);
+    statistics.messages = _messages.load(std::memory_order_relaxed);
+    statistics.acknowledged = _acknowledged.load(std::memory_order_relaxed);
+    statistics.coalesced = _coalesced.load(std::memory_order_relaxed);
+    statistics.reconnects = _reconnects.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void MqttPublisher::_connect() {
+    if (!_isRunning) {
+        return;
+    }
+    uint64_t generation = _connectionGeneration;
+
+    // Covers resolution, the TCP handshake and CONNACK
+    _connectTimer.expires_after(CONNECT_TIMEOUT);
+    _connectTimer.async_wait([this, generation](const boost::system::error_code& error) {
+        if (!error && generation == _connectionGeneration && !_isSessionOpen) {
+            std::cerr << "MQTT broker " << _config.host << ":" << _config.port << " did not answer in time" << std::endl;
+            _closeConnection();
+            _scheduleReconnect();
+        }
+    });
+
+    _resolver.async_resolve(_config.host, std::to_string(_config.port),
+        [this, generation](const boost::system::error_code& error, tcp::resolver::results_type endpoints) {
+            if (generation != _connectionGeneration) {
+                return;
+            }
+            if (error) {
+                std::cerr << "MQTT connection failed: " << error.message() << std::endl;
+                _closeConnection();
+                _scheduleReconnect();
+                return;
+            }
+
+            boost::asio::async_connect(_socket, endpoints,
+                [this, generation](const boost::system::error_code& error, const tcp::endpoint&) {
+                    if (generation != _connectionGeneration) {
+                        return;
+                    }
+                    if (error) {
+                        std::cerr << "MQTT connection failed: " << error.message() << std::endl;
+                        _closeConnection();
+                        _scheduleReconnect();
+                        return;
+                    }
+
+                    // PUBLISH packets are small and latency matters more than packing
+                    _socket.set_option(tcp::no_delay(true));
+                    _sendConnect();
+                    _readPackets();
+                });
+        });
+}
+
+void MqttPublisher::_scheduleReconnect() {
+    if (!_isRunning) {
+        return;
+    }
+    _retryTimer.expires_after(_reconnectDelay);
+    _retryTimer.async_wait([this](const boost::system::error_code& error) {
+        if (!error) {
+            _connect();
+        }
+    });
+    _reconnectDelay = std::min(_reconnectDelay * 2, MAX_RECONNECT_DELAY);
+}
+
+void MqttPublisher::_closeConnection() {
+    // Handlers still queued for the old socket see a stale generation and return
+    ++_connectionGeneration;
+    boost::system::error_code ignored;
+    _socket.close(ignored);
+    _resolver.cancel();
+    _connectTimer.cancel();
+    _keepAliveTimer.cancel();
+
+    _isSessionOpen = false;
+    _isPingOutstanding = false;
+    _isConnected = false;
+    _received.clear();
+    _txBuffer.clear();
+    _inFlight.clear();
+}
+
+void MqttPublisher::_sendConnect() {
+    // Protocol name, level, flags and keep-alive, then the client id
+    const size_t variableHeaderSize = 2 + PROTOCOL_NAME.size() + 1 + 1 + 2;
+    _txBuffer.push_back(PACKET_CONNECT);
+    appendLength(_txBuffer, variableHeaderSize + 2 + _config.clientId.size());
+    appendString(_txBuffer, PROTOCOL_NAME);
+    _txBuffer.push_back(PROTOCOL_LEVEL);
+    _txBuffer.push_back(CONNECT_CLEAN_SESSION);
+    appendU16(_txBuffer, static_cast<uint16_t>(_config.keepAlive.count()));
+    appendString(_txBuffer, _config.clientId);
+    _write();
+}
+
+void MqttPublisher::_readPackets() {
+    uint64_t generation = _connectionGeneration;
+    _socket.async_read_some(boost::asio::buffer(_readChunk),
+        [this, generation](const boost::system::error_code& error, size_t bytesRead) {
+            if (generation != _connectionGeneration) {
+                return;
+            }
+            if (error) {
+                std::cerr << "MQTT connection lost: " << error.message() << std::endl;
+                _closeConnection();
+                _scheduleReconnect();
+                return;
+            }
+
+            _hasReceivedSinceKeepAlive = true;
+            _received.insert(_received.end(), _readChunk.begin(), _readChunk.begin() + bytesRead);
+
+            size_t offset = 0;
+            while (_received.size() - offset >= 2) {
+                size_t length = 0;
+                size_t lengthBytes = 0;
+                bool isLengthComplete = false;
+                while (lengthBytes < MAX_LENGTH_BYTES && offset + 1 + lengthBytes < _received.size()) {
+                    uint8_t digit = _received[offset + 1 + lengthBytes];
+                    length |= static_cast<size_t>(digit & LENGTH_DIGIT_MASK) << (LENGTH_DIGIT_BITS * lengthBytes);
+                    ++lengthBytes;
+                    if (!(digit & LENGTH_CONTINUATION)) {
+                        isLengthComplete = true;
+                        break;
+                    }
+                }
+                size_t headerSize = 1 + lengthBytes;
+                if (!isLengthComplete || _received.size() - offset < headerSize + length) {
+                    break;
+                }
+
+                _handlePacket(_received[offset] & PACKET_TYPE_MASK, _received.data() + offset + headerSize, length);
+                if (generation != _connectionGeneration) {
+                    return;
+                }
+                offset += headerSize + length;
+            }
+            _received.erase(_received.begin(), _received.begin() + offset);
+            _readPackets();
+        });
+}
+
+void MqttPublisher::_handlePacket(uint8_t type, const uint8_t* body, size_t length) {
+    switch (type) {
+        case PACKET_CONNACK: {
+            uint8_t returnCode = length >= 2 ? body[1] : 0xFF;
+            if (returnCode != CONNACK_ACCEPTED) {
+                std::cerr << "MQTT broker refused the connection (code " << static_cast<int>(returnCode) << ")" << std::endl;
+                _closeConnection();
+                _scheduleReconnect();
+                return;
+            }
+
+            _connectTimer.cancel();
+            if (_hasConnected) {
+                ++_reconnects;
+            }
+            _hasConnected = true;
+            _isSessionOpen = true;
+            _isConnected = true;
+            _reconnectDelay = MIN_RECONNECT_DELAY;
+            SUNGROW_TRACE(trace_level::INFO, "Connected to MQTT broker at " << _config.host << ":" << _config.port);
+
+            // The broker may have missed anything while we were away
+            for (auto& [deviceId, device] : _devices) {
+                device.detector = ChangeDetector(_config.keyframeInterval);
+            }
+            _scheduleKeepAlive();
+            _flush();
+            break;
+        }
+        case PACKET_PUBACK:
+            if (length >= 2 && _inFlight.erase(static_cast<uint16_t>(body[0] << 8 | body[1])) > 0) {
+                ++_acknowledged;
+                _flush();
+            }
+            break;
+        case PACKET_PINGRESP:
+            break;
+        default:
+            SUNGROW_TRACE(trace_level::DEBUG, "Ignoring MQTT packet type 0x" << std::hex << static_cast<int>(type) << std::dec);
+            break;
+    }
+}
+
+void MqttPublisher::_scheduleKeepAlive() {
+    if (_config.keepAlive.count() == 0) {
+        return;
+    }
+    // Pinging at half the interval leaves the broker a full interval of slack
+    _hasWrittenSinceKeepAlive = false;
+    _hasReceivedSinceKeepAlive = false;
+    uint64_t generation = _connectionGeneration;
+    _keepAliveTimer.expires_after(_config.keepAlive / 2);
+    _keepAliveTimer.async_wait([this, generation](const boost::system::error_code& error) {
+        if (error || generation != _connectionGeneration) {
+            return;
+        }
+        if (_isPingOutstanding && !_hasReceivedSinceKeepAlive) {
+            std::cerr << "MQTT broker stopped responding" << std::endl;
+            _closeConnection();
+            _scheduleReconnect();
+            return;
+        }
+
+        // QoS 0 traffic draws no replies, so a ping also proves the broker is alive
+        _isPingOutstanding = !_hasWrittenSinceKeepAlive || !_hasReceivedSinceKeepAlive;
+        if (_isPingOutstanding) {
+            _txBuffer.push_back(PACKET_PINGREQ);
+            _txBuffer.push_back(0);
+            _write();
+        }
+        _scheduleKeepAlive();
+    });
+}
+
+void MqttPublisher::_enqueue(const InverterSnapshot& snapshot, const std::string& deviceId) {
+    if (!_isRunning) {
+        return;
+    }
+    auto [entry, isNew] = _devices.try_emplace(deviceId);
+    Device& device = entry->second;
+    if (isNew) {
+        device.detector = ChangeDetector(_config.keyframeInterval);
+    }
+
+    if (device.hasPending) {
+        ++_coalesced;
+    }
+    device.pending = snapshot;
+    device.hasPending = true;
+    _flush();
+}
+
+void MqttPublisher::_flush() {
+    if (!_isSessionOpen || _isWriting) {
+        return;
+    }
+
+    for (auto& [deviceId, device] : _devices) {
+        if (!device.hasPending) {
+            continue;
+        }
+        if (_config.qos > 0 && _inFlight.size() + MAX_BATCH_MESSAGES > MAX_IN_FLIGHT) {
+            break;
+        }
+        FieldChanges changes = device.detector.update(device.pending);
+        device.hasPending = false;
+        _appendBatch(deviceId, device, changes);
+    }
+    _write();
+}
+
+void MqttPublisher::_appendPublish(const std::string& topic, std::string_view payload) {
+    uint8_t flags = static_cast<uint8_t>(_config.qos << PUBLISH_QOS_SHIFT) | (_config.shouldRetain ? PUBLISH_RETAIN : 0);
+    size_t packetIdSize = _config.qos > 0 ? 2 : 0;
+
+    _txBuffer.push_back(PACKET_PUBLISH | flags);
+    appendLength(_txBuffer, 2 + topic.size() + packetIdSize + payload.size());
+    appendString(_txBuffer, topic);
+    if (_config.qos > 0) {
+        // Zero is not a valid packet id
+        do {
+            _nextPacketId = static_cast<uint16_t>(_nextPacketId + 1);
+        } while (_nextPacketId == 0 || _inFlight.count(_nextPacketId) > 0);
+        _inFlight.insert(_nextPacketId);
+        appendU16(_txBuffer, _nextPacketId);
+    }
+    _txBuffer.insert(_txBuffer.end(), payload.begin(), payload.end());
+    ++_messages;
+}
+
+void MqttPublisher::_appendBatch(const std::string& deviceId, Device& device, const FieldChanges& changes) {
+    if (changes.mask.none()) {
+        return;
+    }
+
+    const InverterSnapshot& snapshot = device.pending;
+    std::string topic = _config.topicPrefix + "/";
+    topic += isKnown(snapshot.getSerialNumber()) ? snapshot.getSerialNumber() : std::string_view(deviceId);
+    topic += "/";
+    size_t baseLength = topic.size();
+
+    std::array<char, VALUE_TEXT_CAPACITY> text;
+    size_t index = 0;
+    RegisterMap::forEachNumericField([&](const auto& field) {
+        if (changes.mask.test(index)) {
+            auto result = std::to_chars(text.data(), text.data() + text.size(), snapshot.values[index],
+                                        std::chars_format::fixed, field.getDecimals());
+            topic.resize(baseLength);
+            topic += field.name;
+            _appendPublish(topic, std::string_view(text.data(), result.ptr - text.data()));
+        }
+        ++index;
+    });
+
+    if (changes.isKeyframe) {
+        const std::array<std::pair<std::string_view, std::string_view>, TEXT_FIELD_COUNT> textFields{{
+            {"device_type", snapshot.getDeviceType()},
+            {"serial_number", snapshot.getSerialNumber()},
+            {"work_state", snapshot.getWorkState()},
+        }};
+        for (const auto& [name, value] : textFields) {
+            topic.resize(baseLength);
+            topic += name;
+            _appendPublish(topic, value);
+        }
+    }
+    ++_batches;
+}
+
+void MqttPublisher::_write() {
+    if (_isWriting || _txBuffer.empty() || !_socket.is_open()) {
+        return;
+    }
+
+    std::swap(_txActive, _txBuffer);
+    _txBuffer.clear();
+    _isWriting = true;
+    _hasWrittenSinceKeepAlive = true;
+    uint64_t generation = _connectionGeneration;
+
+    boost::asio::async_write(_socket, boost::asio::buffer(_txActive),
+        [this, generation](const boost::system::error_code& error, size_t) {
+            _isWriting = false;
+            if (generation != _connectionGeneration) {
+                // A new connection may have queued its CONNECT behind this write
+                _write();
+                return;
+            }
+            if (error) {
+                std::cerr << "MQTT write failed: " << error.message() << std::endl;
+                _closeConnection();
+                _scheduleReconnect();
+                return;
+            }
+            // Snapshots that arrived during the write went to each device's pending slot
+            _write();
+            _flush();
+        });
+}
@@ -0,0 +1,187 @@
+#include "multi_inverter_poller.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+MultiInverterPoller::MultiInverterPoller(const std::vector<InverterConfig>& configs, size_t threadCount)
+    : _threadCount(std::max<size_t>(threadCount, 1)) {
+    for (const auto& config : configs) {
+        auto strand = boost::asio::make_strand(_ioContext);
+        auto session = std::unique_ptr<Session>(new Session{
+            strand,
+            std::make_unique<SungrowInverter>(config, strand),
+            boost::asio::steady_timer(strand),
+            std::nullopt,
+            _sessions.size()
+        });
+        _sessions.push_back(std::move(session));
+
+        DeviceStatistics statistics;
+        statistics.host = config.host;
+        _statistics.push_back(statistics);
+    }
+}
+
+MultiInverterPoller::~MultiInverterPoller() {
+    stop();
+}
+
+void MultiInverterPoller::setSampleHandler(SampleHandler handler) {
+    _sampleHandler = std::move(handler);
+}
+
+void MultiInverterPoller::start() {
+    _startTime = std::chrono::steady_clock::now();
+    _workGuard.emplace(_ioContext.get_executor());
+
+    for (auto& session : _sessions) {
+        boost::asio::post(session->strand, [this, &session = *session] { _connectSession(session); });
+    }
+
+    for (size_t i = 0; i < _threadCount; i++) {
+        _threads.emplace_back([this] { _ioContext.run(); });
+    }
+}
+
+void MultiInverterPoller::stop() {
+    _workGuard.reset();
+    _ioContext.stop();
+
+    for (auto& thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    _threads.clear();
+}
+
+boost::asio::any_io_executor MultiInverterPoller::getExecutor() {
+    return _ioContext.get_executor();
+}
+
+std::vector<DeviceStatistics> MultiInverterPoller::getStatistics() const {
+    std::lock_guard<std::mutex> lock(_statisticsMutex);
+    return _statistics;
+}
+
+const SungrowInverter& MultiInverterPoller::getInverter(size_t deviceIndex) const {
+    return *_sessions.at(deviceIndex)->inverter;
+}
+
+void MultiInverterPoller::printStatistics() const {
+    auto statistics = getStatistics();
+    double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - _startTime).count();
+
+    uint64_t totalScrapes = 0;
+    uint64_t totalFailures = 0;
+
+    std::cout << "\n--- MULTI-INVERTER POLLING ---" << std::endl;
+    std::cout << std::left << std::setw(18) << "Host" << std::setw(8) << "State" << std::right
+              << std::setw(10) << "Scrapes" << std::setw(10) << "Failures" << std::setw(12) << "Mean ms"
+              << std::setw(12) << "Max ms" << std::setw(12) << "Scrapes/s" << std::setw(10) << "Power W" << std::endl;
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (const auto& device : statistics) {
+        double meanMs = device.scrapes > 0 ? device.totalLatency.count() / 1000.0 / device.scrapes : 0.0;
+        double rate = elapsedSec > 0 ? device.scrapes / elapsedSec : 0.0;
+
+        std::cout << std::left << std::setw(18) << device.host << std::setw(8) << (device.isConnected ? "up" : "down")
+                  << std::right << std::setw(10) << device.scrapes << std::setw(10) << device.failures
+                  << std::setw(12) << meanMs << std::setw(12) << device.maxLatency.count() / 1000.0
+                  << std::setw(12) << std::setprecision(2) << rate << std::setprecision(1)
+                  << std::setw(10) << device.lastActivePower << std::endl;
+
+        totalScrapes += device.scrapes;
+        totalFailures += device.failures;
+    }
+
+    double aggregateRate = elapsedSec > 0 ? totalScrapes / elapsedSec : 0.0;
+    std::cout << "Aggregate: " << totalScrapes << " scrapes, " << totalFailures << " failures, "
+              << std::setprecision(2) << aggregateRate << " scrapes/s over " << std::setprecision(1) << elapsedSec << " s" << std::endl;
+}
+
+void MultiInverterPoller::_connectSession(Session& session) {
+    session.inverter->asyncConnect([this, &session](bool isConnected) {
+        _setConnected(session, isConnected);
+        if (!isConnected) {
+            _scheduleReconnect(session);
+            return;
+        }
+
+        if (session.inverter->restoreIdentity()) {
+            _startPolling(session);
+            return;
+        }
+        session.inverter->asyncDetectIdentity([this, &session](bool) {
+            _startPolling(session);
+        });
+    });
+}
+
+void MultiInverterPoller::_startPolling(Session& session) {
+    session.scheduler.emplace(std::chrono::steady_clock::now());
+    for (const auto& group : session.inverter->getPollGroups()) {
+        session.scheduler->addGroup(group);
+    }
+    _scheduleNextPoll(session);
+}
+
+void MultiInverterPoller::_scheduleReconnect(Session& session) {
+    session.timer.expires_after(RECONNECT_DELAY);
+    session.timer.async_wait([this, &session](const boost::system::error_code& error) {
+        if (!error) {
+            _connectSession(session);
+        }
+    });
+}
+
+void MultiInverterPoller::_scheduleNextPoll(Session& session) {
+    session.timer.expires_at(session.scheduler->getNextDeadline());
+    session.timer.async_wait([this, &session](const boost::system::error_code& error) {
+        if (!error) {
+            _pollSession(session);
+        }
+    });
+}
+
+void MultiInverterPoller::_pollSession(Session& session) {
+    auto due = session.scheduler->collectDue(std::chrono::steady_clock::now());
+    if (due.empty()) {
+        _scheduleNextPoll(session);
+        return;
+    }
+
+    session.inverter->asyncScrapeRegisters(session.scheduler->mergeSpans(due), [this, &session](bool isSuccess) {
+        _recordScrape(session, isSuccess);
+        if (_sampleHandler) {
+            _sampleHandler(session.index, *session.inverter, isSuccess);
+        }
+
+        if (!session.inverter->isConnected()) {
+            _setConnected(session, false);
+            _scheduleReconnect(session);
+            return;
+        }
+        _scheduleNextPoll(session);
+    });
+}
+
+void MultiInverterPoller::_recordScrape(const Session& session, bool isSuccess) {
+    auto latency = session.inverter->getLastScrapeLatency();
+    uint32_t activePower = session.inverter->getLatestData().totalActivePower;
+
+    std::lock_guard<std::mutex> lock(_statisticsMutex);
+    auto& statistics = _statistics[session.index];
+    ++statistics.scrapes;
+    if (!isSuccess) {
+        ++statistics.failures;
+    }
+    statistics.totalLatency += latency;
+    statistics.maxLatency = std::max(statistics.maxLatency, latency);
+    statistics.lastActivePower = activePower;
+}
+
+void MultiInverterPoller::_setConnected(const Session& session, bool isConnected) {
+    std::lock_guard<std::mutex> lock(_statisticsMutex);
+    _statistics[session.index].isConnected = isConnected;
+}
@@ -0,0 +1,54 @@
+#include "poll_scheduler.hpp"
+#include <algorithm>
+
+PollScheduler::PollScheduler(clock::time_point epoch)
+    : _epoch(epoch) {}
+
+void PollScheduler::addGroup(const PollGroup& group) {
+    _entries.push_back({group, _epoch + group.phase});
+}
+
+const PollGroup& PollScheduler::getGroup(size_t index) const {
+    return _entries.at(index).group;
+}
+
+std::vector<size_t> PollScheduler::collectDue(clock::time_point now) {
+    std::vector<size_t> due;
+
+    for (size_t i = 0; i < _entries.size(); i++) {
+        auto& entry = _entries[i];
+        if (entry.nextDue > now) {
+            continue;
+        }
+
+        due.push_back(i);
+
+        if (entry.group.period <= clock::duration::zero()) {
+            entry.nextDue = clock::time_point::max();
+            continue;
+        }
+
+        // Skip any ticks missed while a slow read was running
+        auto missedPeriods = (now - entry.nextDue) / entry.group.period;
+        entry.nextDue += entry.group.period * (missedPeriods + 1);
+    }
+
+    return due;
+}
+
+PollScheduler::clock::time_point PollScheduler::getNextDeadline() const {
+    auto next = clock::time_point::max();
+    for (const auto& entry : _entries) {
+        next = std::min(next, entry.nextDue);
+    }
+    return next;
+}
+
+std::vector<RegisterSpan> PollScheduler::mergeSpans(const std::vector<size_t>& groups) const {
+    std::vector<RegisterSpan> spans;
+    for (size_t index : groups) {
+        const auto& groupSpans = _entries.at(index).group.spans;
+        spans.insert(spans.end(), groupSpans.begin(), groupSpans.end());
+    }
+    return spans;
+}
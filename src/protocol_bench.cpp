@@ -0,0 +1,592 @@
+#include "sungrow_client.hpp"
+#include "sungrow_crypto.hpp"
+#include "capture_replayer.hpp"
+#include "sungrow_inverter.hpp"
+#include "data_converter.hpp"
+#include "register_map.hpp"
+#include "inverter_simulator.hpp"
+#include "snapshot_publisher.hpp"
+#include "change_detector.hpp"
+#include "trace.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every heap allocation in the process goes through these, so a benchmark
+// can read the counters before and after its loop
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<uint64_t> allocatedBytes{0};
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+template <typename Operation>
+BenchResult runBench(const std::string& name, uint64_t iterations, Operation&& operation) {
+    // Warm up so one-time setup inside the operation is not counted
+    for (uint64_t i = 0; i < iterations / 100 + 1; i++) {
+        operation(i);
+    }
+    
+    uint64_t allocationsBefore = allocationCount.load();
+    uint64_t bytesBefore = allocatedBytes.load();
+    auto start = std::chrono::steady_clock::now();
+    
+    for (uint64_t i = 0; i < iterations; i++) {
+        operation(i);
+    }
+    
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    
+    // Read the counters before building the result; copying the name may allocate
+    uint64_t allocations = allocationCount.load() - allocationsBefore;
+    uint64_t bytes = allocatedBytes.load() - bytesBefore;
+    return {
+        name,
+        iterations,
+        elapsed / iterations,
+        static_cast<double>(allocations) / iterations,
+        static_cast<double>(bytes) / iterations
+    };
+}
+
+void printResult(const BenchResult& result) {
+    std::cout << std::left << std::setw(32) << result.name << std::right
+              << std::setw(12) << result.iterations
+              << std::setw(12) << std::fixed << std::setprecision(1) << result.nsPerOp
+              << std::setw(12) << std::setprecision(2) << result.allocsPerOp
+              << std::setw(12) << std::setprecision(1) << result.bytesPerOp << std::endl;
+}
+
+bool writeJson(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream output(path);
+    if (!output) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    
+    output << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& result = results[i];
+        output << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+               << std::fixed << std::setprecision(3)
+               << ", \"ns_per_op\": " << result.nsPerOp
+               << ", \"allocs_per_op\": " << result.allocsPerOp
+               << ", \"bytes_per_op\": " << result.bytesPerOp << "}"
+               << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    output << "  ]\n}\n";
+    return true;
+}
+
+// volatile sink keeps the optimizer from discarding the measured work
+volatile uint64_t sink = 0;
+
+void benchRequestPath(SungrowCrypto& crypto, uint64_t iterations, std::vector<BenchResult>& results) {
+    const ModbusReadRequest request{0x04, 5003, 30};
+    
+    results.push_back(runBench("request build", iterations, [&](uint64_t i) {
+        uint8_t frame[SungrowTcpClient::READ_REQUEST_SIZE];
+        SungrowTcpClient::encodeReadRequest(frame, static_cast<uint16_t>(i), 1, request);
+        sink = sink + frame[1];
+    }));
+    
+    results.push_back(runBench("request build + encrypt", iterations, [&](uint64_t i) {
+        uint8_t frame[SungrowCrypto::CRYPTO_HEADER_SIZE + SungrowCrypto::getPaddedSize(SungrowTcpClient::READ_REQUEST_SIZE)];
+        SungrowTcpClient::encodeReadRequest(frame + SungrowCrypto::CRYPTO_HEADER_SIZE, static_cast<uint16_t>(i), 1, request);
+        size_t size = crypto.encryptFrameInPlace(frame, SungrowTcpClient::READ_REQUEST_SIZE, sizeof(frame));
+        sink = sink + frame[size - 1];
+    }));
+    
+    results.push_back(runBench("vector encryptFrame", iterations, [&](uint64_t i) {
+        std::vector<uint8_t> frame(SungrowTcpClient::READ_REQUEST_SIZE);
+        SungrowTcpClient::encodeReadRequest(frame.data(), static_cast<uint16_t>(i), 1, request);
+        auto encrypted = crypto.encryptFrame(frame);
+        sink = sink + encrypted.back();
+    }));
+}
+
+void benchResponsePath(SungrowCrypto& crypto, uint64_t iterations, std::vector<BenchResult>& results) {
+    constexpr size_t BATCH_FRAMES = 8;
+    constexpr uint16_t RESPONSE_REGISTERS = 30;
+    
+    std::vector<uint8_t> plainResponse = {0x00, 0x01, 0x00, 0x00, 0x00, 3 + RESPONSE_REGISTERS * 2, 0x01, 0x04, RESPONSE_REGISTERS * 2};
+    for (uint16_t i = 0; i < RESPONSE_REGISTERS; i++) {
+        plainResponse.push_back(0x13);
+        plainResponse.push_back(static_cast<uint8_t>(i));
+    }
+    
+    // Responses are encrypted once up front; decrypting in place twice would
+    // only garble them, which costs the same as decrypting real ciphertext
+    auto encryptedResponse = crypto.encryptFrame(plainResponse);
+    
+    std::vector<uint8_t> responseBuffer = encryptedResponse;
+    results.push_back(runBench("response decrypt in place", iterations, [&](uint64_t) {
+        std::copy(encryptedResponse.begin(), encryptedResponse.end(), responseBuffer.begin());
+        size_t size = crypto.decryptFrameInPlace(responseBuffer);
+        sink = sink + responseBuffer[size];
+    }));
+    
+    results.push_back(runBench("vector decryptFrame", iterations, [&](uint64_t) {
+        auto decrypted = crypto.decryptFrame(encryptedResponse);
+        sink = sink + decrypted.back();
+    }));
+    
+    std::vector<uint8_t> batchStream;
+    for (size_t i = 0; i < BATCH_FRAMES; i++) {
+        batchStream.insert(batchStream.end(), encryptedResponse.begin(), encryptedResponse.end());
+    }
+    std::vector<uint8_t> batchBuffer = batchStream;
+    std::vector<std::span<const uint8_t>> plainFrames;
+    plainFrames.reserve(BATCH_FRAMES);
+    auto batch = runBench("batch decrypt (per frame)", iterations / BATCH_FRAMES, [&](uint64_t) {
+        std::copy(batchStream.begin(), batchStream.end(), batchBuffer.begin());
+        plainFrames.clear();
+        crypto.decryptFrames(batchBuffer, plainFrames);
+        sink = sink + plainFrames.back().front();
+    });
+    batch.iterations *= BATCH_FRAMES;
+    batch.nsPerOp /= BATCH_FRAMES;
+    batch.allocsPerOp /= BATCH_FRAMES;
+    batch.bytesPerOp /= BATCH_FRAMES;
+    results.push_back(batch);
+    
+    std::vector<uint16_t> registers;
+    registers.reserve(RESPONSE_REGISTERS);
+    results.push_back(runBench("response parse", iterations, [&](uint64_t) {
+        SungrowTcpClient::parseReadResponse(plainResponse, registers);
+        sink = sink + registers.back();
+    }));
+}
+
+void benchConverter(uint64_t iterations, std::vector<BenchResult>& results) {
+    ModbusDataConverter converter;
+    std::vector<uint16_t> serial = {0x4132, 0x3131, 0x3035, 0x3535, 0x3039, 0, 0, 0, 0, 0};
+    
+    results.push_back(runBench("convertU32 + applyAccuracy", iterations, [&](uint64_t i) {
+        uint32_t raw = converter.convertU32(static_cast<uint16_t>(i >> 16), static_cast<uint16_t>(i));
+        sink = sink + static_cast<uint64_t>(converter.applyAccuracy(raw, 0.1));
+    }));
+    
+    results.push_back(runBench("convertS16", iterations, [&](uint64_t i) {
+        sink = sink + converter.convertS16(static_cast<uint16_t>(i));
+    }));
+    
+    results.push_back(runBench("convertUTF8 (serial)", iterations, [&](uint64_t) {
+        sink = sink + converter.convertUTF8(serial, 0, serial.size()).size();
+    }));
+}
+
+const char* getSimdName(simd_level level) {
+    switch (level) {
+        case simd_level::SCALAR: return "scalar";
+        case simd_level::SSE2: return "sse2";
+        case simd_level::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+// Decodes a full 100-register block at every supported SIMD level and
+// checks each level against the scalar result
+bool benchBulkDecode(uint64_t iterations, std::vector<BenchResult>& results) {
+    constexpr size_t BLOCK_REGISTERS = 100;
+    constexpr size_t SENTINEL_STRIDE = 7;
+    
+    std::vector<uint8_t> payload(BLOCK_REGISTERS * 2);
+    for (size_t i = 0; i < BLOCK_REGISTERS; i++) {
+        uint16_t word = (i % SENTINEL_STRIDE == 0) ? 0xFFFF : static_cast<uint16_t>(i * 977);
+        payload[2 * i] = static_cast<uint8_t>(word >> 8);
+        payload[2 * i + 1] = static_cast<uint8_t>(word);
+    }
+    
+    std::vector<double> values(BLOCK_REGISTERS);
+    std::vector<uint64_t> validity(2);
+    bool isConsistent = true;
+    
+    ModbusDataConverter converter;
+    results.push_back(runBench("per-value decode U16 x100", iterations, [&](uint64_t) {
+        for (size_t i = 0; i < BLOCK_REGISTERS; i++) {
+            uint16_t word = static_cast<uint16_t>((payload[2 * i] << 8) | payload[2 * i + 1]);
+            values[i] = converter.applyAccuracy(converter.convertU16(word), 0.1);
+        }
+        sink = sink + static_cast<uint64_t>(values.back());
+    }));
+    
+    for (register_type type : {register_type::U16, register_type::S16, register_type::U32}) {
+        std::vector<double> expectedValues(BLOCK_REGISTERS);
+        std::vector<uint64_t> expectedValidity(2);
+        converter.setSimdLevel(simd_level::SCALAR);
+        size_t count = converter.decodeBlock(payload, type, 0.1, expectedValues, expectedValidity);
+        
+        for (int level = 0; level <= static_cast<int>(ModbusDataConverter::getSupportedSimdLevel()); level++) {
+            converter.setSimdLevel(static_cast<simd_level>(level));
+            std::fill(validity.begin(), validity.end(), 0);  // Only the words holding values are rewritten
+            converter.decodeBlock(payload, type, 0.1, values, validity);
+            if (!std::equal(values.begin(), values.begin() + count, expectedValues.begin()) || validity != expectedValidity) {
+                std::cerr << "Bulk decode mismatch at " << getSimdName(converter.getSimdLevel()) << std::endl;
+                isConsistent = false;
+            }
+            
+            std::string typeName = type == register_type::U16 ? "U16" : type == register_type::S16 ? "S16" : "U32";
+            results.push_back(runBench("bulk decode " + typeName + " x100 (" + getSimdName(converter.getSimdLevel()) + ")", iterations, [&](uint64_t) {
+                sink = sink + converter.decodeBlock(payload, type, 0.1, values, validity);
+            }));
+        }
+    }
+    
+    return isConsistent;
+}
+
+// Decodes a full layout of mixed register types at every supported SIMD
+// level and checks each level against the per-value converters, then
+// decodes a whole register group through RegisterMap
+bool benchLaneDecode(uint64_t iterations, std::vector<BenchResult>& results) {
+    constexpr register_type TYPES[] = {register_type::U16, register_type::S16, register_type::U32};
+    constexpr uint32_t WORDS[] = {0xFFFF, 0x7FFF, 0x8000, 0x1234, 0xFF80, 0xFFFFFFFF, 0x7FFFFFFF, 0x12345678};
+    
+    ModbusDataConverter converter;
+    LaneLayout layout;
+    std::array<uint32_t, LaneLayout::MAX_LANES> raw{};
+    std::array<double, LaneLayout::MAX_LANES> expectedValues{};
+    uint64_t expectedValidity = 0;
+    for (size_t lane = 0; lane < LaneLayout::MAX_LANES; lane++) {
+        register_type type = TYPES[lane % 3];
+        double scale = lane % 2 == 0 ? 1.0 : 0.1;
+        uint32_t word = WORDS[lane % 8];
+        if (type != register_type::U32) {
+            word &= 0xFFFF;
+        }
+        layout.addLane(type, scale);
+        raw[lane] = word;
+        
+        uint16_t high = static_cast<uint16_t>(word >> 16);
+        uint16_t low = static_cast<uint16_t>(word);
+        bool isValid = type == register_type::U16 ? !converter.isInvalidU16(low) :
+                       type == register_type::S16 ? low != 0xFFFF && low != 0x7FFF : !converter.isInvalidU32(high, low);
+        expectedValues[lane] = type == register_type::U16 ? converter.applyAccuracy(converter.convertU16(low), scale) :
+                               type == register_type::S16 ? converter.convertS16(low) * scale :
+                               converter.applyAccuracy(converter.convertU32(high, low), scale);
+        expectedValidity |= static_cast<uint64_t>(isValid) << lane;
+    }
+    
+    std::array<double, LaneLayout::MAX_LANES> values{};
+    bool isConsistent = true;
+    for (int level = 0; level <= static_cast<int>(ModbusDataConverter::getSupportedSimdLevel()); level++) {
+        converter.setSimdLevel(static_cast<simd_level>(level));
+        uint64_t validity = converter.decodeLanes(layout, raw, values);
+        if (values != expectedValues || validity != expectedValidity) {
+            std::cerr << "Lane decode mismatch at " << getSimdName(converter.getSimdLevel()) << std::endl;
+            isConsistent = false;
+        }
+        
+        results.push_back(runBench(std::string("lane decode x32 (") + getSimdName(converter.getSimdLevel()) + ")", iterations, [&](uint64_t) {
+            sink = sink + converter.decodeLanes(layout, raw, values);
+        }));
+    }
+    
+    RegisterImage image;
+    image.store(RegisterMap::INPUT_REGISTERS, 5003, std::vector<uint16_t>(111, 0x1234));
+    InverterData data;
+    results.push_back(runBench("map decode daily energy", iterations, [&](uint64_t) {
+        sink = sink + RegisterMap::decode(register_group::DAILY_ENERGY, image, data);
+    }));
+    
+    return isConsistent;
+}
+
+// Publishes snapshots whose numeric fields all carry the same counter, so a
+// reader that sees mixed values has observed a torn copy
+bool benchSnapshot(uint64_t iterations, std::vector<BenchResult>& results) {
+    constexpr size_t READER_THREADS = 4;
+    
+    SnapshotPublisher publisher;
+    InverterData data;
+    auto setAll = [&data](uint64_t counter) {
+        RegisterMap::forEachNumericField([&](const auto& field) {
+            using Value = std::remove_reference_t<decltype(data.*field.target)>;
+            data.*field.target = static_cast<Value>(counter % 60000);
+        });
+    };
+    
+    results.push_back(runBench("snapshot publish", iterations, [&](uint64_t i) {
+        setAll(i);
+        publisher.publish(data, std::chrono::system_clock::time_point{});
+    }));
+    
+    InverterSnapshot snapshot;
+    results.push_back(runBench("snapshot read", iterations, [&](uint64_t) {
+        publisher.readIfNewer(0, snapshot);
+        sink = sink + snapshot.generation;
+    }));
+    
+    std::atomic<bool> isRunning{true};
+    std::atomic<uint64_t> tornReads{0};
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < READER_THREADS; i++) {
+        readers.emplace_back([&] {
+            InverterSnapshot copy;
+            while (isRunning.load(std::memory_order_relaxed)) {
+                if (publisher.readIfNewer(0, copy) &&
+                    !std::all_of(copy.values.begin(), copy.values.end(), [&](double value) { return value == copy.values[0]; })) {
+                    tornReads.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    
+    results.push_back(runBench("snapshot publish (4 readers)", iterations, [&](uint64_t i) {
+        setAll(i);
+        publisher.publish(data, std::chrono::system_clock::time_point{});
+    }));
+    
+    isRunning = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    
+    if (tornReads.load() > 0) {
+        std::cerr << tornReads.load() << " torn snapshot reads" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Replays a synthetic day at 1 Hz: power follows the sun, voltage and
+// temperature jitter within their deadbands, energy counters step slowly
+void benchChangeDetection(std::vector<BenchResult>& results) {
+    constexpr uint64_t SECONDS_PER_DAY = 86400;
+    constexpr double PI = 3.14159265358979;
+    
+    std::vector<InverterSnapshot> day(SECONDS_PER_DAY);
+    InverterData data;
+    for (uint64_t second = 0; second < SECONDS_PER_DAY; second++) {
+        double sun = std::max(0.0, -std::cos(2.0 * PI * second / SECONDS_PER_DAY));
+        uint32_t noise = sun > 0.0 ? static_cast<uint32_t>(second * 7919 % 50) : 0;
+        data.totalActivePower = static_cast<uint32_t>(sun * 5000.0) + noise;
+        data.phaseAVoltage = 240.0 + 0.1 * static_cast<double>(second % 7);
+        data.internalTemperature = 20.0 + 15.0 * sun + 0.1 * static_cast<double>(second % 3);
+        data.dailyPowerYields = std::floor(second / 600.0 * sun) * 0.1;
+        
+        SnapshotPublisher publisher;
+        publisher.publish(data, std::chrono::system_clock::time_point(std::chrono::seconds(second)));
+        day[second] = publisher.read();
+    }
+    
+    ChangeDetector detector;
+    uint64_t emittedFields = 0;
+    for (const auto& snapshot : day) {
+        emittedFields += detector.update(snapshot).mask.count();
+    }
+    
+    ChangeDetector timedDetector;
+    results.push_back(runBench("change detect (1 Hz day)", SECONDS_PER_DAY, [&](uint64_t i) {
+        sink = sink + timedDetector.update(day[i % SECONDS_PER_DAY]).mask.count();
+    }));
+    
+    uint64_t totalFields = SECONDS_PER_DAY * RegisterMap::NUMERIC_FIELD_COUNT;
+    std::cout << "Change detection: " << emittedFields << " of " << totalFields << " field values emitted ("
+              << std::fixed << std::setprecision(1) << 100.0 * emittedFields / totalFields << "%)" << std::endl;
+}
+
+bool benchLoopbackScrape(uint64_t iterations, std::vector<BenchResult>& results) {
+    boost::asio::io_context simulatorContext;
+    auto registers = std::make_shared<SimulatedRegisterMap>(SimulatedRegisterMap::createDefault());
+    InverterSimulator simulator(simulatorContext, "127.0.0.1", 0, registers);
+    simulator.start();
+    std::thread simulatorThread([&] { simulatorContext.run(); });
+    
+    InverterConfig config;
+    config.host = "127.0.0.1";
+    config.port = simulator.getPort();
+    
+    bool isConnected = false;
+    {
+        SungrowInverter inverter(config);
+        isConnected = inverter.connect();
+        if (isConnected) {
+            results.push_back(runBench("scrapeData (loopback)", iterations, [&](uint64_t) {
+                sink = sink + inverter.scrapeData();
+            }));
+        } else {
+            std::cerr << "Cannot connect to the in-process simulator" << std::endl;
+        }
+    }
+    
+    simulator.stop();
+    simulatorContext.stop();
+    simulatorThread.join();
+    return isConnected;
+}
+
+// Decodes a solar_monitor --capture through the receive path; any decrypt,
+// parse or matching failure is reported as a regression
+bool replayCapture(const std::string& path, replay_speed speed, std::vector<BenchResult>& results) {
+    std::unique_ptr<CaptureReplayer> replayer;
+    try {
+        replayer = std::make_unique<CaptureReplayer>(path);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    
+    const auto& capture = replayer->getCapture();
+    std::cout << "Replaying " << capture.records.size() << " records spanning "
+              << std::fixed << std::setprecision(1) << capture.getDuration().count() / 1e6 << " s"
+              << (speed == replay_speed::RECORDED ? " at recorded speed" : " as fast as possible") << std::endl;
+    
+    // Warm up like runBench; the first cipher setup costs more than a short capture
+    if (speed == replay_speed::MAX) {
+        replayer->replay(speed);
+    }
+    
+    uint64_t allocationsBefore = allocationCount.load();
+    uint64_t bytesBefore = allocatedBytes.load();
+    auto statistics = replayer->replay(speed);
+    uint64_t allocations = allocationCount.load() - allocationsBefore;
+    uint64_t bytes = allocatedBytes.load() - bytesBefore;
+    
+    double seconds = std::max(statistics.elapsed.count() / 1e6, 1e-9);
+    std::cout << statistics.connections << " connections, " << statistics.requests << " requests, "
+              << statistics.responses << " responses decoded, " << statistics.exceptions << " Modbus exceptions" << std::endl;
+    std::cout << statistics.decryptFailures << " decrypt failures, " << statistics.parseFailures << " parse failures, "
+              << statistics.unmatched << " unmatched responses" << std::endl;
+    std::cout << std::setprecision(0) << statistics.responses / seconds << " responses/s, "
+              << std::setprecision(2) << statistics.bytes / seconds / 1e6 << " MB/s in " << std::setprecision(1)
+              << statistics.elapsed.count() / 1000.0 << " ms" << std::endl;
+    
+    // Recorded-speed timings are mostly sleeping, so only a flat-out replay is a benchmark
+    uint64_t decoded = statistics.responses + statistics.exceptions;
+    if (speed == replay_speed::MAX && decoded != 0) {
+        results.push_back({"capture replay (per response)", decoded, statistics.elapsed.count() * 1000.0 / decoded,
+                           static_cast<double>(allocations) / decoded, static_cast<double>(bytes) / decoded});
+    }
+    
+    if (statistics.hasRegressions()) {
+        std::cerr << "Replay of " << path << " found frames the receive path can no longer handle" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    constexpr uint64_t SCRAPE_ITERATION_DIVISOR = 500;
+    
+    uint64_t iterations = 1000000;
+    std::string jsonPath;
+    std::string replayPath;
+    replay_speed replaySpeed = replay_speed::MAX;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::stoull(argv[++i]);
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (arg == "--replay-speed" && i + 1 < argc) {
+            std::string speed = argv[++i];
+            if (speed != "recorded" && speed != "max") {
+                std::cerr << "Replay speed must be recorded or max: " << speed << std::endl;
+                return 1;
+            }
+            replaySpeed = speed == "recorded" ? replay_speed::RECORDED : replay_speed::MAX;
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--iterations <n>] [--json <file>]\n"
+                      << "       " << argv[0] << " --replay <capture> [--replay-speed recorded|max] [--json <file>]" << std::endl;
+            return 1;
+        }
+    }
+    
+    // Tracing would be measured along with the protocol work
+    Trace::setLevel(trace_level::OFF);
+    
+    if (!replayPath.empty()) {
+        std::vector<BenchResult> results;
+        bool isClean = replayCapture(replayPath, replaySpeed, results);
+        for (const auto& result : results) {
+            printResult(result);
+        }
+        if (!jsonPath.empty() && !writeJson(jsonPath, results)) {
+            return 1;
+        }
+        return isClean ? 0 : 1;
+    }
+    
+    // Any fixed key will do; only the cost of the cipher matters here
+    SungrowCrypto crypto;
+    std::vector<uint8_t> publicKey(16, 0x5A);
+    if (!crypto.initializeEncryption(publicKey)) {
+        std::cerr << "Failed to initialize encryption" << std::endl;
+        return 1;
+    }
+    
+    std::vector<BenchResult> results;
+    benchRequestPath(crypto, iterations, results);
+    benchResponsePath(crypto, iterations, results);
+    benchConverter(iterations, results);
+    bool isDecodeConsistent = benchBulkDecode(iterations, results);
+    isDecodeConsistent = benchLaneDecode(iterations, results) && isDecodeConsistent;
+    bool isSnapshotConsistent = benchSnapshot(iterations, results);
+    benchChangeDetection(results);
+    bool hasScraped = benchLoopbackScrape(std::max<uint64_t>(iterations / SCRAPE_ITERATION_DIVISOR, 1), results);
+    
+    std::cout << "\n" << std::left << std::setw(32) << "Benchmark" << std::right << std::setw(12) << "Iterations"
+              << std::setw(12) << "ns/op" << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op" << std::endl;
+    for (const auto& result : results) {
+        printResult(result);
+    }
+    
+    if (!jsonPath.empty() && !writeJson(jsonPath, results)) {
+        return 1;
+    }
+    
+    // The request and response hot paths must stay allocation-free
+    for (const auto& result : results) {
+        bool isHotPath = result.name == "request build + encrypt" || result.name == "response decrypt in place" ||
+                         result.name == "batch decrypt (per frame)" || result.name == "response parse" ||
+                         result.name.starts_with("bulk decode") || result.name.starts_with("lane decode") ||
+                         result.name.starts_with("map decode") || result.name.starts_with("snapshot") ||
+                         result.name.starts_with("change detect");
+        if (isHotPath && result.allocsPerOp != 0.0) {
+            std::cerr << result.name << " allocated on the hot path" << std::endl;
+            return 1;
+        }
+    }
+    return hasScraped && isDecodeConsistent && isSnapshotConsistent ? 0 : 1;
+}
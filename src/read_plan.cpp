@@ -0,0 +1,125 @@
+#include "read_plan.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+void RegisterImage::clear() {
+    _blocks.clear();
+}
+
+void RegisterImage::store(uint8_t functionCode, uint16_t startAddr, const std::vector<uint16_t>& values) {
+    _blocks.push_back({functionCode, startAddr, values});
+}
+
+bool RegisterImage::contains(uint8_t functionCode, uint16_t address, uint16_t count) const {
+    // A span may run across adjacent blocks, e.g. one longer than a Modbus read
+    for (uint32_t next = address; next < static_cast<uint32_t>(address) + count; next++) {
+        if (next > UINT16_MAX || !_findBlock(functionCode, static_cast<uint16_t>(next))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint16_t RegisterImage::get(uint8_t functionCode, uint16_t address) const {
+    const Block* block = _findBlock(functionCode, address);
+    if (!block) {
+        throw std::out_of_range("Register " + std::to_string(address) + " was not read");
+    }
+    return block->values[address - block->startAddr];
+}
+
+const RegisterImage::Block* RegisterImage::_findBlock(uint8_t functionCode, uint16_t address) const {
+    // Later blocks win so a retried read replaces an earlier one
+    for (auto it = _blocks.rbegin(); it != _blocks.rend(); ++it) {
+        uint32_t blockEnd = static_cast<uint32_t>(it->startAddr) + it->values.size();
+        if (it->functionCode == functionCode && address >= it->startAddr && address < blockEnd) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+ReadPlanCompiler::ReadPlanCompiler(uint16_t maxGap)
+    : _maxGap(maxGap) {}
+
+uint16_t ReadPlanCompiler::getMaxGap() const {
+    return _maxGap;
+}
+
+void ReadPlanCompiler::setMaxGap(uint16_t maxGap) {
+    _maxGap = maxGap;
+}
+
+void ReadPlanCompiler::addIllegalRange(const RegisterRange& range) {
+    // Cached plans and discovery maps often repeat each other's ranges
+    bool isKnown = std::any_of(_illegalRanges.begin(), _illegalRanges.end(), [&](const RegisterRange& known) {
+        return known.functionCode == range.functionCode && known.startAddr == range.startAddr && known.count == range.count;
+    });
+    if (!isKnown) {
+        _illegalRanges.push_back(range);
+    }
+}
+
+const std::vector<RegisterRange>& ReadPlanCompiler::getIllegalRanges() const {
+    return _illegalRanges;
+}
+
+bool ReadPlanCompiler::isIllegal(uint8_t functionCode, uint16_t address) const {
+    return !_isGapReadable(functionCode, address, static_cast<uint32_t>(address) + 1);
+}
+
+std::vector<RegisterRange> ReadPlanCompiler::compile(std::vector<RegisterSpan> wanted) const {
+    std::sort(wanted.begin(), wanted.end(), [](const RegisterSpan& a, const RegisterSpan& b) {
+        return a.functionCode != b.functionCode ? a.functionCode < b.functionCode : a.address < b.address;
+    });
+
+    std::vector<RegisterRange> blocks;
+    for (const auto& span : wanted) {
+        uint32_t spanStart = span.address;
+        uint32_t spanEnd = spanStart + span.count;
+
+        if (!blocks.empty() && blocks.back().functionCode == span.functionCode) {
+            auto& block = blocks.back();
+            uint32_t blockEnd = static_cast<uint32_t>(block.startAddr) + block.count;
+            uint32_t mergedEnd = std::max(blockEnd, spanEnd);
+            bool fitsInBlock = mergedEnd - block.startAddr <= MAX_BLOCK_REGISTERS;
+            bool isBridgeable = spanStart <= blockEnd ||
+                (spanStart - blockEnd <= _maxGap && _isGapReadable(span.functionCode, blockEnd, spanStart));
+
+            // A span that does not fit starts a block of its own, re-reading
+            // any overlap so no field is split between two blocks
+            if (fitsInBlock && isBridgeable) {
+                block.count = static_cast<uint16_t>(mergedEnd - block.startAddr);
+                continue;
+            }
+        }
+
+        // Spans longer than one Modbus read are split across several blocks
+        while (spanStart < spanEnd) {
+            uint32_t count = std::min<uint32_t>(spanEnd - spanStart, MAX_BLOCK_REGISTERS);
+            blocks.push_back({static_cast<uint16_t>(spanStart), static_cast<uint16_t>(count), span.functionCode});
+            spanStart += count;
+        }
+    }
+
+    return blocks;
+}
+
+std::vector<ModbusReadRequest> ReadPlanCompiler::toRequests(const std::vector<RegisterRange>& blocks) {
+    std::vector<ModbusReadRequest> requests;
+    requests.reserve(blocks.size());
+    for (const auto& block : blocks) {
+        requests.push_back({block.functionCode, block.startAddr, block.count});
+    }
+    return requests;
+}
+
+bool ReadPlanCompiler::_isGapReadable(uint8_t functionCode, uint32_t gapStart, uint32_t gapEnd) const {
+    for (const auto& illegal : _illegalRanges) {
+        uint32_t illegalEnd = static_cast<uint32_t>(illegal.startAddr) + illegal.count;
+        if (illegal.functionCode == functionCode && illegal.startAddr < gapEnd && gapStart < illegalEnd) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,196 @@
+#include "register_map.hpp"
+#include "data_converter.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace {
+    const ModbusDataConverter CONVERTER;
+    constexpr size_t NO_LANE = LaneLayout::MAX_LANES;
+    
+    using RawLanes = std::array<uint32_t, LaneLayout::MAX_LANES>;
+    using DecodedLanes = std::array<double, LaneLayout::MAX_LANES>;
+    
+    // The decode lanes of one group's numeric fields in table order, and the
+    // lane of each entry of FIELDS (NO_LANE outside the group)
+    struct GroupLanes {
+        LaneLayout layout;
+        std::array<size_t, RegisterMap::FIELD_COUNT> fieldLanes{};
+    };
+    
+    template <register_group Group, typename Field>
+    constexpr size_t addLane(LaneLayout& layout, const Field& field) {
+        if (field.group != Group || Field::TYPE == register_type::UTF8) {
+            return NO_LANE;
+        }
+        return layout.addLane(Field::TYPE, field.scale);
+    }
+    
+    template <register_group Group>
+    constexpr GroupLanes buildGroupLanes() {
+        GroupLanes lanes;
+        size_t index = 0;
+        std::apply([&](const auto&... fields) {
+            ((lanes.fieldLanes[index++] = addLane<Group>(lanes.layout, fields)), ...);
+        }, RegisterMap::FIELDS);
+        return lanes;
+    }
+    
+    template <register_group Group>
+    constexpr GroupLanes GROUP_LANES = buildGroupLanes<Group>();
+    
+    std::string readUTF8(const RegisterImage& image, uint8_t functionCode, uint16_t address, uint16_t count) {
+        std::string text;
+        text.reserve(count * 2);
+        for (uint16_t i = 0; i < count; ++i) {
+            uint16_t word = image.get(functionCode, address + i);
+            text += static_cast<char>(word >> 8);
+            text += static_cast<char>(word & 0xFF);
+        }
+        text.erase(std::find(text.begin(), text.end(), '\0'), text.end());
+        return text;
+    }
+    
+    // The register word, or both words of a U32 with the high one first
+    template <typename Field>
+    uint32_t gatherRaw(const Field& field, const RegisterImage& image) {
+        uint32_t raw = image.get(field.functionCode, field.address);
+        if constexpr (Field::TYPE == register_type::U32) {
+            raw = (raw << 16) | image.get(field.functionCode, field.address + 1);
+        }
+        return raw;
+    }
+    
+    // Fields outside Group compile to nothing. With IsChecked false the
+    // caller has verified the whole group is present, so the gather is
+    // straight-line loads. Strings decode here; numeric fields only collect
+    // their raw lane value.
+    template <register_group Group, bool IsChecked, size_t Index>
+    void gatherIfInGroup(const RegisterImage& image, InverterData& data, RawLanes& raw, uint64_t& gathered) {
+        constexpr const auto& field = std::get<Index>(RegisterMap::FIELDS);
+        if constexpr (field.group == Group) {
+            if constexpr (IsChecked) {
+                if (!image.contains(field.functionCode, field.address, field.count)) {
+                    return;
+                }
+            }
+            if constexpr (std::decay_t<decltype(field)>::TYPE == register_type::UTF8) {
+                data.*field.target = readUTF8(image, field.functionCode, field.address, field.count);
+            } else {
+                constexpr size_t LANE = GROUP_LANES<Group>.fieldLanes[Index];
+                raw[LANE] = gatherRaw(field, image);
+                gathered |= uint64_t{1} << LANE;
+            }
+        }
+    }
+    
+    template <register_group Group, size_t Index>
+    void assignIfGathered(const DecodedLanes& values, uint64_t gathered, InverterData& data) {
+        constexpr const auto& field = std::get<Index>(RegisterMap::FIELDS);
+        using Value = std::remove_cvref_t<decltype(data.*field.target)>;
+        static_assert(std::is_floating_point_v<Value> || field.scale == 1.0,
+                      "Integer targets drop the scale; give the field a floating point target");
+        if constexpr (field.group == Group && std::decay_t<decltype(field)>::TYPE != register_type::UTF8) {
+            constexpr size_t LANE = GROUP_LANES<Group>.fieldLanes[Index];
+            if (gathered & (uint64_t{1} << LANE)) {
+                if constexpr (std::is_floating_point_v<Value>) {
+                    data.*field.target = static_cast<Value>(values[LANE]);
+                } else {
+                    // Through int64_t so a negative S16 wraps rather than being undefined
+                    data.*field.target = static_cast<Value>(static_cast<int64_t>(values[LANE]));
+                }
+            }
+        }
+    }
+    
+    // Gathers the group's raw values, decodes them all in one pass of the
+    // converter, then stores the fields that were present
+    template <register_group Group, bool IsChecked, size_t... Indices>
+    void decodeGroup(const RegisterImage& image, InverterData& data, std::index_sequence<Indices...>) {
+        RawLanes raw{};
+        uint64_t gathered = 0;
+        (gatherIfInGroup<Group, IsChecked, Indices>(image, data, raw, gathered), ...);
+        
+        if constexpr (GROUP_LANES<Group>.layout.count != 0) {
+            DecodedLanes values;
+            CONVERTER.decodeLanes(GROUP_LANES<Group>.layout, raw, values);
+            (assignIfGathered<Group, Indices>(values, gathered, data), ...);
+        }
+    }
+    
+    template <register_group Group>
+    void decodeGroup(const RegisterImage& image, InverterData& data, bool isComplete) {
+        constexpr auto INDICES = std::make_index_sequence<RegisterMap::FIELD_COUNT>{};
+        if (isComplete) {
+            decodeGroup<Group, false>(image, data, INDICES);
+        } else {
+            decodeGroup<Group, true>(image, data, INDICES);
+        }
+    }
+    
+    std::array<std::vector<RegisterSpan>, REGISTER_GROUP_COUNT> buildGroupSpans() {
+        std::array<std::vector<RegisterSpan>, REGISTER_GROUP_COUNT> spans;
+        RegisterMap::forEachField([&spans](const auto& field) {
+            spans[static_cast<size_t>(field.group)].push_back(field.getSpan());
+        });
+        return spans;
+    }
+}
+
+size_t RegisterMap::getNumericFieldIndex(std::string_view name) {
+    size_t index = 0;
+    size_t found = NUMERIC_FIELD_COUNT;
+    forEachNumericField([&](const auto& field) {
+        if (field.name == name) {
+            found = index;
+        }
+        ++index;
+    });
+    return found;
+}
+
+register_group RegisterMap::getNumericFieldGroup(size_t index) {
+    register_group group = register_group::IDENTITY;
+    size_t current = 0;
+    forEachNumericField([&](const auto& field) {
+        if (current++ == index) {
+            group = field.group;
+        }
+    });
+    return group;
+}
+
+std::array<double, RegisterMap::NUMERIC_FIELD_COUNT> RegisterMap::getNumericValues(const InverterData& data) {
+    std::array<double, NUMERIC_FIELD_COUNT> values{};
+    size_t index = 0;
+    forEachNumericField([&](const auto& field) {
+        values[index++] = static_cast<double>(data.*field.target);
+    });
+    return values;
+}
+
+const std::vector<RegisterSpan>& RegisterMap::getSpans(register_group group) {
+    static const auto GROUP_SPANS = buildGroupSpans();
+    return GROUP_SPANS[static_cast<size_t>(group)];
+}
+
+bool RegisterMap::decode(register_group group, const RegisterImage& image, InverterData& data) {
+    bool isComplete = true;
+    for (const auto& span : getSpans(group)) {
+        if (!image.contains(span.functionCode, span.address, span.count)) {
+            isComplete = false;
+            break;
+        }
+    }
+    
+    switch (group) {
+        case register_group::POWER: decodeGroup<register_group::POWER>(image, data, isComplete); break;
+        case register_group::DAILY_ENERGY: decodeGroup<register_group::DAILY_ENERGY>(image, data, isComplete); break;
+        case register_group::LIFETIME_TOTALS: decodeGroup<register_group::LIFETIME_TOTALS>(image, data, isComplete); break;
+        case register_group::IDENTITY: decodeGroup<register_group::IDENTITY>(image, data, isComplete); break;
+    }
+    return isComplete;
+}
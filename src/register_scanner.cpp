@@ -1,5 +1,10 @@
 #include "sungrow_client.hpp"
 #include "data_converter.hpp"
+#include "discovery_map.hpp"
+#include "inverter_config.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <iostream>
 #include <iomanip>
 #include <vector>
@@ -12,8 +17,19 @@ struct RegisterScanResult {
     std::string error;
 };
 
+// Outcome of probing an address area in blocks; ranges are sorted and merged
+struct BlockProbeResult {
+    std::vector<RegisterRange> readable;
+    std::vector<RegisterRange> illegal;     // Rejected with Illegal Data Address
+    std::vector<RegisterRange> unanswered;  // Failed for any other reason
+    uint64_t requests = 0;
+    std::chrono::milliseconds elapsed{0};
+};
+
 class RegisterScanner {
 public:
+    static constexpr uint16_t MAX_BLOCK_REGISTERS = 125;  // Modbus limit for FC 0x03/0x04
+
     RegisterScanner(const std::string& host, uint16_t port = 502, uint8_t slaveId = 1)
         : _client(host, port, slaveId) {}
     
@@ -86,6 +102,136 @@ public:
         }
     }
     
+    // Device code and serial number, the key of a discovery map entry
+    bool readIdentity(uint16_t& deviceCode, std::string& serialNumber) {
+        try {
+            auto code = _client.readInputRegisters(RegisterAddresses::DEVICE_TYPE_ADDR, 1);
+            auto serial = _client.readInputRegisters(RegisterAddresses::SERIAL_START_ADDR, RegisterAddresses::SERIAL_LENGTH);
+            if (code.empty()) {
+                return false;
+            }
+            deviceCode = code[0];
+            serialNumber = ModbusDataConverter().convertUTF8(serial, 0, RegisterAddresses::SERIAL_LENGTH);
+            return true;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Identity read failed: " << e.what() << std::endl;
+        }
+        return false;
+    }
+    
+    // Maps [startAddr, startAddr + count) by reading whole blocks and
+    // bisecting only the blocks the device rejects with Illegal Data
+    // Address, so a mostly readable area costs a handful of requests. Blocks
+    // are pipelined; the window grows while round trips stay near the best
+    // seen and halves, with a pause of one round trip, when they stretch or
+    // a request fails.
+    BlockProbeResult probeBlocks(uint8_t functionCode, uint16_t startAddr, uint32_t count) {
+        constexpr uint8_t INITIAL_WINDOW = 4;
+        constexpr uint8_t MAX_WINDOW = 16;
+        constexpr size_t BLOCKS_PER_WINDOW = 2;  // Keeps the pipeline full across one batch
+        constexpr int64_t ROUND_TRIP_STRETCH_LIMIT = 2;
+        // Below this a rejected block is probed register by register, which
+        // costs less than the rest of the bisection tree when most are illegal
+        constexpr uint16_t SINGLE_PROBE_BLOCK = 8;
+        
+        auto startTime = std::chrono::steady_clock::now();
+        BlockProbeResult result;
+        std::deque<RegisterRange> pending;
+        uint32_t end = std::min<uint32_t>(static_cast<uint32_t>(startAddr) + count, 65536);
+        for (uint32_t address = startAddr; address < end; address += MAX_BLOCK_REGISTERS) {
+            uint16_t blockSize = static_cast<uint16_t>(std::min<uint32_t>(MAX_BLOCK_REGISTERS, end - address));
+            pending.push_back({static_cast<uint16_t>(address), blockSize, functionCode});
+        }
+        
+        uint8_t window = INITIAL_WINDOW;
+        auto bestRoundTrip = std::chrono::microseconds::max();
+        while (!pending.empty()) {
+            if (!_client.isConnected() && !_client.connect()) {
+                std::cerr << "Lost the inverter; " << pending.size() << " blocks left unprobed" << std::endl;
+                result.unanswered.insert(result.unanswered.end(), pending.begin(), pending.end());
+                break;
+            }
+            
+            size_t batchSize = std::min(pending.size(), window * BLOCKS_PER_WINDOW);
+            std::vector<RegisterRange> batch(pending.begin(), pending.begin() + batchSize);
+            pending.erase(pending.begin(), pending.begin() + batchSize);
+            std::vector<ModbusReadRequest> requests;
+            for (const auto& block : batch) {
+                requests.push_back({block.functionCode, block.startAddr, block.count});
+            }
+            
+            ClientStatistics before = _client.getStatistics();
+            _client.setPipelineWindow(window);
+            auto results = _client.readPipelined(requests);
+            const ClientStatistics& after = _client.getStatistics();
+            result.requests += after.requests - before.requests;
+            
+            bool hasFailure = false;
+            for (size_t i = 0; i < batch.size(); i++) {
+                const auto& block = batch[i];
+                if (results[i].success) {
+                    result.readable.push_back(block);
+                } else if (results[i].exceptionCode != ModbusException::ILLEGAL_DATA_ADDRESS) {
+                    result.unanswered.push_back(block);
+                    hasFailure = true;
+                } else if (block.count == 1) {
+                    result.illegal.push_back(block);
+                } else if (block.count <= SINGLE_PROBE_BLOCK) {
+                    for (uint16_t offset = 0; offset < block.count; offset++) {
+                        pending.push_back({static_cast<uint16_t>(block.startAddr + offset), 1, functionCode});
+                    }
+                } else {
+                    uint16_t half = block.count / 2;
+                    pending.push_back({block.startAddr, half, functionCode});
+                    pending.push_back({static_cast<uint16_t>(block.startAddr + half), static_cast<uint16_t>(block.count - half), functionCode});
+                }
+            }
+            
+            uint64_t responses = after.responses - before.responses;
+            if (responses == 0) {
+                window = 1;
+                continue;
+            }
+            auto roundTrip = (after.totalRoundTrip - before.totalRoundTrip) / static_cast<int64_t>(responses);
+            bestRoundTrip = std::min(bestRoundTrip, roundTrip);
+            if (hasFailure || after.timeouts > before.timeouts || roundTrip > bestRoundTrip * ROUND_TRIP_STRETCH_LIMIT) {
+                window = std::max<uint8_t>(window / 2, 1);
+                std::this_thread::sleep_for(roundTrip);
+            } else if (window < MAX_WINDOW) {
+                ++window;
+            }
+        }
+        
+        result.readable = mergeRanges(std::move(result.readable));
+        result.illegal = mergeRanges(std::move(result.illegal));
+        result.unanswered = mergeRanges(std::move(result.unanswered));
+        result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+        return result;
+    }
+    
+    static std::vector<RegisterRange> mergeRanges(std::vector<RegisterRange> ranges) {
+        std::sort(ranges.begin(), ranges.end(), [](const RegisterRange& a, const RegisterRange& b) {
+            return a.startAddr < b.startAddr;
+        });
+        std::vector<RegisterRange> merged;
+        for (const auto& range : ranges) {
+            if (!merged.empty() && merged.back().startAddr + merged.back().count == range.startAddr) {
+                merged.back().count += range.count;
+            } else {
+                merged.push_back(range);
+            }
+        }
+        return merged;
+    }
+    
+    static void printRanges(const char* label, const std::vector<RegisterRange>& ranges) {
+        for (const auto& range : ranges) {
+            std::cout << "  " << label << " " << range.startAddr << "-" << (range.startAddr + range.count - 1)
+                      << " (" << range.count << " registers)" << std::endl;
+        }
+    }
+    
     // Test multi-register reads for 32-bit values
     void testMultiRegisterReads(const std::vector<uint16_t>& workingAddresses) {
         std::cout << "\n=== TESTING MULTI-REGISTER READS ===\n" << std::endl;
@@ -114,11 +260,93 @@ private:
     SungrowTcpClient _client;
 };
 
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [host] [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --port <port>          Inverter port (default: 502)\n";
+    std::cout << "  --probe <first-last>   Map readable registers in the range by block\n";
+    std::cout << "                         probing instead of the fixed register scan\n";
+    std::cout << "  --holding              Probe holding registers (default: input)\n";
+    std::cout << "  --discovery <file>     Record the probe result in a discovery map for\n";
+    std::cout << "                         solar_monitor --discovery\n";
+    std::cout << "  --help                 Show this help message\n";
+    std::cout << std::endl;
+}
+
+bool recordDiscovery(RegisterScanner& scanner, const std::string& path, const BlockProbeResult& result) {
+    DiscoveredDevice device;
+    if (!scanner.readIdentity(device.deviceCode, device.serialNumber)) {
+        std::cerr << "Cannot key the discovery map without the device code and serial number" << std::endl;
+        return false;
+    }
+    device.readable = result.readable;
+    device.illegal = result.illegal;
+    
+    // Keep the other units and register types already in the file
+    DiscoveryMap map;
+    map.load(path);
+    map.mergeDevice(device);
+    try {
+        map.save(path);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Discovery map not saved: " << e.what() << std::endl;
+        return false;
+    }
+    
+    std::cout << "Recorded 0x" << std::hex << device.deviceCode << std::dec << " / " << device.serialNumber
+              << " in " << path << " (" << map.getDevices().size() << " devices)" << std::endl;
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     std::string host = "192.168.1.249";
+    uint16_t port = 502;
+    bool isProbe = false;
+    uint16_t probeFirst = 0;
+    uint16_t probeLast = 0;
+    uint8_t functionCode = 0x04;
+    std::string discoveryPath;
     
-    if (argc > 1) {
-        host = argv[1];
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        
+        if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "--port" && i + 1 < argc) {
+            port = std::stoi(argv[++i]);
+        }
+        else if (arg == "--probe" && i + 1 < argc) {
+            std::string range = argv[++i];
+            size_t dash = range.find('-');
+            if (dash == std::string::npos) {
+                std::cerr << "Probe range must be <first-last>: " << range << std::endl;
+                return 1;
+            }
+            probeFirst = static_cast<uint16_t>(std::stoul(range.substr(0, dash)));
+            probeLast = static_cast<uint16_t>(std::stoul(range.substr(dash + 1)));
+            if (probeLast < probeFirst) {
+                std::cerr << "Probe range is empty: " << range << std::endl;
+                return 1;
+            }
+            isProbe = true;
+        }
+        else if (arg == "--holding") {
+            functionCode = 0x03;
+        }
+        else if (arg == "--discovery" && i + 1 < argc) {
+            discoveryPath = argv[++i];
+        }
+        else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        else {
+            host = arg;
+        }
     }
     
     std::cout << "╔══════════════════════════════════════════════════════════════════════════╗" << std::endl;
@@ -126,9 +354,9 @@ int main(int argc, char* argv[]) {
     std::cout << "║                  Finding Working Register Addresses                     ║" << std::endl;
     std::cout << "╚══════════════════════════════════════════════════════════════════════════╝" << std::endl;
     
-    RegisterScanner scanner(host);
+    RegisterScanner scanner(host, port);
     
-    std::cout << "\nConnecting to SG8K-D inverter at " << host << ":502..." << std::endl;
+    std::cout << "\nConnecting to SG8K-D inverter at " << host << ":" << port << "..." << std::endl;
     
     if (!scanner.connect()) {
         std::cerr << "Failed to connect to inverter!" << std::endl;
@@ -137,6 +365,25 @@ int main(int argc, char* argv[]) {
     
     std::cout << "Connected successfully!" << std::endl;
     
+    if (isProbe) {
+        std::cout << "\n=== PROBING " << (functionCode == 0x03 ? "HOLDING" : "INPUT") << " REGISTERS "
+                  << probeFirst << "-" << probeLast << " ===\n" << std::endl;
+        
+        auto result = scanner.probeBlocks(functionCode, probeFirst, static_cast<uint32_t>(probeLast - probeFirst) + 1);
+        RegisterScanner::printRanges("readable  ", result.readable);
+        RegisterScanner::printRanges("illegal   ", result.illegal);
+        RegisterScanner::printRanges("unanswered", result.unanswered);
+        std::cout << "\n" << result.requests << " requests in " << result.elapsed.count() << " ms" << std::endl;
+        
+        if (!discoveryPath.empty() && !recordDiscovery(scanner, discoveryPath, result)) {
+            scanner.disconnect();
+            return 1;
+        }
+        
+        scanner.disconnect();
+        return result.unanswered.empty() ? 0 : 1;
+    }
+    
     // Scan for working registers
     scanner.scanPowerRegisters();
     
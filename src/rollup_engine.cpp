@@ -0,0 +1,256 @@
+#include "rollup_engine.hpp"
+#include "register_map.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int64_t SECONDS_PER_MINUTE = 60;
+    constexpr int64_t SECONDS_PER_HOUR = 3600;
+    constexpr double SECONDS_PER_HOUR_DOUBLE = 3600.0;
+    constexpr size_t RECORD_SIZE = sizeof(RollupBucket);
+
+    const char* getResolutionName(rollup_resolution resolution) {
+        switch (resolution) {
+            case rollup_resolution::MINUTE: return "minute";
+            case rollup_resolution::HOUR: return "hour";
+            case rollup_resolution::DAY: return "day";
+        }
+        return "unknown";
+    }
+
+    std::string getSeriesPath(const std::string& directory, const std::string& fieldName, rollup_resolution resolution) {
+        return directory + "/" + fieldName + "." + getResolutionName(resolution) + ".rollup";
+    }
+
+    // Unix seconds of the local midnight days after the one starting local's day
+    int64_t getLocalMidnight(const std::tm& local, int days) {
+        std::tm midnight = local;
+        midnight.tm_mday += days;
+        midnight.tm_hour = midnight.tm_min = midnight.tm_sec = 0;
+        midnight.tm_isdst = -1;
+        return std::mktime(&midnight);
+    }
+
+    // Area under the straight line between two samples, in value-hours
+    double getTrapezoid(double startTime, double startValue, double endTime, double endValue) {
+        return (startValue + endValue) / 2.0 * (endTime - startTime) / SECONDS_PER_HOUR_DOUBLE;
+    }
+
+    void mergeBucket(RollupBucket& into, const RollupBucket& from) {
+        if (into.sampleCount == 0) {
+            into.min = from.min;
+            into.max = from.max;
+        } else if (from.sampleCount > 0) {
+            into.min = std::min(into.min, from.min);
+            into.max = std::max(into.max, from.max);
+        }
+        into.sampleCount += from.sampleCount;
+        into.sum += from.sum;
+        into.integral += from.integral;
+    }
+
+    bool readRecord(int fd, int64_t index, RollupBucket& bucket) {
+        return ::pread(fd, &bucket, RECORD_SIZE, static_cast<off_t>(index * RECORD_SIZE)) == static_cast<ssize_t>(RECORD_SIZE);
+    }
+
+    int64_t getRecordCount(int fd) {
+        struct stat status{};
+        ::fstat(fd, &status);
+        return static_cast<int64_t>(status.st_size) / static_cast<int64_t>(RECORD_SIZE);
+    }
+}
+
+double RollupBucket::getMean() const {
+    return sampleCount > 0 ? sum / sampleCount : 0.0;
+}
+
+RollupEngine::RollupEngine(std::string directory, std::vector<std::string> fieldNames)
+    : _directory(std::move(directory)), _fieldNames(std::move(fieldNames)) {
+    std::filesystem::create_directories(_directory);
+
+    for (const auto& name : _fieldNames) {
+        size_t valueIndex = RegisterMap::getNumericFieldIndex(name);
+        if (valueIndex == RegisterMap::NUMERIC_FIELD_COUNT) {
+            throw std::invalid_argument("Unknown rollup field: " + name);
+        }
+        _fields.push_back({valueIndex, RegisterMap::getNumericFieldGroup(valueIndex), {}});
+        for (size_t resolution = 0; resolution < ROLLUP_RESOLUTION_COUNT; resolution++) {
+            _openSeries(_fields.back().series[resolution], name, static_cast<rollup_resolution>(resolution));
+        }
+    }
+}
+
+RollupEngine::~RollupEngine() {
+    for (auto& field : _fields) {
+        for (auto& series : field.series) {
+            if (series.isOpen) {
+                _persist(series);
+            }
+            if (series.fd >= 0) {
+                ::close(series.fd);
+            }
+        }
+    }
+}
+
+const std::string& RollupEngine::getDirectory() const {
+    return _directory;
+}
+
+const std::vector<std::string>& RollupEngine::getFieldNames() const {
+    return _fieldNames;
+}
+
+void RollupEngine::addSample(const InverterData& data, RegisterGroupMask groups, std::chrono::system_clock::time_point time) {
+    double now = std::chrono::duration<double>(time.time_since_epoch()).count();
+    std::time_t nowSeconds = static_cast<std::time_t>(std::floor(now));
+    std::tm local{};
+    localtime_r(&nowSeconds, &local);
+
+    // Buckets follow the local clock. Days run from local midnight to local
+    // midnight, which is 23 or 25 hours apart on DST changes.
+    std::array<int64_t, ROLLUP_RESOLUTION_COUNT> starts;
+    std::array<int64_t, ROLLUP_RESOLUTION_COUNT> ends;
+    starts[0] = nowSeconds - local.tm_sec;
+    ends[0] = starts[0] + SECONDS_PER_MINUTE;
+    starts[1] = starts[0] - local.tm_min * SECONDS_PER_MINUTE;
+    ends[1] = starts[1] + SECONDS_PER_HOUR;
+    starts[2] = getLocalMidnight(local, 0);
+    ends[2] = getLocalMidnight(local, 1);
+
+    auto values = RegisterMap::getNumericValues(data);
+
+    for (auto& field : _fields) {
+        if (!groups.test(static_cast<size_t>(field.group))) {
+            continue;
+        }
+        double value = values[field.valueIndex];
+        double previousValue = field.previousValue;
+        double previousTime = field.previousTime;
+        bool canIntegrate = field.hasPrevious && now > previousTime &&
+                            now - previousTime <= std::chrono::duration<double>(MAX_INTEGRATION_GAP).count();
+
+        for (size_t resolution = 0; resolution < ROLLUP_RESOLUTION_COUNT; resolution++) {
+            Series& series = field.series[resolution];
+            double carriedIntegral = 0.0;
+
+            if (series.isOpen && series.bucket.start != starts[resolution]) {
+                // The segment since the previous sample is split at the bucket boundary
+                if (canIntegrate && now >= series.end && series.end > previousTime) {
+                    double boundary = static_cast<double>(series.end);
+                    double boundaryValue = previousValue + (value - previousValue) * (boundary - previousTime) / (now - previousTime);
+                    series.bucket.integral += getTrapezoid(previousTime, previousValue, boundary, boundaryValue);
+                    carriedIntegral = getTrapezoid(boundary, boundaryValue, now, value);
+                }
+                _persist(series);
+                series.isOpen = false;
+            } else if (series.isOpen && canIntegrate) {
+                series.bucket.integral += getTrapezoid(previousTime, previousValue, now, value);
+            }
+
+            if (!series.isOpen) {
+                series.bucket = RollupBucket{};
+                series.bucket.start = starts[resolution];
+                series.bucket.integral = carriedIntegral;
+                series.end = ends[resolution];
+                series.isOpen = true;
+            }
+            _accumulate(series, value);
+        }
+        field.previousValue = value;
+        field.previousTime = now;
+        field.hasPrevious = true;
+    }
+}
+
+std::vector<RollupBucket> RollupEngine::query(const std::string& fieldName, rollup_resolution resolution,
+                                              std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to) const {
+    int64_t fromSeconds = std::chrono::floor<std::chrono::seconds>(from.time_since_epoch()).count();
+    int64_t toSeconds = std::chrono::floor<std::chrono::seconds>(to.time_since_epoch()).count();
+    std::vector<RollupBucket> buckets;
+
+    int fd = ::open(getSeriesPath(_directory, fieldName, resolution).c_str(), O_RDONLY);
+    if (fd >= 0) {
+        // Records are in start order; find the first one in range
+        int64_t low = 0;
+        int64_t high = getRecordCount(fd);
+        RollupBucket record;
+        while (low < high) {
+            int64_t middle = low + (high - low) / 2;
+            if (readRecord(fd, middle, record) && record.start < fromSeconds) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        for (int64_t index = low; readRecord(fd, index, record) && record.start < toSeconds; index++) {
+            buckets.push_back(record);
+        }
+        ::close(fd);
+    }
+
+    auto field = std::find(_fieldNames.begin(), _fieldNames.end(), fieldName);
+    if (field != _fieldNames.end()) {
+        const Series& series = _fields[field - _fieldNames.begin()].series[static_cast<size_t>(resolution)];
+        if (series.isOpen && series.bucket.start >= fromSeconds && series.bucket.start < toSeconds) {
+            if (!buckets.empty() && buckets.back().start == series.bucket.start) {
+                mergeBucket(buckets.back(), series.bucket);
+            } else {
+                buckets.push_back(series.bucket);
+            }
+        }
+    }
+    return buckets;
+}
+
+void RollupEngine::_openSeries(Series& series, const std::string& fieldName, rollup_resolution resolution) {
+    std::string path = getSeriesPath(_directory, fieldName, resolution);
+    series.fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (series.fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+
+    int64_t recordCount = getRecordCount(series.fd);
+    RollupBucket last;
+    if (recordCount > 0 && readRecord(series.fd, recordCount - 1, last)) {
+        series.lastPersistedStart = last.start;
+    }
+}
+
+void RollupEngine::_persist(Series& series) {
+    int64_t recordCount = getRecordCount(series.fd);
+    int64_t index = recordCount;
+    RollupBucket record = series.bucket;
+
+    // A bucket interrupted by a restart continues its persisted record
+    RollupBucket previous;
+    if (recordCount > 0 && series.bucket.start == series.lastPersistedStart && readRecord(series.fd, recordCount - 1, previous)) {
+        mergeBucket(previous, record);
+        record = previous;
+        index = recordCount - 1;
+    }
+
+    if (::pwrite(series.fd, &record, RECORD_SIZE, static_cast<off_t>(index * RECORD_SIZE)) == static_cast<ssize_t>(RECORD_SIZE)) {
+        series.lastPersistedStart = record.start;
+    }
+}
+
+void RollupEngine::_accumulate(Series& series, double value) {
+    RollupBucket& bucket = series.bucket;
+    if (bucket.sampleCount == 0) {
+        bucket.min = value;
+        bucket.max = value;
+    } else {
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+    }
+    bucket.sum += value;
+    ++bucket.sampleCount;
+}
@@ -0,0 +1,387 @@
+#include "sample_store.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char COLUMN_MAGIC[8] = {'S', 'G', 'C', 'O', 'L', 0, 0, 1};
+    constexpr size_t INITIAL_CAPACITY = 64 * 1024;
+    constexpr size_t MAX_TOKEN_BYTES = 10;  // One uint64 LEB128 varint
+    constexpr const char* TIME_COLUMN = "time";
+    constexpr const char* COLUMN_EXTENSION = ".col";
+
+    enum class column_encoding : uint32_t {
+        DELTA = 0,
+        DELTA_OF_DELTA
+    };
+
+    // Everything the encoder needs to resume a column after a restart
+    struct ColumnHeader {
+        char magic[8];
+        column_encoding encoding;
+        uint32_t reserved;
+        uint64_t sampleCount;
+        uint64_t usedBytes;  // Token bytes after the header
+        int64_t lastValue;
+        int64_t lastDelta;
+        uint64_t pendingZeroRun;  // Zero differences not yet written as a run token
+        double scale;
+    };
+
+    uint64_t encodeZigzag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t decodeZigzag(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    std::string formatDay(int32_t dayNumber) {
+        std::chrono::year_month_day date{std::chrono::sys_days{std::chrono::days{dayNumber}}};
+        char text[16];
+        std::snprintf(text, sizeof(text), "%04d-%02u-%02u", static_cast<int>(date.year()),
+                      static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()));
+        return text;
+    }
+
+    // Local calendar day of a sample, counted from 1970-01-01
+    int32_t getLocalDayNumber(int64_t ticks) {
+        auto time = std::chrono::duration_cast<std::chrono::seconds>(ticks * SampleStore::TIME_RESOLUTION);
+        std::time_t seconds = static_cast<std::time_t>(time.count());
+        std::tm local{};
+        localtime_r(&seconds, &local);
+        std::chrono::year_month_day date{std::chrono::year{local.tm_year + 1900}, std::chrono::month{static_cast<unsigned>(local.tm_mon + 1)},
+                                         std::chrono::day{static_cast<unsigned>(local.tm_mday)}};
+        return static_cast<int32_t>(std::chrono::sys_days{date}.time_since_epoch().count());
+    }
+
+    // Expands the token stream of one column file back into values
+    bool readColumn(const std::filesystem::path& path, std::vector<int64_t>& values, double& scale) {
+        std::ifstream input(path, std::ios::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        ColumnHeader header;
+        if (bytes.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) != 0 || sizeof(header) + header.usedBytes > bytes.size()) {
+            return false;
+        }
+
+        scale = header.scale;
+        values.clear();
+        values.reserve(header.sampleCount);
+        int64_t value = 0;
+        int64_t delta = 0;
+        auto applyDifference = [&](int64_t difference) {
+            if (header.encoding == column_encoding::DELTA_OF_DELTA) {
+                delta += difference;
+                value += delta;
+            } else {
+                value += difference;
+            }
+            values.push_back(value);
+        };
+
+        size_t pos = sizeof(header);
+        size_t end = sizeof(header) + header.usedBytes;
+        while (pos < end) {
+            uint64_t token = 0;
+            for (int shift = 0; pos < end; shift += 7) {
+                uint8_t byte = bytes[pos++];
+                token |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    break;
+                }
+            }
+            if (token & 1) {
+                for (uint64_t run = token >> 1; run > 0; --run) {
+                    applyDifference(0);
+                }
+            } else {
+                applyDifference(decodeZigzag(token >> 1));
+            }
+        }
+        for (uint64_t run = header.pendingZeroRun; run > 0; --run) {
+            applyDifference(0);
+        }
+        return true;
+    }
+}
+
+// One memory-mapped column. Tokens are (zigzag(difference) << 1) for a
+// nonzero difference and (runLength << 1 | 1) for a run of zeros.
+class ColumnFile {
+public:
+    ColumnFile(const std::filesystem::path& path, column_encoding encoding, double scale) {
+        _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (_fd < 0) {
+            throw std::runtime_error("Cannot open " + path.string() + ": " + std::strerror(errno));
+        }
+
+        struct stat status{};
+        ::fstat(_fd, &status);
+        bool isNew = static_cast<size_t>(status.st_size) < sizeof(ColumnHeader);
+        _map(std::max(static_cast<size_t>(status.st_size), INITIAL_CAPACITY));
+
+        if (isNew || std::memcmp(_getHeader().magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) != 0) {
+            ColumnHeader header{};
+            std::memcpy(header.magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+            header.encoding = encoding;
+            header.scale = scale;
+            std::memcpy(_mapping, &header, sizeof(header));
+        }
+    }
+
+    ~ColumnFile() {
+        // Trim the unused tail; the pending run stays in the header
+        size_t usedSize = sizeof(ColumnHeader) + _getHeader().usedBytes;
+        ::munmap(_mapping, _capacity);
+        if (::ftruncate(_fd, static_cast<off_t>(usedSize)) != 0) {
+            std::cerr << "Sample store: cannot trim column file: " << std::strerror(errno) << std::endl;
+        }
+        ::close(_fd);
+    }
+
+    ColumnFile(const ColumnFile&) = delete;
+    ColumnFile& operator=(const ColumnFile&) = delete;
+
+    void append(int64_t value) {
+        ColumnHeader& header = _getHeader();
+        int64_t difference = value - header.lastValue;
+        if (header.encoding == column_encoding::DELTA_OF_DELTA) {
+            int64_t delta = difference;
+            difference = delta - header.lastDelta;
+            header.lastDelta = delta;
+        }
+        header.lastValue = value;
+        ++header.sampleCount;
+
+        if (difference == 0) {
+            ++header.pendingZeroRun;
+            return;
+        }
+        if (header.pendingZeroRun > 0) {
+            _writeToken((header.pendingZeroRun << 1) | 1);
+            _getHeader().pendingZeroRun = 0;
+        }
+        _writeToken(encodeZigzag(difference) << 1);
+    }
+
+    uint64_t getSampleCount() {
+        return _getHeader().sampleCount;
+    }
+
+    // Repeats the last value until the column holds sampleCount samples
+    void padTo(uint64_t sampleCount) {
+        ColumnHeader& header = _getHeader();
+        if (header.sampleCount < sampleCount) {
+            uint64_t missing = sampleCount - header.sampleCount;
+            header.pendingZeroRun += missing;
+            header.sampleCount = sampleCount;
+        }
+    }
+
+private:
+    ColumnHeader& _getHeader() {
+        return *reinterpret_cast<ColumnHeader*>(_mapping);
+    }
+
+    void _map(size_t capacity) {
+        if (::ftruncate(_fd, static_cast<off_t>(capacity)) != 0) {
+            throw std::runtime_error(std::string("Cannot grow column file: ") + std::strerror(errno));
+        }
+        void* mapping = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error(std::string("Cannot map column file: ") + std::strerror(errno));
+        }
+        _mapping = static_cast<uint8_t*>(mapping);
+        _capacity = capacity;
+    }
+
+    void _writeToken(uint64_t token) {
+        size_t pos = sizeof(ColumnHeader) + _getHeader().usedBytes;
+        if (pos + MAX_TOKEN_BYTES > _capacity) {
+            ::munmap(_mapping, _capacity);
+            _map(_capacity * 2);
+        }
+
+        // Token bytes land before usedBytes covers them
+        uint8_t* out = _mapping + pos;
+        size_t length = 0;
+        while (token >= 0x80) {
+            out[length++] = static_cast<uint8_t>(token | 0x80);
+            token >>= 7;
+        }
+        out[length++] = static_cast<uint8_t>(token);
+        _getHeader().usedBytes += length;
+    }
+
+    int _fd = -1;
+    uint8_t* _mapping = nullptr;
+    size_t _capacity = 0;
+};
+
+SampleStore::SampleStore(std::string directory)
+    : _directory(std::move(directory)), _queue(QUEUE_CAPACITY) {
+    std::filesystem::create_directories(_directory);
+    _writer = std::thread([this] { _writerLoop(); });
+}
+
+SampleStore::~SampleStore() {
+    _isStopping.store(true, std::memory_order_release);
+    _wakeups.fetch_add(1, std::memory_order_release);
+    _wakeups.notify_one();
+    _writer.join();
+}
+
+const std::string& SampleStore::getDirectory() const {
+    return _directory;
+}
+
+uint64_t SampleStore::getWrittenCount() const {
+    return _consumed.load(std::memory_order_acquire);
+}
+
+uint64_t SampleStore::getDroppedCount() const {
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+bool SampleStore::append(const InverterData& data, std::chrono::system_clock::time_point time) {
+    uint64_t published = _published.load(std::memory_order_relaxed);
+    if (published - _consumed.load(std::memory_order_acquire) >= QUEUE_CAPACITY) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    QueuedSample& sample = _queue[published % QUEUE_CAPACITY];
+    sample.time = std::chrono::floor<std::chrono::milliseconds>(time.time_since_epoch()).count() / TIME_RESOLUTION.count();
+    size_t column = 0;
+    RegisterMap::forEachNumericField([&](const auto& field) {
+        sample.values[column++] = std::llround(static_cast<double>(data.*field.target) / field.scale);
+    });
+
+    _published.store(published + 1, std::memory_order_release);
+    _wakeups.fetch_add(1, std::memory_order_release);
+    _wakeups.notify_one();
+    return true;
+}
+
+const std::vector<std::string>& SampleStore::getColumnNames() {
+    static const std::vector<std::string> NAMES = [] {
+        std::vector<std::string> names = {TIME_COLUMN};
+        RegisterMap::forEachNumericField([&names](const auto& field) {
+            names.emplace_back(field.name);
+        });
+        return names;
+    }();
+    return NAMES;
+}
+
+std::vector<StoredSample> SampleStore::readDay(const std::string& directory, const std::string& day) {
+    const auto& names = getColumnNames();
+    std::filesystem::path dayDirectory = std::filesystem::path(directory) / day;
+
+    std::vector<int64_t> times;
+    double timeScale = 0.0;
+    if (!readColumn(dayDirectory / (names[0] + COLUMN_EXTENSION), times, timeScale)) {
+        return {};
+    }
+
+    std::vector<StoredSample> samples(times.size());
+    for (size_t i = 0; i < times.size(); i++) {
+        samples[i].time = std::chrono::system_clock::time_point(times[i] * TIME_RESOLUTION);
+        samples[i].values.resize(names.size() - 1, 0.0);
+    }
+
+    // Columns are aligned from the start of the day; a missing column reads as zero
+    for (size_t column = 1; column < names.size(); column++) {
+        std::vector<int64_t> values;
+        double scale = 1.0;
+        if (!readColumn(dayDirectory / (names[column] + COLUMN_EXTENSION), values, scale)) {
+            continue;
+        }
+        for (size_t i = 0; i < samples.size() && i < values.size(); i++) {
+            samples[i].values[column - 1] = values[i] * scale;
+        }
+    }
+    return samples;
+}
+
+void SampleStore::_writerLoop() {
+    uint64_t consumed = _consumed.load(std::memory_order_relaxed);
+    while (true) {
+        uint64_t wakeups = _wakeups.load(std::memory_order_acquire);
+        uint64_t published = _published.load(std::memory_order_acquire);
+
+        while (consumed < published) {
+            _write(_queue[consumed % QUEUE_CAPACITY]);
+            _consumed.store(++consumed, std::memory_order_release);
+        }
+
+        if (_isStopping.load(std::memory_order_acquire)) {
+            break;
+        }
+        _wakeups.wait(wakeups, std::memory_order_acquire);
+    }
+    _closeDay();
+}
+
+void SampleStore::_write(const QueuedSample& sample) {
+    int32_t dayNumber = getLocalDayNumber(sample.time);
+    if (dayNumber != _openDayNumber) {
+        _closeDay();
+        try {
+            _openDay(dayNumber);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Sample store: " << e.what() << std::endl;
+            _columns.clear();
+        }
+    }
+    if (_columns.empty()) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    _columns[0]->append(sample.time);
+    for (size_t i = 0; i < sample.values.size(); i++) {
+        _columns[i + 1]->append(sample.values[i]);
+    }
+}
+
+void SampleStore::_openDay(int32_t dayNumber) {
+    _openDayNumber = dayNumber;
+    std::filesystem::path dayDirectory = std::filesystem::path(_directory) / formatDay(dayNumber);
+    std::filesystem::create_directories(dayDirectory);
+
+    const auto& names = getColumnNames();
+    _columns.push_back(std::make_unique<ColumnFile>(dayDirectory / (names[0] + COLUMN_EXTENSION), column_encoding::DELTA_OF_DELTA, 1.0));
+
+    size_t column = 1;
+    RegisterMap::forEachNumericField([&](const auto& field) {
+        _columns.push_back(std::make_unique<ColumnFile>(dayDirectory / (names[column++] + COLUMN_EXTENSION), column_encoding::DELTA, field.scale));
+    });
+
+    // A column new to the register map, or one cut short by a crash
+    // mid-sample, catches up with the time column before appends resume
+    uint64_t sampleCount = _columns[0]->getSampleCount();
+    for (size_t i = 1; i < _columns.size(); i++) {
+        _columns[i]->padTo(sampleCount);
+    }
+}
+
+void SampleStore::_closeDay() {
+    _columns.clear();
+    _openDayNumber = -1;
+}
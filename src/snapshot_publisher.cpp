@@ -0,0 +1,92 @@
+#include "snapshot_publisher.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    void copyText(std::array<char, InverterSnapshot::TEXT_CAPACITY>& target, const std::string& text) {
+        size_t length = std::min(text.size(), target.size() - 1);
+        std::memcpy(target.data(), text.data(), length);
+        target[length] = '\0';
+    }
+
+    std::string_view getText(const std::array<char, InverterSnapshot::TEXT_CAPACITY>& text) {
+        return std::string_view(text.data(), std::find(text.begin(), text.end(), '\0') - text.begin());
+    }
+}
+
+std::string_view InverterSnapshot::getDeviceType() const {
+    return getText(deviceType);
+}
+
+std::string_view InverterSnapshot::getSerialNumber() const {
+    return getText(serialNumber);
+}
+
+std::string_view InverterSnapshot::getWorkState() const {
+    return getText(workState);
+}
+
+InverterData InverterSnapshot::toInverterData() const {
+    InverterData data;
+    data.deviceType = getDeviceType();
+    data.serialNumber = getSerialNumber();
+    data.workState1 = getWorkState();
+
+    size_t index = 0;
+    RegisterMap::forEachNumericField([&](const auto& field) {
+        using Value = std::remove_reference_t<decltype(data.*field.target)>;
+        data.*field.target = static_cast<Value>(values[index++]);
+    });
+    return data;
+}
+
+void SnapshotPublisher::publish(const InverterData& data, std::chrono::system_clock::time_point time) {
+    uint64_t generation = _generation.load(std::memory_order_relaxed) + 1;
+    Slot& slot = _slots[generation & 1];
+
+    // Readers still copying this slot see the odd sequence, or its change, and retry
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    InverterSnapshot& snapshot = slot.snapshot;
+    snapshot.generation = generation;
+    snapshot.time = time;
+    copyText(snapshot.deviceType, data.deviceType);
+    copyText(snapshot.serialNumber, data.serialNumber);
+    copyText(snapshot.workState, data.workState1);
+    snapshot.values = RegisterMap::getNumericValues(data);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    _generation.store(generation, std::memory_order_release);
+}
+
+uint64_t SnapshotPublisher::getGeneration() const {
+    return _generation.load(std::memory_order_acquire);
+}
+
+InverterSnapshot SnapshotPublisher::read() const {
+    InverterSnapshot snapshot;
+    readIfNewer(0, snapshot);
+    return snapshot;
+}
+
+bool SnapshotPublisher::readIfNewer(uint64_t knownGeneration, InverterSnapshot& snapshot) const {
+    while (true) {
+        uint64_t generation = _generation.load(std::memory_order_acquire);
+        if (generation == 0 || generation <= knownGeneration) {
+            return false;
+        }
+
+        const Slot& slot = _slots[generation & 1];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        std::memcpy(static_cast<void*>(&snapshot), &slot.snapshot, sizeof(snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+}
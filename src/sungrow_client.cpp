@@ -1,13 +1,29 @@
 #include "sungrow_client.hpp"
+#include "trace.hpp"
+#include "data_converter.hpp"
 #include <iostream>
-#include <thread>
 #include <stdexcept>
+#include <algorithm>
+#include <optional>
 
 using boost::asio::ip::tcp;
 
 SungrowTcpClient::SungrowTcpClient(const std::string& host, uint16_t port, uint8_t slaveId)
-    : _host(host), _port(port), _slaveId(slaveId), _connected(false), _transactionId(0) {
+    : SungrowTcpClient(boost::asio::any_io_executor(), host, port, slaveId) {}
+
+SungrowTcpClient::SungrowTcpClient(boost::asio::any_io_executor executor, const std::string& host, uint16_t port, uint8_t slaveId)
+    : _host(host), _port(port), _slaveId(slaveId),
+      _ownedContext(executor ? nullptr : std::make_unique<boost::asio::io_context>()),
+      _executor(executor ? executor : _ownedContext->get_executor()),
+      _resolver(_executor), _receiveTimer(_executor), _connectTimer(_executor), _retryTimer(_executor),
+      _connected(false), _transactionId(0), _pipelineWindow(1) {
     _crypto = std::make_unique<SungrowCrypto>();
+    _rxFrame.reserve(MAX_FRAME_SIZE);
+    _rxBatch.reserve(FrameBuffer::CAPACITY);
+    _txActive.reserve(REQUEST_FRAME_CAPACITY * UINT8_MAX);
+    _txPending.reserve(REQUEST_FRAME_CAPACITY * UINT8_MAX);
+    _txActiveIds.reserve(UINT8_MAX);
+    _txPendingIds.reserve(UINT8_MAX);
 }
 
 SungrowTcpClient::~SungrowTcpClient() {
@@ -15,38 +31,24 @@ SungrowTcpClient::~SungrowTcpClient() {
 }
 
 bool SungrowTcpClient::connect() {
-    try {
-        _socket = std::make_unique<tcp::socket>(_ioContext);
-        
-        tcp::resolver resolver(_ioContext);
-        auto endpoints = resolver.resolve(_host, std::to_string(_port));
-        
-        boost::asio::connect(*_socket, endpoints);
-        
-        std::this_thread::sleep_for(std::chrono::seconds(3));
-        
-        _connected = true;
-        std::cout << "Connected to Sungrow inverter at " << _host << ":" << _port << std::endl;
-        
-        if (performKeyExchange()) {
-            std::cout << "Sungrow encryption protocol initialized" << std::endl;
-        } else {
-            std::cout << "Key exchange failed - falling back to standard Modbus" << std::endl;
-        }
-        
-        return true;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Connection failed: " << e.what() << std::endl;
-        _connected = false;
-        return false;
-    }
+    _requireOwnContext();
+    
+    std::optional<bool> isConnectedNow;
+    asyncConnect([&](bool success) { isConnectedNow = success; });
+    _runUntil([&] { return isConnectedNow.has_value(); });
+    
+    return *isConnectedNow;
 }
 
 void SungrowTcpClient::disconnect() {
     if (_socket && _socket->is_open()) {
-        _socket->close();
+        boost::system::error_code ignored;
+        _socket->close(ignored);
     }
+    _rxBuffer.clear();
+    _clearPlainFrames();
+    _txPending.clear();
+    _txPendingIds.clear();
     _connected = false;
 }
 
@@ -54,121 +56,713 @@ bool SungrowTcpClient::isConnected() const {
     return _connected && _socket && _socket->is_open();
 }
 
+bool SungrowTcpClient::performKeyExchange() {
+    _requireOwnContext();
+    
+    std::optional<bool> isExchanged;
+    _asyncKeyExchange([&](bool success) { isExchanged = success; });
+    _runUntil([&] { return isExchanged.has_value(); });
+    
+    return *isExchanged;
+}
+
 std::vector<uint16_t> SungrowTcpClient::readInputRegisters(uint16_t address, uint16_t count) {
-    if (!isConnected()) {
-        throw std::runtime_error("Not connected to inverter");
-    }
+    return _readSingle(0x04, address, count);
+}
+
+std::vector<uint16_t> SungrowTcpClient::readHoldingRegisters(uint16_t address, uint16_t count) {
+    return _readSingle(0x03, address, count);
+}
+
+std::vector<ModbusReadResult> SungrowTcpClient::readPipelined(const std::vector<ModbusReadRequest>& requests) {
+    _requireOwnContext();
     
-    auto frame = _buildModbusFrame(0x04, address, count);
+    std::optional<std::vector<ModbusReadResult>> results;
+    asyncReadPipelined(requests, [&](std::vector<ModbusReadResult> completed) { results = std::move(completed); });
+    _runUntil([&] { return results.has_value(); });
     
-    if (!_sendFrame(frame)) {
-        throw std::runtime_error("Failed to send Modbus frame");
+    return std::move(*results);
+}
+
+void SungrowTcpClient::asyncConnect(ConnectHandler handler) {
+    boost::asio::dispatch(_executor, [this, handler = std::move(handler)]() mutable {
+        _asyncOpen(std::move(handler));
+    });
+}
+
+void SungrowTcpClient::asyncReadPipelined(std::vector<ModbusReadRequest> requests, ReadHandler handler) {
+    boost::asio::dispatch(_executor, [this, requests = std::move(requests), handler = std::move(handler)]() mutable {
+        _pipeline = std::make_unique<PipelineOperation>();
+        _pipeline->requests = std::move(requests);
+        _pipeline->results.resize(_pipeline->requests.size());
+        _pipeline->timings.resize(_pipeline->requests.size());
+        _pipeline->handler = std::move(handler);
+        for (size_t i = 0; i < _pipeline->requests.size(); i++) {
+            _pipeline->pending.push_back(i);
+        }
+        
+        if (_pipeline->requests.empty()) {
+            _completePipeline("");
+            return;
+        }
+        if (!isConnected()) {
+            _retryPipeline("Not connected to inverter");
+            return;
+        }
+        
+        _fillPipeline();
+        _receiveNextResponse();
+    });
+}
+
+const std::string& SungrowTcpClient::getHost() const {
+    return _host;
+}
+
+boost::asio::any_io_executor SungrowTcpClient::getExecutor() const {
+    return _executor;
+}
+
+uint8_t SungrowTcpClient::getPipelineWindow() const {
+    return _pipelineWindow;
+}
+
+void SungrowTcpClient::setPipelineWindow(uint8_t pipelineWindow) {
+    _pipelineWindow = std::max<uint8_t>(pipelineWindow, 1);
+}
+
+std::chrono::milliseconds SungrowTcpClient::getProbeTimeout() const {
+    return _probeTimeout;
+}
+
+void SungrowTcpClient::setProbeTimeout(std::chrono::milliseconds probeTimeout) {
+    _probeTimeout = probeTimeout;
+}
+
+std::chrono::milliseconds SungrowTcpClient::getConnectTimeout() const {
+    return _connectTimeout;
+}
+
+void SungrowTcpClient::setConnectTimeout(std::chrono::milliseconds connectTimeout) {
+    _connectTimeout = connectTimeout;
+}
+
+std::chrono::milliseconds SungrowTcpClient::getResponseTimeout() const {
+    return _responseTimeout;
+}
+
+void SungrowTcpClient::setResponseTimeout(std::chrono::milliseconds responseTimeout) {
+    _responseTimeout = responseTimeout;
+}
+
+uint8_t SungrowTcpClient::getMaxRetries() const {
+    return _maxRetries;
+}
+
+void SungrowTcpClient::setMaxRetries(uint8_t maxRetries) {
+    _maxRetries = maxRetries;
+}
+
+const ClientStatistics& SungrowTcpClient::getStatistics() const {
+    return _statistics;
+}
+
+const LatencyStatistics& SungrowTcpClient::getLatencyStatistics() const {
+    return _latency;
+}
+
+void SungrowTcpClient::setCapture(std::unique_ptr<FrameCaptureWriter> capture) {
+    _capture = std::move(capture);
+}
+
+void SungrowTcpClient::_requireOwnContext() const {
+    if (!_ownedContext) {
+        throw std::logic_error("Blocking calls are not available on a shared executor");
     }
+}
+
+void SungrowTcpClient::_runUntil(const std::function<bool()>& isDone) {
+    _ownedContext->restart();
+    while (!isDone()) {
+        if (_ownedContext->run_one() == 0) {
+            throw std::logic_error("Client operation stalled with no pending work");
+        }
+    }
+}
+
+void SungrowTcpClient::_resetConnection() {
+    disconnect();
+    _socket = std::make_unique<tcp::socket>(_executor);
+    _crypto = std::make_unique<SungrowCrypto>();
+    _isWriting = false;
+    ++_connectionGeneration;
+}
+
+void SungrowTcpClient::_asyncOpen(ConnectHandler handler) {
+    _resetConnection();
+    auto connectStart = std::chrono::steady_clock::now();
+    uint64_t generation = _connectionGeneration;
+    
+    // Resolution and the TCP handshake share the connect timeout; an
+    // unreachable host would otherwise wait out the kernel's SYN retries
+    _connectTimer.expires_after(_connectTimeout);
+    _connectTimer.async_wait([this, generation](const boost::system::error_code& error) {
+        if (!error && generation == _connectionGeneration && !_connected) {
+            _resolver.cancel();
+            boost::system::error_code ignored;
+            _socket->close(ignored);
+        }
+    });
     
-    auto response = _receiveResponse();
-    return _parseModbusResponse(response);
+    _resolver.async_resolve(_host, std::to_string(_port),
+        [this, handler = std::move(handler), connectStart](const boost::system::error_code& error, tcp::resolver::results_type endpoints) mutable {
+            if (error) {
+                std::cerr << "Connection failed: " << error.message() << std::endl;
+                _connectTimer.cancel();
+                handler(false);
+                return;
+            }
+            
+            boost::asio::async_connect(*_socket, endpoints,
+                [this, handler = std::move(handler), connectStart](const boost::system::error_code& error, const tcp::endpoint&) mutable {
+                    _connectTimer.cancel();
+                    if (error) {
+                        std::cerr << "Connection failed: " << error.message() << std::endl;
+                        _connected = false;
+                        handler(false);
+                        return;
+                    }
+                    
+                    _connected = true;
+                    SUNGROW_TRACE(trace_level::INFO, "Connected to Sungrow inverter at " << _host << ":" << _port);
+                    if (_capture) {
+                        _capture->recordConnected();
+                    }
+                    
+                    _asyncKeyExchange([this, handler = std::move(handler), connectStart](bool isEncrypted) {
+                        if (isEncrypted) {
+                            auto handshake = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - connectStart);
+                            SUNGROW_TRACE(trace_level::INFO, "Sungrow encryption protocol initialized in " << handshake.count() << " ms");
+                        } else {
+                            std::cout << "Key exchange failed - falling back to standard Modbus" << std::endl;
+                        }
+                        handler(isConnected());
+                    });
+                });
+        });
 }
 
-std::vector<uint16_t> SungrowTcpClient::readHoldingRegisters(uint16_t address, uint16_t count) {
-    if (!isConnected()) {
-        throw std::runtime_error("Not connected to inverter");
+void SungrowTcpClient::_asyncKeyExchange(ConnectHandler handler) {
+    SUNGROW_TRACE(trace_level::DEBUG, "Performing Sungrow key exchange with " << _host);
+    
+    auto state = std::make_shared<KeyExchangeState>();
+    state->startTime = std::chrono::steady_clock::now();
+    state->probeTimeout = _probeTimeout;
+    state->handler = std::move(handler);
+    
+    _sendKeyProbe(state);
+}
+
+void SungrowTcpClient::_sendKeyProbe(std::shared_ptr<KeyExchangeState> state) {
+    auto keyCmd = SungrowCrypto::getKeyExchangeCommand();
+    
+    SUNGROW_TRACE(trace_level::DEBUG, "Sending key exchange command (probe timeout " << state->probeTimeout.count() << " ms)");
+    
+    _queueWrite(keyCmd);
+    ++state->unansweredProbes;
+    
+    // Encryption is not enabled yet, so the reply is framed by its MBAP header
+    _asyncReceiveFrame(state->probeTimeout, [this, state](const boost::system::error_code& error) {
+        if (error == boost::asio::error::timed_out) {
+            auto elapsed = std::chrono::steady_clock::now() - state->startTime;
+            if (elapsed + state->probeTimeout > _connectTimeout) {
+                std::cerr << "Key exchange timed out after " << state->unansweredProbes << " probes" << std::endl;
+                state->handler(false);
+                return;
+            }
+            state->probeTimeout = std::min(state->probeTimeout * 2, MAX_PROBE_TIMEOUT);
+            _sendKeyProbe(state);
+            return;
+        }
+        
+        if (error) {
+            std::cerr << "Key exchange failed: " << error.message() << std::endl;
+            state->handler(false);
+            return;
+        }
+        
+        --state->unansweredProbes;
+        if (!_extractPublicKey(_rxFrame, state->publicKey)) {
+            state->handler(false);
+            return;
+        }
+        _drainKeyReplies(state);
+    });
+}
+
+void SungrowTcpClient::_drainKeyReplies(std::shared_ptr<KeyExchangeState> state) {
+    // Earlier probes may still be answered late; the newest reply carries the live key
+    if (state->unansweredProbes == 0) {
+        _finishKeyExchange(state);
+        return;
     }
     
-    auto frame = _buildModbusFrame(0x03, address, count);
+    _asyncReceiveFrame(state->probeTimeout, [this, state](const boost::system::error_code& error) {
+        if (error) {
+            _finishKeyExchange(state);
+            return;
+        }
+        
+        --state->unansweredProbes;
+        _extractPublicKey(_rxFrame, state->publicKey);
+        _drainKeyReplies(state);
+    });
+}
+
+void SungrowTcpClient::_finishKeyExchange(std::shared_ptr<KeyExchangeState> state) {
+    SUNGROW_TRACE(trace_level::DEBUG, "Key exchange answered, " << state->publicKey.size() << " byte public key");
+    state->handler(_crypto->initializeEncryption(state->publicKey));
+}
+
+void SungrowTcpClient::_fillPipeline() {
+    auto& pipeline = *_pipeline;
     
-    if (!_sendFrame(frame)) {
-        throw std::runtime_error("Failed to send Modbus frame");
+    while (!pipeline.pending.empty() && pipeline.inFlight.size() < _pipelineWindow) {
+        size_t index = pipeline.pending.front();
+        pipeline.pending.pop_front();
+        
+        const auto& request = pipeline.requests[index];
+        auto& timing = pipeline.timings[index];
+        timing.built = Clock::now();
+        auto frame = _buildModbusFrame(request);
+        timing.sent = Clock::now();
+        timing.written = {};
+        
+        pipeline.inFlight[_transactionId] = index;
+        ++_statistics.requests;
+        // Before queueing, which may start the write at once
+        _txPendingIds.push_back(_transactionId);
+        _queueWrite(frame);
     }
+}
+
+void SungrowTcpClient::_receiveNextResponse() {
+    _asyncReceiveFrame(_responseTimeout, [this](const boost::system::error_code& error) {
+        if (error) {
+            std::cerr << "Receive failed: " << error.message() << std::endl;
+            if (error == boost::asio::error::timed_out) {
+                ++_statistics.timeouts;
+            }
+            _retryPipeline("No response received: " + error.message());
+            return;
+        }
+        
+        auto& pipeline = *_pipeline;
+        const auto& response = _rxFrame;
+        if (response.size() < 2) {
+            _retryPipeline("No response received");
+            return;
+        }
+        
+        // With a single request outstanding any response belongs to it, which
+        // keeps window 1 working against firmware that does not echo the ID
+        auto match = pipeline.inFlight.size() == 1 ? pipeline.inFlight.begin()
+                                                   : pipeline.inFlight.find(_extractTransactionId(response));
+        if (match == pipeline.inFlight.end()) {
+            std::cerr << "Discarding response with unknown transaction ID " << _extractTransactionId(response) << std::endl;
+            _receiveNextResponse();
+            return;
+        }
+        
+        const auto& timing = pipeline.timings[match->second];
+        auto roundTrip = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - timing.sent);
+        ++_statistics.responses;
+        _statistics.totalRoundTrip += roundTrip;
+        _statistics.maxRoundTrip = std::max(_statistics.maxRoundTrip, roundTrip);
+        
+        auto& result = pipeline.results[match->second];
+        auto parseStart = Clock::now();
+        try {
+            parseReadResponse(response, result.registers);
+            result.success = true;
+        }
+        catch (const ModbusException& e) {
+            result.error = e.what();
+            result.exceptionCode = e.getExceptionCode();
+        }
+        catch (const std::exception& e) {
+            result.error = e.what();
+        }
+        _recordLatency(pipeline.requests[match->second], timing, Clock::now() - parseStart);
+        
+        pipeline.inFlight.erase(match);
+        pipeline.attempt = 0;
+        if (++pipeline.completed == pipeline.requests.size()) {
+            _completePipeline("");
+            return;
+        }
+        
+        _fillPipeline();
+        _receiveNextResponse();
+    });
+}
+
+void SungrowTcpClient::_recordLatency(const ModbusReadRequest& request, const RequestTiming& timing, std::chrono::nanoseconds parse) {
+    // The read handler can run before the write handler of the same request
+    auto written = timing.written == Clock::time_point{} ? _rxTiming.firstByte : std::min(timing.written, _rxTiming.firstByte);
     
-    auto response = _receiveResponse();
-    return _parseModbusResponse(response);
+    PhaseDurations durations;
+    durations[static_cast<size_t>(latency_phase::ENCRYPT)] = timing.sent - timing.built;
+    durations[static_cast<size_t>(latency_phase::WRITE)] = written - timing.sent;
+    durations[static_cast<size_t>(latency_phase::FIRST_BYTE)] = _rxTiming.firstByte - written;
+    durations[static_cast<size_t>(latency_phase::READ)] = _rxTiming.complete - _rxTiming.firstByte;
+    durations[static_cast<size_t>(latency_phase::DECRYPT)] = _rxTiming.decrypt;
+    durations[static_cast<size_t>(latency_phase::PARSE)] = parse;
+    durations[static_cast<size_t>(latency_phase::TOTAL)] = Clock::now() - timing.built;
+    _latency.record(request.functionCode, request.address, request.count, durations);
 }
 
-std::vector<uint8_t> SungrowTcpClient::_buildModbusFrame(uint8_t functionCode, uint16_t address, uint16_t count) {
-    std::vector<uint8_t> frame;
+void SungrowTcpClient::_retryPipeline(const std::string& failure) {
+    auto& pipeline = *_pipeline;
     
-    ++_transactionId;
-    frame.push_back((_transactionId >> 8) & 0xFF);
-    frame.push_back(_transactionId & 0xFF);
+    // Whatever was sent but not answered goes back to the front of the queue,
+    // in request order, to be replayed on the new connection
+    std::vector<size_t> unanswered;
+    for (const auto& [transactionId, index] : pipeline.inFlight) {
+        unanswered.push_back(index);
+    }
+    std::sort(unanswered.begin(), unanswered.end());
+    pipeline.pending.insert(pipeline.pending.begin(), unanswered.begin(), unanswered.end());
+    pipeline.inFlight.clear();
     
-    frame.push_back(0x00);
-    frame.push_back(0x00);
+    // Late replies on a connection that timed out cannot be told apart from
+    // fresh ones, so the connection is always replaced
+    disconnect();
+    if (Trace::isCompiledIn(trace_level::FRAME) && Trace::isEnabled(trace_level::FRAME)) {
+        Trace::dumpFrames(std::cerr);
+    }
     
-    frame.push_back(0x00);
-    frame.push_back(0x06);
+    if (pipeline.attempt >= _maxRetries) {
+        _completePipeline(failure);
+        return;
+    }
     
-    frame.push_back(_slaveId);
-    frame.push_back(functionCode);
+    ++pipeline.attempt;
+    ++_statistics.retries;
+    auto delay = _getBackoffDelay(pipeline.attempt);
+    std::cerr << failure << " - reconnecting to " << _host << " in " << delay.count() << " ms (attempt "
+              << static_cast<int>(pipeline.attempt) << "/" << static_cast<int>(_maxRetries) << ")" << std::endl;
     
-    frame.push_back((address >> 8) & 0xFF);
-    frame.push_back(address & 0xFF);
+    _retryTimer.expires_after(delay);
+    _retryTimer.async_wait([this](const boost::system::error_code& error) {
+        if (error || !_pipeline) {
+            return;
+        }
+        
+        ++_statistics.reconnects;
+        _asyncOpen([this](bool isConnectedNow) {
+            if (!isConnectedNow) {
+                _retryPipeline("Reconnect failed");
+                return;
+            }
+            _fillPipeline();
+            _receiveNextResponse();
+        });
+    });
+}
+
+std::chrono::milliseconds SungrowTcpClient::_getBackoffDelay(uint8_t attempt) {
+    auto ceiling = BASE_BACKOFF * (1 << std::min<uint8_t>(attempt - 1, 16));
+    ceiling = std::min<std::chrono::milliseconds>(ceiling, MAX_BACKOFF);
     
-    frame.push_back((count >> 8) & 0xFF);
-    frame.push_back(count & 0xFF);
+    // Equal jitter: half the ceiling is guaranteed, the rest is random, so
+    // inverters dropped by the same WiFi glitch do not reconnect in lockstep
+    std::uniform_int_distribution<int64_t> distribution(ceiling.count() / 2, ceiling.count());
+    return std::chrono::milliseconds(distribution(_jitter));
+}
+
+void SungrowTcpClient::_completePipeline(const std::string& failure) {
+    auto pipeline = std::move(_pipeline);
     
-    _applySungrowEncryption(frame);
+    if (!failure.empty()) {
+        for (auto& result : pipeline->results) {
+            if (!result.success && result.error.empty()) {
+                result.error = failure;
+            }
+        }
+    }
     
-    return frame;
+    pipeline->handler(std::move(pipeline->results));
 }
 
-bool SungrowTcpClient::_sendFrame(const std::vector<uint8_t>& frame) {
-    try {
-        boost::asio::write(*_socket, boost::asio::buffer(frame));
-        
-        std::cout << "SEND: ";
-        for (auto byte : frame) {
-            printf("0x%X ", byte);
+void SungrowTcpClient::_queueWrite(std::span<const uint8_t> frame) {
+    SUNGROW_TRACE_FRAME(frame_direction::TX, frame);
+    if (_capture) {
+        _capture->recordFrame(frame_direction::TX, frame);
+    }
+    
+    _txPending.insert(_txPending.end(), frame.begin(), frame.end());
+    if (!_isWriting) {
+        _writeNext();
+    }
+}
+
+void SungrowTcpClient::_writeNext() {
+    _isWriting = true;
+    std::swap(_txActive, _txPending);
+    _txPending.clear();
+    std::swap(_txActiveIds, _txPendingIds);
+    _txPendingIds.clear();
+    
+    boost::asio::async_write(*_socket, boost::asio::buffer(_txActive),
+        [this, generation = _connectionGeneration](const boost::system::error_code& error, size_t) {
+            // A write on a connection that has since been replaced reports nothing
+            if (generation != _connectionGeneration) {
+                return;
+            }
+            if (error) {
+                // The pending receive fails with the closed socket and reports it
+                std::cerr << "Send failed: " << error.message() << std::endl;
+                _isWriting = false;
+                disconnect();
+                return;
+            }
+            
+            _markWritten();
+            if (_txPending.empty()) {
+                _isWriting = false;
+            } else {
+                _writeNext();
+            }
+        });
+}
+
+void SungrowTcpClient::_markWritten() {
+    if (!_pipeline) {
+        return;
+    }
+    auto now = Clock::now();
+    for (uint16_t transactionId : _txActiveIds) {
+        // Requests answered or replayed since are no longer in flight under this ID
+        auto match = _pipeline->inFlight.find(transactionId);
+        if (match != _pipeline->inFlight.end() && _pipeline->timings[match->second].written == Clock::time_point{}) {
+            _pipeline->timings[match->second].written = now;
         }
-        std::cout << std::endl;
-        
-        return true;
     }
-    catch (const std::exception& e) {
-        std::cerr << "Send failed: " << e.what() << std::endl;
-        return false;
+}
+
+void SungrowTcpClient::_asyncReceiveFrame(std::chrono::milliseconds timeout, FrameHandler handler) {
+    _rxFrame.clear();
+    _isReceiving = true;
+    _hasReceiveTimedOut = false;
+    uint64_t generation = ++_receiveGeneration;
+    
+    if (timeout > std::chrono::milliseconds::zero()) {
+        _receiveTimer.expires_after(timeout);
+        _receiveTimer.async_wait([this, generation](const boost::system::error_code& error) {
+            // A stale expiry must not cancel a later receive
+            if (!error && _isReceiving && generation == _receiveGeneration && _socket) {
+                _hasReceiveTimedOut = true;
+                _socket->cancel();
+            }
+        });
     }
+    
+    _continueReceive(std::move(handler));
 }
 
-std::vector<uint8_t> SungrowTcpClient::_receiveResponse() {
-    std::vector<uint8_t> response(256);
+void SungrowTcpClient::_continueReceive(FrameHandler handler) {
+    // Frames decrypted along with an earlier one need no read
+    if (_rxPlainIndex < _rxPlainFrames.size() || _hasBatchDecryptFailed) {
+        _takePlainFrame(handler);
+        return;
+    }
     
+    // Keep reading until the ring buffer holds at least one complete frame;
+    // any bytes beyond it stay buffered for the next receive
+    size_t frameSize = 0;
     try {
-        size_t length = _socket->read_some(boost::asio::buffer(response));
-        response.resize(length);
-        
-        std::cout << "RECV: ";
-        for (auto byte : response) {
-            printf("0x%X ", byte);
+        frameSize = _nextFrameSize();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Receive failed: " << e.what() << std::endl;
+        _finishReceive(boost::asio::error::invalid_argument, handler);
+        return;
+    }
+    
+    if (frameSize != 0 && _rxBuffer.getSize() >= frameSize) {
+        if (_crypto->isEncryptionEnabled()) {
+            _decryptBufferedFrames();
+            _takePlainFrame(handler);
+            return;
         }
-        std::cout << std::endl;
         
-        _removeSungrowEncryption(response);
+        _rxFrame.resize(frameSize);
+        _rxBuffer.copyOut(_rxFrame.data(), frameSize);
+        _rxBuffer.consume(frameSize);
+        _rxTiming = {_rxFirstByteTime, _rxLastReadTime, std::chrono::nanoseconds(0)};
+        if (!_rxBuffer.isEmpty()) {
+            // The next frame began in the read that completed this one
+            _rxFirstByteTime = _rxLastReadTime;
+        }
         
-        return response;
+        SUNGROW_TRACE_FRAME(frame_direction::RX, std::span<const uint8_t>(_rxFrame));
+        if (_capture) {
+            _capture->recordFrame(frame_direction::RX, _rxFrame);
+        }
+        _finishReceive({}, handler);
+        return;
     }
-    catch (const std::exception& e) {
-        std::cerr << "Receive failed: " << e.what() << std::endl;
-        return {};
+    
+    auto writable = _rxBuffer.getWritableSpan();
+    if (writable.empty()) {
+        std::cerr << "Receive failed: buffer full without a complete frame" << std::endl;
+        _finishReceive(boost::asio::error::no_buffer_space, handler);
+        return;
     }
+    
+    _socket->async_read_some(boost::asio::buffer(writable.data(), writable.size()),
+        [this, handler = std::move(handler)](const boost::system::error_code& error, size_t bytesRead) mutable {
+            if (error) {
+                bool isTimeout = error == boost::asio::error::operation_aborted && _hasReceiveTimedOut;
+                _finishReceive(isTimeout ? boost::asio::error::timed_out : error, handler);
+                return;
+            }
+            
+            _rxLastReadTime = Clock::now();
+            if (_rxBuffer.isEmpty()) {
+                _rxFirstByteTime = _rxLastReadTime;
+            }
+            _rxBuffer.commit(bytesRead);
+            _continueReceive(std::move(handler));
+        });
 }
 
-std::vector<uint16_t> SungrowTcpClient::_parseModbusResponse(const std::vector<uint8_t>& response) {
-    if (response.size() < 9) {
-        throw std::runtime_error("Response too short");
+void SungrowTcpClient::_finishReceive(const boost::system::error_code& error, FrameHandler& handler) {
+    _isReceiving = false;
+    _receiveTimer.cancel();
+    
+    // A timeout keeps the partial frame for the next receive; anything else desyncs the stream
+    if (error && error != boost::asio::error::timed_out) {
+        _rxBuffer.clear();
+        _rxFrame.clear();
+        _clearPlainFrames();
     }
     
-    std::cout << "Response analysis - Size: " << response.size() << " bytes" << std::endl;
-    std::cout << "Raw response: ";
-    for (size_t i = 0; i < response.size(); i++) {
-        printf("0x%02X ", response[i]);
+    handler(error);
+}
+
+void SungrowTcpClient::_decryptBufferedFrames() {
+    // Every complete frame buffered so far goes in one run; for a pipelined
+    // read that is often the whole window
+    size_t buffered = _rxBuffer.getSize();
+    _rxBatch.resize(buffered);
+    _rxBuffer.copyOut(_rxBatch.data(), buffered);
+    
+    size_t runSize = 0;
+    while (runSize < buffered) {
+        size_t frameSize = SungrowCrypto::getEncryptedFrameSize(_rxBatch.data() + runSize, buffered - runSize);
+        if (frameSize == 0 || frameSize > MAX_FRAME_SIZE || buffered - runSize < frameSize) {
+            break;  // Partial, or malformed and left for _nextFrameSize to reject
+        }
+        auto frame = std::span<const uint8_t>(_rxBatch).subspan(runSize, frameSize);
+        SUNGROW_TRACE_FRAME(frame_direction::RX, frame);
+        if (_capture) {
+            _capture->recordFrame(frame_direction::RX, frame);
+        }
+        runSize += frameSize;
+    }
+    _rxBuffer.consume(runSize);
+    
+    _rxPlainFrames.clear();
+    _rxPlainIndex = 0;
+    auto decryptStart = Clock::now();
+    size_t decrypted = _crypto->decryptFrames(std::span<uint8_t>(_rxBatch).first(runSize), _rxPlainFrames);
+    auto decrypt = Clock::now() - decryptStart;
+    _hasBatchDecryptFailed = decrypted < runSize;
+    
+    // Frames after the first began in the read that completed the run
+    _rxBatchTiming = {_rxFirstByteTime, _rxLastReadTime, decrypt / std::max<size_t>(_rxPlainFrames.size(), 1)};
+    if (!_rxBuffer.isEmpty()) {
+        _rxFirstByteTime = _rxLastReadTime;
+    }
+}
+
+void SungrowTcpClient::_takePlainFrame(FrameHandler& handler) {
+    if (_rxPlainIndex == _rxPlainFrames.size()) {
+        ++_statistics.decryptFailures;
+        std::cerr << "Receive failed: response could not be decrypted" << std::endl;
+        _finishReceive(boost::asio::error::invalid_argument, handler);
+        return;
+    }
+    
+    auto plain = _rxPlainFrames[_rxPlainIndex];
+    _rxFrame.assign(plain.begin(), plain.end());
+    _rxTiming = _rxBatchTiming;
+    if (_rxPlainIndex++ != 0) {
+        _rxTiming.firstByte = _rxBatchTiming.complete;
+    }
+    _finishReceive({}, handler);
+}
+
+void SungrowTcpClient::_clearPlainFrames() {
+    _rxPlainFrames.clear();
+    _rxPlainIndex = 0;
+    _hasBatchDecryptFailed = false;
+}
+
+std::vector<uint16_t> SungrowTcpClient::_readSingle(uint8_t functionCode, uint16_t address, uint16_t count) {
+    auto results = readPipelined({{functionCode, address, count}});
+    auto& result = results.front();
+    
+    if (result.exceptionCode != 0) {
+        throw ModbusException(result.error, result.exceptionCode);
+    }
+    if (!result.success) {
+        throw std::runtime_error(result.error);
+    }
+    return std::move(result.registers);
+}
+
+void SungrowTcpClient::encodeReadRequest(uint8_t* out, uint16_t transactionId, uint8_t slaveId, const ModbusReadRequest& request) {
+    out[0] = (transactionId >> 8) & 0xFF;
+    out[1] = transactionId & 0xFF;
+    
+    out[2] = 0x00;
+    out[3] = 0x00;
+    
+    out[4] = 0x00;
+    out[5] = 0x06;
+    
+    out[6] = slaveId;
+    out[7] = request.functionCode;
+    
+    out[8] = (request.address >> 8) & 0xFF;
+    out[9] = request.address & 0xFF;
+    
+    out[10] = (request.count >> 8) & 0xFF;
+    out[11] = request.count & 0xFF;
+}
+
+std::span<const uint8_t> SungrowTcpClient::_buildModbusFrame(const ModbusReadRequest& request) {
+    // The plain frame starts after room for the crypto header so it can be
+    // encrypted in place
+    ++_transactionId;
+    encodeReadRequest(_requestFrame.data() + SungrowCrypto::CRYPTO_HEADER_SIZE, _transactionId, _slaveId, request);
+    
+    return _applySungrowEncryption(READ_REQUEST_SIZE);
+}
+
+void SungrowTcpClient::parseReadResponse(std::span<const uint8_t> response, std::vector<uint16_t>& registers) {
+    if (response.size() < 9) {
+        throw std::runtime_error("Response too short");
     }
-    std::cout << std::endl;
     
     uint8_t functionCode = response[7];
     uint8_t byteCount = response[8];
     
-    std::cout << "Function Code: 0x" << std::hex << (int)functionCode << std::dec << std::endl;
-    std::cout << "Byte Count/Error: " << (int)byteCount << std::endl;
+    SUNGROW_TRACE(trace_level::DEBUG, "Response of " << response.size() << " bytes, function code 0x" << std::hex
+                  << static_cast<int>(functionCode) << std::dec << ", byte count/error " << static_cast<int>(byteCount));
     
     // Check for error response (function code + 0x80)
     if (functionCode & 0x80) {
@@ -178,100 +772,86 @@ std::vector<uint16_t> SungrowTcpClient::_parseModbusResponse(const std::vector<u
         std::string errorMsg = "Modbus Error - Function: 0x" + std::to_string(originalFunction) + ", Error Code: " + std::to_string(errorCode);
         
         switch (errorCode) {
-            case 1: errorMsg += " (Illegal Function)"; break;
-            case 2: errorMsg += " (Illegal Data Address)"; break;
-            case 3: errorMsg += " (Illegal Data Value)"; break;
-            case 4: errorMsg += " (Server Device Failure)"; break;
+            case ModbusException::ILLEGAL_FUNCTION: errorMsg += " (Illegal Function)"; break;
+            case ModbusException::ILLEGAL_DATA_ADDRESS: errorMsg += " (Illegal Data Address)"; break;
+            case ModbusException::ILLEGAL_DATA_VALUE: errorMsg += " (Illegal Data Value)"; break;
+            case ModbusException::SERVER_DEVICE_FAILURE: errorMsg += " (Server Device Failure)"; break;
             default: errorMsg += " (Unknown Error)"; break;
         }
         
-        throw std::runtime_error(errorMsg);
+        throw ModbusException(errorMsg, errorCode);
     }
     
     // Accept responses with reasonable function codes and byte counts
-    if ((functionCode == 0x02 || functionCode == 0x04) && byteCount > 0 && byteCount <= 250) {
-        if (response.size() >= 9 + byteCount) {
-            // This looks like a valid response
-            std::cout << "Valid response detected with " << (int)byteCount << " bytes of data" << std::endl;
-        } else {
+    if ((functionCode == 0x02 || functionCode == 0x03 || functionCode == 0x04) && byteCount > 0 && byteCount <= 250) {
+        if (response.size() < 9 + static_cast<size_t>(byteCount)) {
             throw std::runtime_error("Incomplete response data");
         }
     } else if (byteCount > 250 || byteCount == 0) {
         // This might be an invalid response
         throw std::runtime_error("Invalid response data");
     } else {
-        std::cout << "Warning: Unexpected function code 0x" << std::hex << (int)functionCode 
-                  << std::dec << ", attempting to parse anyway..." << std::endl;
-        if (response.size() < 9 + byteCount) {
+        SUNGROW_TRACE(trace_level::INFO, "Warning: Unexpected function code 0x" << std::hex << static_cast<int>(functionCode)
+                      << std::dec << ", attempting to parse anyway...");
+        if (response.size() < 9 + static_cast<size_t>(byteCount)) {
             throw std::runtime_error("Incomplete response data");
         }
     }
     
-    std::vector<uint16_t> registers;
-    for (int i = 0; i < byteCount; i += 2) {
-        uint16_t value = (response[9 + i] << 8) | response[9 + i + 1];
-        registers.push_back(value);
-    }
-    
-    return registers;
+    registers.resize(byteCount / 2);
+    ModbusDataConverter::swapWords(response.data() + 9, registers.size(), registers.data());
 }
 
-bool SungrowTcpClient::performKeyExchange() {
-    try {
-        std::cout << "Performing Sungrow key exchange..." << std::endl;
-        
-        auto keyCmd = SungrowCrypto::getKeyExchangeCommand();
-        
-        std::cout << "Sending key exchange command..." << std::endl;
-        boost::asio::write(*_socket, boost::asio::buffer(keyCmd));
-        
-        std::cout << "KEY_CMD: ";
-        for (auto byte : keyCmd) {
-            printf("0x%02X ", byte);
+uint16_t SungrowTcpClient::_extractTransactionId(const std::vector<uint8_t>& response) const {
+    return (static_cast<uint16_t>(response[0]) << 8) | response[1];
+}
+
+size_t SungrowTcpClient::_nextFrameSize() const {
+    if (_crypto->isEncryptionEnabled()) {
+        if (_rxBuffer.getSize() < SungrowCrypto::CRYPTO_HEADER_SIZE) {
+            return 0;
         }
-        std::cout << std::endl;
-        
-        std::vector<uint8_t> keyResponse(256);
-        size_t keyRespLen = _socket->read_some(boost::asio::buffer(keyResponse));
-        keyResponse.resize(keyRespLen);
         
-        std::cout << "KEY_RESP: ";
-        for (auto byte : keyResponse) {
-            printf("0x%02X ", byte);
-        }
-        std::cout << std::endl;
+        uint8_t header[SungrowCrypto::CRYPTO_HEADER_SIZE];
+        _rxBuffer.copyOut(header, sizeof(header));
         
-        if (keyResponse.size() >= 25) {
-            std::vector<uint8_t> publicKey(keyResponse.end() - 16, keyResponse.end());
-            
-            std::cout << "Extracted public key: ";
-            for (auto byte : publicKey) {
-                printf("0x%02X ", byte);
-            }
-            std::cout << std::endl;
-            
-            return _crypto->initializeEncryption(publicKey);
-        } else {
-            std::cerr << "Invalid key exchange response length: " << keyResponse.size() << std::endl;
-            return false;
+        size_t frameSize = SungrowCrypto::getEncryptedFrameSize(header, sizeof(header));
+        if (frameSize == 0 || frameSize > MAX_FRAME_SIZE) {
+            throw std::runtime_error("Malformed crypto header in response stream");
         }
+        return frameSize;
     }
-    catch (const std::exception& e) {
-        std::cerr << "Key exchange failed: " << e.what() << std::endl;
-        return false;
+    
+    if (_rxBuffer.getSize() < MBAP_HEADER_SIZE) {
+        return 0;
+    }
+    
+    // MBAP length field counts the unit ID and PDU following the header
+    uint16_t length = (static_cast<uint16_t>(_rxBuffer.peek(4)) << 8) | _rxBuffer.peek(5);
+    if (length == 0 || length > MAX_MBAP_LENGTH) {
+        throw std::runtime_error("Malformed MBAP header in response stream");
     }
+    return MBAP_HEADER_SIZE + length;
 }
 
-void SungrowTcpClient::_applySungrowEncryption(std::vector<uint8_t>& frame) {
-    if (_crypto && _crypto->isEncryptionEnabled()) {
-        frame = _crypto->encryptFrame(frame);
-    } else {
-        std::cout << "WARNING: Using standard Modbus (encryption not available)" << std::endl;
+bool SungrowTcpClient::_extractPublicKey(const std::vector<uint8_t>& keyResponse, std::vector<uint8_t>& publicKey) const {
+    if (keyResponse.size() < MBAP_HEADER_SIZE + 3 + PUBLIC_KEY_SIZE) {
+        std::cerr << "Invalid key exchange response length: " << keyResponse.size() << std::endl;
+        return false;
     }
+    
+    publicKey.assign(keyResponse.end() - PUBLIC_KEY_SIZE, keyResponse.end());
+    return true;
 }
 
-void SungrowTcpClient::_removeSungrowEncryption(std::vector<uint8_t>& response) {
+std::span<const uint8_t> SungrowTcpClient::_applySungrowEncryption(size_t frameSize) {
     if (_crypto && _crypto->isEncryptionEnabled()) {
-        response = _crypto->decryptFrame(response);
+        size_t encryptedSize = _crypto->encryptFrameInPlace(_requestFrame.data(), frameSize, _requestFrame.size());
+        if (encryptedSize != 0) {
+            return {_requestFrame.data(), encryptedSize};
+        }
+    } else {
+        SUNGROW_TRACE(trace_level::DEBUG, "Sending standard Modbus frame (encryption not available)");
     }
-}
\ No newline at end of file
+    return {_requestFrame.data() + SungrowCrypto::CRYPTO_HEADER_SIZE, frameSize};
+}
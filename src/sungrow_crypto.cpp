@@ -1,8 +1,10 @@
 #include "sungrow_crypto.hpp"
+#include "trace.hpp"
 #include <openssl/aes.h>
 #include <openssl/evp.h>
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 struct SungrowCrypto::AESContext {
     EVP_CIPHER_CTX* ctx;
@@ -15,6 +17,7 @@ struct SungrowCrypto::AESContext {
 
 SungrowCrypto::SungrowCrypto() : _encryptionEnabled(false) {
     _aesContext = std::make_unique<AESContext>();
+    _decryptContext = std::make_unique<AESContext>();
 }
 
 SungrowCrypto::~SungrowCrypto() = default;
@@ -38,14 +41,16 @@ bool SungrowCrypto::initializeEncryption(const std::vector<uint8_t>& publicKey)
     
     EVP_CIPHER_CTX_set_padding(_aesContext->ctx, 0);
     
+    if (EVP_DecryptInit_ex(_decryptContext->ctx, EVP_aes_128_ecb(), nullptr, _aesKey.data(), nullptr) != 1) {
+        std::cerr << "Failed to initialize AES decryption" << std::endl;
+        return false;
+    }
+    
+    EVP_CIPHER_CTX_set_padding(_decryptContext->ctx, 0);
+    
     _encryptionEnabled = true;
     
-    std::cout << "Sungrow encryption initialized successfully" << std::endl;
-    std::cout << "AES Key: ";
-    for (auto byte : _aesKey) {
-        printf("%02X ", byte);
-    }
-    std::cout << std::endl;
+    SUNGROW_TRACE(trace_level::DEBUG, "Sungrow encryption initialized successfully");
     
     return true;
 }
@@ -61,18 +66,6 @@ void SungrowCrypto::_deriveKey(const std::vector<uint8_t>& publicKey) {
     for (int i = 0; i < 16; i++) {
         _aesKey.push_back(publicKey[i] ^ PRIVATE_KEY[i]);
     }
-    
-    std::cout << "Key derivation - Public Key: ";
-    for (int i = 0; i < 16; i++) {
-        printf("%02X ", publicKey[i]);
-    }
-    std::cout << std::endl;
-    
-    std::cout << "Key derivation - Private Key: ";
-    for (int i = 0; i < 16; i++) {
-        printf("%02X ", PRIVATE_KEY[i]);
-    }
-    std::cout << std::endl;
 }
 
 std::vector<uint8_t> SungrowCrypto::encryptFrame(const std::vector<uint8_t>& frame) {
@@ -80,29 +73,33 @@ std::vector<uint8_t> SungrowCrypto::encryptFrame(const std::vector<uint8_t>& fra
         return frame;
     }
     
-    auto paddedFrame = _addPadding(frame);
-    uint8_t paddingLength = paddedFrame.size() - frame.size();
+    std::vector<uint8_t> result(CRYPTO_HEADER_SIZE + getPaddedSize(frame.size()));
+    std::copy(frame.begin(), frame.end(), result.begin() + CRYPTO_HEADER_SIZE);
     
-    std::vector<uint8_t> encrypted(paddedFrame.size());
-    int outLen = 0;
-    
-    if (EVP_EncryptUpdate(_aesContext->ctx, encrypted.data(), &outLen, paddedFrame.data(), paddedFrame.size()) != 1) {
-        std::cerr << "AES encryption failed" << std::endl;
+    if (encryptFrameInPlace(result.data(), frame.size(), result.size()) == 0) {
         return frame;
     }
+    return result;
+}
+
+size_t SungrowCrypto::encryptFrameInPlace(uint8_t* buffer, size_t frameSize, size_t capacity) {
+    size_t paddedSize = getPaddedSize(frameSize);
+    if (CRYPTO_HEADER_SIZE + paddedSize > capacity) {
+        return 0;
+    }
     
-    encrypted.resize(outLen);
-    
-    auto cryptoHeader = _createCryptoHeader(frame.size(), paddingLength);
-    
-    std::vector<uint8_t> result;
-    result.reserve(cryptoHeader.size() + encrypted.size());
-    result.insert(result.end(), cryptoHeader.begin(), cryptoHeader.end());
-    result.insert(result.end(), encrypted.begin(), encrypted.end());
+    uint8_t* payload = buffer + CRYPTO_HEADER_SIZE;
+    std::fill(payload + frameSize, payload + paddedSize, 0x00);
     
-    std::cout << "Frame encrypted: " << frame.size() << " -> " << result.size() << " bytes" << std::endl;
+    // ECB has no chaining, so the ciphertext can overwrite the plaintext
+    int outLen = 0;
+    if (EVP_EncryptUpdate(_aesContext->ctx, payload, &outLen, payload, static_cast<int>(paddedSize)) != 1) {
+        std::cerr << "AES encryption failed" << std::endl;
+        return 0;
+    }
     
-    return result;
+    _writeCryptoHeader(buffer, static_cast<uint16_t>(frameSize), static_cast<uint8_t>(paddedSize - frameSize));
+    return CRYPTO_HEADER_SIZE + outLen;
 }
 
 std::vector<uint8_t> SungrowCrypto::decryptFrame(const std::vector<uint8_t>& encryptedFrame) {
@@ -110,116 +107,88 @@ std::vector<uint8_t> SungrowCrypto::decryptFrame(const std::vector<uint8_t>& enc
         return encryptedFrame;
     }
     
-    std::cout << "Decrypting frame of " << encryptedFrame.size() << " bytes: ";
-    for (auto byte : encryptedFrame) {
-        printf("0x%02X ", byte);
-    }
-    std::cout << std::endl;
-    
-    // For responses, we need to decrypt differently
-    // The response format appears to be: [MBAP header][encrypted response]
-    // Skip MBAP header (first 6 bytes) and decrypt the rest
-    if (encryptedFrame.size() <= 6) {
-        std::cout << "Frame too short for decryption" << std::endl;
+    std::vector<uint8_t> frame = encryptedFrame;
+    size_t plainSize = decryptFrameInPlace(frame);
+    if (plainSize == 0) {
+        std::cerr << "Frame too short for decryption" << std::endl;
         return encryptedFrame;
     }
     
-    // Extract MBAP header and encrypted payload
-    std::vector<uint8_t> mbapHeader(encryptedFrame.begin(), encryptedFrame.begin() + 6);
-    std::vector<uint8_t> encryptedPayload(encryptedFrame.begin() + 6, encryptedFrame.end());
-    
-    // Pad encrypted payload to 16-byte boundary if needed
-    while (encryptedPayload.size() % 16 != 0) {
-        encryptedPayload.push_back(0x00);
-    }
-    
-    std::cout << "MBAP header: ";
-    for (auto byte : mbapHeader) {
-        printf("0x%02X ", byte);
+    frame.erase(frame.begin(), frame.begin() + CRYPTO_HEADER_SIZE);
+    frame.resize(plainSize);
+    return frame;
+}
+
+size_t SungrowCrypto::decryptFrameInPlace(std::span<uint8_t> frame) {
+    // Responses mirror the request format: [crypto header][AES-ECB ciphertext],
+    // where the header carries the plain frame length and the padding added
+    size_t frameSize = getEncryptedFrameSize(frame.data(), frame.size());
+    if (frameSize == 0 || frame.size() < frameSize) {
+        return 0;
     }
-    std::cout << std::endl;
     
-    std::cout << "Encrypted payload (" << encryptedPayload.size() << " bytes): ";
-    for (auto byte : encryptedPayload) {
-        printf("0x%02X ", byte);
-    }
-    std::cout << std::endl;
+    uint16_t length = 0;
+    uint8_t paddingLength = 0;
+    _parseCryptoHeader(frame.data(), frame.size(), length, paddingLength);
     
-    // Decrypt the payload
-    std::vector<uint8_t> decrypted(encryptedPayload.size());
+    uint8_t* ciphertext = frame.data() + CRYPTO_HEADER_SIZE;
     int outLen = 0;
-    
-    EVP_CIPHER_CTX* decryptCtx = EVP_CIPHER_CTX_new();
-    if (EVP_DecryptInit_ex(decryptCtx, EVP_aes_128_ecb(), nullptr, _aesKey.data(), nullptr) != 1) {
-        EVP_CIPHER_CTX_free(decryptCtx);
-        std::cerr << "Failed to initialize decryption context" << std::endl;
-        return encryptedFrame;
-    }
-    
-    EVP_CIPHER_CTX_set_padding(decryptCtx, 0);
-    
-    if (EVP_DecryptUpdate(decryptCtx, decrypted.data(), &outLen, encryptedPayload.data(), encryptedPayload.size()) != 1) {
+    if (EVP_DecryptUpdate(_decryptContext->ctx, ciphertext, &outLen, ciphertext, static_cast<int>(frameSize - CRYPTO_HEADER_SIZE)) != 1) {
         std::cerr << "AES decryption failed" << std::endl;
-        EVP_CIPHER_CTX_free(decryptCtx);
-        return encryptedFrame;
+        return 0;
     }
     
-    EVP_CIPHER_CTX_free(decryptCtx);
-    
-    std::cout << "Decrypted payload (" << outLen << " bytes): ";
-    for (int i = 0; i < outLen; i++) {
-        printf("0x%02X ", decrypted[i]);
-    }
-    std::cout << std::endl;
-    
-    // Reconstruct the full Modbus frame
-    std::vector<uint8_t> result;
-    result.insert(result.end(), mbapHeader.begin(), mbapHeader.end());
-    result.insert(result.end(), decrypted.begin(), decrypted.begin() + outLen);
-    
-    // Remove any padding zeros from the end
-    while (result.size() > 6 && result.back() == 0x00) {
-        result.pop_back();
-    }
-    
-    std::cout << "Final decrypted frame (" << result.size() << " bytes): ";
-    for (auto byte : result) {
-        printf("0x%02X ", byte);
-    }
-    std::cout << std::endl;
-    
-    return result;
+    // The zero padding is dropped by reporting the length from the crypto header
+    return std::min<size_t>(length, outLen);
+}
+
+size_t SungrowCrypto::decryptFrames(std::span<uint8_t> stream, std::vector<std::span<const uint8_t>>& plainFrames) {
+    size_t consumed = 0;
+    
+    while (consumed < stream.size()) {
+        auto remaining = stream.subspan(consumed);
+        size_t frameSize = getEncryptedFrameSize(remaining.data(), remaining.size());
+        if (frameSize == 0 || remaining.size() < frameSize) {
+            break;
+        }
+        
+        size_t plainSize = decryptFrameInPlace(remaining.first(frameSize));
+        if (plainSize == 0) {
+            break;
+        }
+        
+        plainFrames.emplace_back(remaining.data() + CRYPTO_HEADER_SIZE, plainSize);
+        consumed += frameSize;
+    }
+    
+    return consumed;
 }
 
-std::vector<uint8_t> SungrowCrypto::_addPadding(const std::vector<uint8_t>& data) {
-    size_t paddingNeeded = 16 - (data.size() % 16);
-    if (paddingNeeded == 16) paddingNeeded = 0;
+size_t SungrowCrypto::getEncryptedFrameSize(const uint8_t* header, size_t available) {
+    uint16_t length = 0;
+    uint8_t paddingLength = 0;
     
-    std::vector<uint8_t> padded = data;
-    for (size_t i = 0; i < paddingNeeded; i++) {
-        padded.push_back(0x00);
+    if (!_parseCryptoHeader(header, available, length, paddingLength)) {
+        return 0;
     }
     
-    return padded;
-}
-
-std::vector<uint8_t> SungrowCrypto::_removePadding(const std::vector<uint8_t>& data) {
-    return data;
+    size_t ciphertextSize = static_cast<size_t>(length) + paddingLength;
+    if (length == 0 || paddingLength >= BLOCK_SIZE || ciphertextSize % BLOCK_SIZE != 0) {
+        return 0;
+    }
+    
+    return CRYPTO_HEADER_SIZE + ciphertextSize;
 }
 
-std::vector<uint8_t> SungrowCrypto::_createCryptoHeader(uint16_t length, uint8_t paddingLength) {
-    std::vector<uint8_t> header(4);
-    
+void SungrowCrypto::_writeCryptoHeader(uint8_t* header, uint16_t length, uint8_t paddingLength) {
     header[0] = (length >> 8) & 0xFF;
     header[1] = length & 0xFF;
     header[2] = 0x00;
     header[3] = paddingLength;
-    
-    return header;
 }
 
-bool SungrowCrypto::_parseCryptoHeader(const std::vector<uint8_t>& data, uint16_t& length, uint8_t& paddingLength) {
-    if (data.size() < 4) return false;
+bool SungrowCrypto::_parseCryptoHeader(const uint8_t* data, size_t size, uint16_t& length, uint8_t& paddingLength) {
+    if (size < CRYPTO_HEADER_SIZE) return false;
     
     length = (static_cast<uint16_t>(data[0]) << 8) | data[1];
     paddingLength = data[3];
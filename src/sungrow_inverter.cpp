@@ -1,18 +1,40 @@
 #include "sungrow_inverter.hpp"
+#include "discovery_map.hpp"
+#include "register_map.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <iomanip>
 #include <chrono>
 #include <ctime>
+#include <algorithm>
 
 SungrowInverter::SungrowInverter(const InverterConfig& config)
-    : _config(config) {
+    : _config(config), _planCompiler(config.readPlanMaxGap) {
     _client = std::make_unique<SungrowTcpClient>(_config.host, _config.port, _config.slaveId);
+    _configureClient();
+}
+
+SungrowInverter::SungrowInverter(const InverterConfig& config, boost::asio::any_io_executor executor)
+    : _config(config), _planCompiler(config.readPlanMaxGap) {
+    _client = std::make_unique<SungrowTcpClient>(executor, _config.host, _config.port, _config.slaveId);
+    _configureClient();
 }
 
 SungrowInverter::~SungrowInverter() {
     disconnect();
 }
 
+void SungrowInverter::_configureClient() {
+    _client->setPipelineWindow(_config.pipelineWindow);
+    _client->setProbeTimeout(std::chrono::milliseconds(_config.connectProbeMs));
+    _client->setConnectTimeout(std::chrono::milliseconds(_config.timeoutMs));
+    _client->setResponseTimeout(std::chrono::milliseconds(_config.timeoutMs));
+    _client->setMaxRetries(_config.retries);
+    if (!_config.capturePath.empty()) {
+        _client->setCapture(std::make_unique<FrameCaptureWriter>(_config.capturePath));
+    }
+}
+
 bool SungrowInverter::connect() {
     return _client->connect();
 }
@@ -25,155 +47,366 @@ bool SungrowInverter::isConnected() const {
     return _client->isConnected();
 }
 
-bool SungrowInverter::detectModel() {
+bool SungrowInverter::detectIdentity() {
     try {
-        auto registers = _client->readInputRegisters(RegisterAddresses::DEVICE_TYPE_ADDR, 1);
-        if (!registers.empty()) {
-            uint16_t deviceCode = registers[0];
-            std::cout << "Device code received: 0x" << std::hex << deviceCode << std::dec << " (" << deviceCode << ")" << std::endl;
-            
-            if (deviceCode == 0x2403 || deviceCode == 0x08) {
-                _latestData.deviceType = "SG8K-D";
-                std::cout << "Detected Model: " << _latestData.deviceType << std::endl;
-                return true;
-            } else if (deviceCode != 0 && deviceCode != 0xFFFF) {
-                _latestData.deviceType = "Sungrow Inverter (Code: 0x" + std::to_string(deviceCode) + ")";
-                std::cout << "Detected Sungrow inverter with code: " << _latestData.deviceType << std::endl;
-                return true;
-            } else {
-                std::cout << "Invalid device code: 0x" << std::hex << deviceCode << std::endl;
-                _latestData.deviceType = "Unknown";
-            }
-        }
+        auto registers = _client->readInputRegisters(RegisterAddresses::SERIAL_START_ADDR, RegisterAddresses::IDENTITY_LENGTH);
+        RegisterImage identity;
+        identity.store(RegisterMap::INPUT_REGISTERS, RegisterAddresses::SERIAL_START_ADDR, registers);
+        return _applyIdentity(identity);
     }
     catch (const std::exception& e) {
-        std::cerr << "Model detection failed: " << e.what() << std::endl;
+        std::cerr << "Identity detection failed: " << e.what() << std::endl;
     }
     return false;
 }
 
-bool SungrowInverter::detectSerial() {
-    try {
-        auto registers = _client->readInputRegisters(RegisterAddresses::SERIAL_START_ADDR, RegisterAddresses::SERIAL_LENGTH);
-        if (registers.size() >= RegisterAddresses::SERIAL_LENGTH) {
-            _latestData.serialNumber = _converter.convertUTF8(registers, 0, RegisterAddresses::SERIAL_LENGTH);
-            std::cout << "Serial Number: " << _latestData.serialNumber << std::endl;
-            return true;
-        }
+bool SungrowInverter::restoreIdentity() {
+    if (_hasIdentity) {
+        // Reconnected; the unit behind the address may have been swapped meanwhile
+        _isIdentityUnverified = true;
+        return true;
     }
-    catch (const std::exception& e) {
-        std::cerr << "Serial detection failed: " << e.what() << std::endl;
+    if (_config.identityCachePath.empty()) {
+        return false;
+    }
+    
+    IdentityCache cache;
+    const CachedIdentity* cached = cache.load(_config.identityCachePath) ?
+        cache.findEndpoint(_config.host, _config.port, _config.slaveId) : nullptr;
+    if (cached == nullptr) {
+        return false;
+    }
+    
+    std::cout << "Using cached identity of " << _config.host << ":" << _config.port << std::endl;
+    if (!_applyDeviceCode(cached->deviceCode)) {
+        return false;
+    }
+    _latestData.serialNumber = cached->serialNumber;
+    std::cout << "Serial Number: " << _latestData.serialNumber << std::endl;
+    for (const auto& range : cached->illegal) {
+        _planCompiler.addIllegalRange(range);
     }
+    _loadDiscoveryMap();
+    
+    _hasIdentity = true;
+    _isIdentityUnverified = true;
+    return true;
+}
+
+void SungrowInverter::asyncConnect(std::function<void(bool)> handler) {
+    _client->asyncConnect(std::move(handler));
+}
+
+void SungrowInverter::asyncDetectIdentity(std::function<void(bool)> handler) {
+    std::vector<ModbusReadRequest> requests = {
+        {0x04, RegisterAddresses::SERIAL_START_ADDR, RegisterAddresses::IDENTITY_LENGTH}
+    };
+    
+    _client->asyncReadPipelined(std::move(requests), [this, handler = std::move(handler)](std::vector<ModbusReadResult> results) {
+        if (!results[0].success) {
+            handler(false);
+            return;
+        }
+        RegisterImage identity;
+        identity.store(RegisterMap::INPUT_REGISTERS, RegisterAddresses::SERIAL_START_ADDR, results[0].registers);
+        handler(_applyIdentity(identity));
+    });
+}
+
+bool SungrowInverter::_applyDeviceCode(uint16_t deviceCode) {
+    std::cout << "Device code received: 0x" << std::hex << deviceCode << std::dec << " (" << deviceCode << ")" << std::endl;
+    _deviceCode = deviceCode;
+    
+    if (deviceCode == 0x2403 || deviceCode == 0x08) {
+        _latestData.deviceType = "SG8K-D";
+        std::cout << "Detected Model: " << _latestData.deviceType << std::endl;
+        return true;
+    } else if (deviceCode != 0 && deviceCode != 0xFFFF) {
+        _latestData.deviceType = "Sungrow Inverter (Code: 0x" + std::to_string(deviceCode) + ")";
+        std::cout << "Detected Sungrow inverter with code: " << _latestData.deviceType << std::endl;
+        return true;
+    }
+    
+    std::cout << "Invalid device code: 0x" << std::hex << deviceCode << std::dec << std::endl;
+    _latestData.deviceType = "Unknown";
     return false;
 }
 
-bool SungrowInverter::scrapeData() {
-    bool success = true;
+bool SungrowInverter::_applyIdentity(const RegisterImage& identity) {
+    if (!identity.contains(RegisterMap::INPUT_REGISTERS, RegisterAddresses::SERIAL_START_ADDR, RegisterAddresses::IDENTITY_LENGTH)) {
+        return false;
+    }
     
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    _latestData.timestamp = std::ctime(&time_t);
+    _hasIdentity = _applyDeviceCode(identity.get(RegisterMap::INPUT_REGISTERS, RegisterAddresses::DEVICE_TYPE_ADDR));
+    _isIdentityUnverified = false;
+    RegisterMap::decode(register_group::IDENTITY, identity, _latestData);
+    std::cout << "Serial Number: " << _latestData.serialNumber << std::endl;
     
-    success &= _readPowerData();
-    success &= _readEnergyData();
-    success &= _readSystemStatus();
+    _loadDiscoveryMap();
+    _storeIdentity();
+    return _hasIdentity;
+}
+
+void SungrowInverter::_revalidateIdentity() {
+    if (!_isIdentityUnverified ||
+        !_registerImage.contains(RegisterMap::INPUT_REGISTERS, RegisterAddresses::SERIAL_START_ADDR, RegisterAddresses::IDENTITY_LENGTH)) {
+        return;
+    }
+    
+    uint16_t deviceCode = _registerImage.get(RegisterMap::INPUT_REGISTERS, RegisterAddresses::DEVICE_TYPE_ADDR);
+    InverterData current;
+    RegisterMap::decode(register_group::IDENTITY, _registerImage, current);
+    if (deviceCode == _deviceCode && current.serialNumber == _latestData.serialNumber) {
+        _isIdentityUnverified = false;
+        SUNGROW_TRACE(trace_level::INFO, "Identity of " << _client->getHost() << " confirmed");
+        return;
+    }
+    
+    // A different unit answers at this address; its firmware may differ too
+    std::cout << "Inverter at " << _client->getHost() << " is now " << current.serialNumber
+              << " (was " << _latestData.serialNumber << "); rebuilding the read plan" << std::endl;
+    _planCompiler = ReadPlanCompiler(_config.readPlanMaxGap);
+    _isDiscoveryLoaded = false;
+    _applyIdentity(_registerImage);
+}
+
+void SungrowInverter::_loadDiscoveryMap() {
+    if (_config.discoveryPath.empty() || _isDiscoveryLoaded) {
+        return;
+    }
+    _isDiscoveryLoaded = true;
+    
+    DiscoveryMap map;
+    if (!map.load(_config.discoveryPath)) {
+        std::cerr << "Discovery map " << _config.discoveryPath << " is missing or unreadable" << std::endl;
+        return;
+    }
+    const DiscoveredDevice* device = map.findDevice(_deviceCode, _latestData.serialNumber);
+    if (device == nullptr) {
+        std::cout << "Read plan: " << _latestData.serialNumber << " is not in " << _config.discoveryPath
+                  << "; illegal gaps will be learned while polling" << std::endl;
+        return;
+    }
     
-    return success;
+    for (const auto& range : device->illegal) {
+        _planCompiler.addIllegalRange(range);
+    }
+    std::cout << "Read plan: " << device->illegal.size() << " illegal ranges of " << _latestData.serialNumber
+              << " loaded from " << _config.discoveryPath << std::endl;
 }
 
-bool SungrowInverter::_readPowerData() {
+void SungrowInverter::_storeIdentity() {
+    if (_config.identityCachePath.empty() || !_hasIdentity) {
+        return;
+    }
+    
+    CachedIdentity identity{_config.host, _config.port, _config.slaveId, _deviceCode, _latestData.serialNumber,
+                            _planCompiler.getIllegalRanges()};
     try {
-        // Try reading the confirmed working register first
-        auto registers = _client->readInputRegisters(RegisterAddresses::DAILY_POWER_YIELDS, 2);
-        if (registers.size() >= 2) {
-            uint32_t dailyRaw = _converter.convertU32(registers[0], registers[1]);
-            _latestData.dailyPowerYields = _converter.applyAccuracy(dailyRaw, 0.1);
-            std::cout << "Daily Power Yields read successfully: " << _latestData.dailyPowerYields << " kWh" << std::endl;
-        }
+        IdentityCache::store(_config.identityCachePath, identity);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Identity cache not saved: " << e.what() << std::endl;
+    }
+}
+
+std::vector<RegisterSpan> SungrowInverter::_withIdentitySpan(const std::vector<RegisterSpan>& wanted) const {
+    if (!_isIdentityUnverified) {
+        return wanted;
+    }
+    // Usually merges into the power block, so revalidation costs no extra read
+    auto planned = wanted;
+    planned.push_back({RegisterMap::INPUT_REGISTERS, RegisterAddresses::SERIAL_START_ADDR, RegisterAddresses::IDENTITY_LENGTH});
+    return planned;
+}
+
+std::vector<PollGroup> SungrowInverter::getPollGroups() const {
+    using std::chrono::seconds;
+    return {
+        {register_group::POWER, RegisterMap::getSpans(register_group::POWER), seconds(_config.powerIntervalSec), seconds(0)},
+        {register_group::DAILY_ENERGY, RegisterMap::getSpans(register_group::DAILY_ENERGY), seconds(_config.scanIntervalSec), seconds(0)},
+        {register_group::LIFETIME_TOTALS, RegisterMap::getSpans(register_group::LIFETIME_TOTALS), seconds(_config.totalsIntervalSec), seconds(0)}
+    };
+}
+
+bool SungrowInverter::scrapeData() {
+    std::vector<RegisterSpan> wanted;
+    for (const auto& group : getPollGroups()) {
+        wanted.insert(wanted.end(), group.spans.begin(), group.spans.end());
+    }
+    return scrapeRegisters(wanted);
+}
+
+bool SungrowInverter::scrapeRegisters(const std::vector<RegisterSpan>& wanted) {
+    auto scrapeStart = std::chrono::steady_clock::now();
+    _beginScrape();
+    
+    size_t blockReads = 0;
+    try {
+        auto planned = _withIdentitySpan(wanted);
+        auto blocks = _planCompiler.compile(planned);
+        auto results = _client->readPipelined(ReadPlanCompiler::toRequests(blocks));
+        blockReads = blocks.size();
         
-        // Try reading other registers individually to identify which ones work
-        try {
-            registers = _client->readInputRegisters(RegisterAddresses::TOTAL_POWER_YIELDS, 2);
-            if (registers.size() >= 2) {
-                uint32_t totalRaw = _converter.convertU32(registers[0], registers[1]);
-                _latestData.totalPowerYields = _converter.applyAccuracy(totalRaw, 0.1);
-                std::cout << "Total Power Yields read successfully: " << _latestData.totalPowerYields << " kWh" << std::endl;
-            }
-        } catch (const std::exception& e) {
-            std::cout << "Total Power Yields read failed: " << e.what() << std::endl;
-        }
+        std::vector<RegisterRange> failedBlocks;
+        auto retrySpans = _storeBlockResults(blocks, results, planned, failedBlocks);
         
-        try {
-            registers = _client->readInputRegisters(RegisterAddresses::TOTAL_ACTIVE_POWER, 2);
-            if (registers.size() >= 2) {
-                _latestData.totalActivePower = _converter.convertU32(registers[0], registers[1]);
-                std::cout << "Total Active Power read successfully: " << _latestData.totalActivePower << " W" << std::endl;
-            }
-        } catch (const std::exception& e) {
-            std::cout << "Total Active Power read failed: " << e.what() << std::endl;
+        if (!retrySpans.empty()) {
+            auto retryBlocks = ReadPlanCompiler(0).compile(retrySpans);
+            auto retryResults = _client->readPipelined(ReadPlanCompiler::toRequests(retryBlocks));
+            blockReads += retryBlocks.size();
+            
+            _storeBlockResults(retryBlocks, retryResults, {}, failedBlocks);
+            _learnIllegalGaps(failedBlocks, planned);
         }
-        
-        return true;  // Return success if we got at least one reading
     }
     catch (const std::exception& e) {
-        std::cerr << "Power data read failed: " << e.what() << std::endl;
+        std::cerr << "Scrape failed: " << e.what() << std::endl;
+        ++_scrapeFailures;
         return false;
     }
+    
+    return _finishScrape(wanted, blockReads, scrapeStart);
 }
 
-bool SungrowInverter::_readEnergyData() {
-    try {
-        // Read energy consumption data in one efficient range (following Python SunGather pattern)
-        auto registers = _client->readInputRegisters(RegisterRanges::CONSUMPTION_DATA.startAddr, RegisterRanges::CONSUMPTION_DATA.count);
-        
-        if (registers.size() >= RegisterRanges::CONSUMPTION_DATA.count) {
-            // Daily Export Energy (offset 0-1 in range, register 5092-5093 zero-based)
-            uint32_t dailyExportRaw = _converter.convertU32(registers[0], registers[1]);
-            _latestData.dailyExportEnergy = _converter.applyAccuracy(dailyExportRaw, 0.1);
-            
-            // Total Export Energy (offset 2-3 in range, register 5094-5095 zero-based)
-            uint32_t totalExportRaw = _converter.convertU32(registers[2], registers[3]);
-            _latestData.totalExportEnergy = _converter.applyAccuracy(totalExportRaw, 0.1);
-            
-            // Daily Import Energy (offset 4-5 in range, register 5096-5097 zero-based)
-            uint32_t dailyImportRaw = _converter.convertU32(registers[4], registers[5]);
-            _latestData.dailyImportEnergy = _converter.applyAccuracy(dailyImportRaw, 0.1);
+void SungrowInverter::asyncScrapeRegisters(std::vector<RegisterSpan> wanted, std::function<void(bool)> handler) {
+    auto scrapeStart = std::chrono::steady_clock::now();
+    _beginScrape();
+    
+    auto planned = _withIdentitySpan(wanted);
+    auto blocks = std::make_shared<std::vector<RegisterRange>>(_planCompiler.compile(planned));
+    auto requests = ReadPlanCompiler::toRequests(*blocks);
+    
+    _client->asyncReadPipelined(std::move(requests),
+        [this, blocks, wanted = std::move(wanted), planned = std::move(planned), handler = std::move(handler), scrapeStart](std::vector<ModbusReadResult> results) mutable {
+            auto failedBlocks = std::make_shared<std::vector<RegisterRange>>();
+            auto retrySpans = _storeBlockResults(*blocks, results, planned, *failedBlocks);
             
-            // Total Import Energy (offset 6-7 in range, register 5098-5099 zero-based)
-            uint32_t totalImportRaw = _converter.convertU32(registers[6], registers[7]);
-            _latestData.totalImportEnergy = _converter.applyAccuracy(totalImportRaw, 0.1);
+            if (retrySpans.empty()) {
+                handler(_finishScrape(wanted, blocks->size(), scrapeStart));
+                return;
+            }
             
-            // Daily Direct Consumption (offset 8-9 in range, register 5100-5101 zero-based)
-            uint32_t dailyDirectRaw = _converter.convertU32(registers[8], registers[9]);
-            _latestData.dailyDirectConsumption = _converter.applyAccuracy(dailyDirectRaw, 0.1);
+            auto retryBlocks = std::make_shared<std::vector<RegisterRange>>(ReadPlanCompiler(0).compile(retrySpans));
+            size_t blockReads = blocks->size() + retryBlocks->size();
             
-            // Total Direct Consumption (offset 10-11 in range, register 5102-5103 zero-based)
-            uint32_t totalDirectRaw = _converter.convertU32(registers[10], registers[11]);
-            _latestData.totalDirectConsumption = _converter.applyAccuracy(totalDirectRaw, 0.1);
+            _client->asyncReadPipelined(ReadPlanCompiler::toRequests(*retryBlocks),
+                [this, retryBlocks, failedBlocks, wanted = std::move(wanted), planned = std::move(planned), handler = std::move(handler), scrapeStart, blockReads](std::vector<ModbusReadResult> retryResults) {
+                    _storeBlockResults(*retryBlocks, retryResults, {}, *failedBlocks);
+                    _learnIllegalGaps(*failedBlocks, planned);
+                    handler(_finishScrape(wanted, blockReads, scrapeStart));
+                });
+        });
+}
+
+void SungrowInverter::_beginScrape() {
+    auto now = std::chrono::system_clock::now();
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    _latestData.timestamp = std::ctime(&time_t);
+    
+    _registerImage.clear();
+}
+
+std::vector<RegisterSpan> SungrowInverter::_storeBlockResults(const std::vector<RegisterRange>& blocks, const std::vector<ModbusReadResult>& results,
+                                                              const std::vector<RegisterSpan>& wanted, std::vector<RegisterRange>& failedBlocks) {
+    std::vector<RegisterSpan> retrySpans;
+    
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (results[i].success) {
+            _registerImage.store(blocks[i].functionCode, blocks[i].startAddr, results[i].registers);
+        } else if (results[i].exceptionCode == ModbusException::ILLEGAL_DATA_ADDRESS && !wanted.empty()) {
+            // A filler register may be the illegal one; retry the wanted spans on their own
+            for (const auto& span : wanted) {
+                if (span.functionCode == blocks[i].functionCode && span.address >= blocks[i].startAddr &&
+                    span.address < blocks[i].startAddr + blocks[i].count) {
+                    retrySpans.push_back(span);
+                }
+            }
+            failedBlocks.push_back(blocks[i]);
         }
-        
-        return true;
     }
-    catch (const std::exception& e) {
-        std::cerr << "Energy data read failed: " << e.what() << std::endl;
+    
+    return retrySpans;
+}
+
+bool SungrowInverter::_finishScrape(const std::vector<RegisterSpan>& wanted, size_t blockReads, std::chrono::steady_clock::time_point scrapeStart) {
+    _revalidateIdentity();
+    _decodeRegisters();
+    
+    size_t missingSpans = 0;
+    for (const auto& span : wanted) {
+        if (!_registerImage.contains(span.functionCode, span.address, span.count)) {
+            std::cerr << "Register " << span.address << " (" << span.count << " words) not available" << std::endl;
+            ++missingSpans;
+        }
+    }
+    
+    _lastScrapeLatency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - scrapeStart);
+    SUNGROW_TRACE(trace_level::INFO, "Scrape of " << _client->getHost() << " completed in " << _lastScrapeLatency.count() / 1000.0 << " ms ("
+                  << blockReads << " block reads, pipeline window " << static_cast<int>(_client->getPipelineWindow()) << ")");
+    
+    if (missingSpans != 0) {
+        // Readers keep the last complete sample and its timestamp
+        ++_scrapeFailures;
         return false;
     }
+    _snapshot.publish(_latestData, std::chrono::system_clock::now());
+    return true;
 }
 
-bool SungrowInverter::_readSystemStatus() {
-    try {
-        // Read Daily Running Time separately (register 5112 zero-based)
-        auto registers = _client->readInputRegisters(RegisterAddresses::DAILY_RUNNING_TIME, 1);
-        if (!registers.empty()) {
-            _latestData.dailyRunningTime = _converter.convertU16(registers[0]);
+void SungrowInverter::_learnIllegalGaps(const std::vector<RegisterRange>& failedBlocks, const std::vector<RegisterSpan>& wanted) {
+    // When every wanted register of a rejected block reads fine on its own, the
+    // illegal address is in a gap; keep future plans from bridging those gaps
+    auto sortedSpans = wanted;
+    bool hasLearned = false;
+    std::sort(sortedSpans.begin(), sortedSpans.end(), [](const RegisterSpan& a, const RegisterSpan& b) {
+        return a.address < b.address;
+    });
+    
+    for (const auto& block : failedBlocks) {
+        uint32_t cursor = block.startAddr;
+        uint32_t blockEnd = static_cast<uint32_t>(block.startAddr) + block.count;
+        std::vector<RegisterRange> gaps;
+        bool isSpanMissing = false;
+        
+        for (const auto& span : sortedSpans) {
+            if (span.functionCode != block.functionCode || span.address < block.startAddr || span.address >= blockEnd) {
+                continue;
+            }
+            if (!_registerImage.contains(span.functionCode, span.address, span.count)) {
+                isSpanMissing = true;
+            }
+            if (span.address > cursor) {
+                gaps.push_back({static_cast<uint16_t>(cursor), static_cast<uint16_t>(span.address - cursor), block.functionCode});
+            }
+            cursor = std::max<uint32_t>(cursor, static_cast<uint32_t>(span.address) + span.count);
         }
         
-        // Temperature, voltage, and work state are now read in _readPowerData() for efficiency
-        return true;
+        if (isSpanMissing) {
+            continue;
+        }
+        for (const auto& gap : gaps) {
+            std::cout << "Read plan: not bridging registers " << gap.startAddr << "-" << (gap.startAddr + gap.count - 1)
+                      << " (Illegal Data Address)" << std::endl;
+            _planCompiler.addIllegalRange(gap);
+            hasLearned = true;
+        }
     }
-    catch (const std::exception& e) {
-        std::cerr << "System status read failed: " << e.what() << std::endl;
-        return false;
+    
+    if (hasLearned) {
+        _storeIdentity();
+    }
+}
+
+void SungrowInverter::_decodeRegisters() {
+    // Only the groups polled this tick are in the register image; fields
+    // of the other groups keep their last decoded value
+    for (auto group : {register_group::POWER, register_group::DAILY_ENERGY, register_group::LIFETIME_TOTALS}) {
+        _scrapedGroups.set(static_cast<size_t>(group), RegisterMap::decode(group, _registerImage, _latestData));
+    }
+    
+    if (_registerImage.contains(RegisterMap::INPUT_REGISTERS, RegisterAddresses::WORK_STATE_1, 1)) {
+        _latestData.workState1 = _getWorkStateString(_latestData.workStateCode);
     }
 }
 
@@ -193,6 +426,32 @@ const InverterData& SungrowInverter::getLatestData() const {
     return _latestData;
 }
 
+InverterSnapshot SungrowInverter::getSnapshot() const {
+    return _snapshot.read();
+}
+
+const SnapshotPublisher& SungrowInverter::getSnapshotPublisher() const {
+    return _snapshot;
+}
+
+std::chrono::microseconds SungrowInverter::getLastScrapeLatency() const {
+    return _lastScrapeLatency;
+}
+
+RegisterGroupMask SungrowInverter::getScrapedGroups() const {
+    return _scrapedGroups;
+}
+
+ClientStatistics SungrowInverter::getClientStatistics() const {
+    ClientStatistics statistics = _client->getStatistics();
+    statistics.scrapeFailures = _scrapeFailures;
+    return statistics;
+}
+
+const LatencyStatistics& SungrowInverter::getLatencyStatistics() const {
+    return _client->getLatencyStatistics();
+}
+
 void SungrowInverter::printPowerConsumptionStatus() const {
     std::cout << "\n" << std::string(80, '=') << std::endl;
     std::cout << "SG8K-D INVERTER POWER CONSUMPTION STATUS" << std::endl;
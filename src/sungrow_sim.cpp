@@ -0,0 +1,109 @@
+#include "inverter_simulator.hpp"
+#include "trace.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <csignal>
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --bind <ip>        Address to listen on (default: 127.0.0.1)\n";
+    std::cout << "  --port <port>      Port to listen on (default: 1502)\n";
+    std::cout << "  --threads <n>      Worker threads (default: 2)\n";
+    std::cout << "  --image <file>     Register image, lines of \"<input|holding> <address> <value>\"\n";
+    std::cout << "                     applied over the built-in SG8K-D image\n";
+    std::cout << "  --delay <ms>       Processing delay per request (default: 0)\n";
+    std::cout << "  --no-encryption    Refuse the key exchange and serve plain Modbus\n";
+    std::cout << "  --trace <level>    off, info, debug or frame (default: info)\n";
+    std::cout << "  --help             Show this help message\n";
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::string bindAddress = "127.0.0.1";
+    uint16_t port = 1502;
+    size_t threadCount = 2;
+    std::string imagePath;
+    int delayMs = 0;
+    bool isEncryptionEnabled = true;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "--bind" && i + 1 < argc) {
+            bindAddress = argv[++i];
+        }
+        else if (arg == "--port" && i + 1 < argc) {
+            port = std::stoi(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threadCount = std::max<size_t>(std::stoul(argv[++i]), 1);
+        }
+        else if (arg == "--image" && i + 1 < argc) {
+            imagePath = argv[++i];
+        }
+        else if (arg == "--delay" && i + 1 < argc) {
+            delayMs = std::stoi(argv[++i]);
+        }
+        else if (arg == "--no-encryption") {
+            isEncryptionEnabled = false;
+        }
+        else if (arg == "--trace" && i + 1 < argc) {
+            trace_level level;
+            if (!Trace::parseLevel(argv[++i], level)) {
+                std::cerr << "Unknown trace level: " << argv[i] << std::endl;
+                return 1;
+            }
+            Trace::setLevel(level);
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    auto registers = std::make_shared<SimulatedRegisterMap>(SimulatedRegisterMap::createDefault());
+    if (!imagePath.empty() && !registers->loadFile(imagePath)) {
+        return 1;
+    }
+
+    try {
+        boost::asio::io_context ioContext;
+        InverterSimulator simulator(ioContext, bindAddress, port, registers);
+        simulator.setResponseDelay(std::chrono::milliseconds(delayMs));
+        simulator.setEncryptionEnabled(isEncryptionEnabled);
+        simulator.start();
+
+        boost::asio::signal_set signals(ioContext, SIGINT, SIGTERM);
+        signals.async_wait([&](const boost::system::error_code&, int) {
+            simulator.stop();
+            ioContext.stop();
+        });
+
+        std::cout << "Simulated SG8K-D listening on " << bindAddress << ":" << simulator.getPort()
+                  << (isEncryptionEnabled ? " (encrypted)" : " (plain Modbus)") << " with " << threadCount << " threads" << std::endl;
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; i++) {
+            threads.emplace_back([&] { ioContext.run(); });
+        }
+        ioContext.run();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::cout << "Served " << simulator.getRequestCount() << " requests over " << simulator.getConnectionCount() << " connections" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "FATAL ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "trace.hpp"
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace {
+    FrameTraceRing frameRing;
+    std::mutex writeMutex;
+}
+
+namespace Trace {
+    std::atomic<int> currentLevel{static_cast<int>(trace_level::INFO)};
+
+    trace_level getLevel() {
+        return static_cast<trace_level>(currentLevel.load(std::memory_order_relaxed));
+    }
+
+    void setLevel(trace_level level) {
+        currentLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    bool parseLevel(const std::string& name, trace_level& level) {
+        if (name == "off") {
+            level = trace_level::OFF;
+        } else if (name == "info") {
+            level = trace_level::INFO;
+        } else if (name == "debug") {
+            level = trace_level::DEBUG;
+        } else if (name == "frame") {
+            level = trace_level::FRAME;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void write(const std::string& line) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        std::cout << line << '\n';
+    }
+
+    void captureFrame(frame_direction direction, std::span<const uint8_t> frame) {
+        frameRing.capture(direction, frame);
+    }
+
+    void dumpFrames(std::ostream& output) {
+        frameRing.dump(output);
+    }
+}
+
+void FrameTraceRing::capture(frame_direction direction, std::span<const uint8_t> frame) {
+    uint64_t index = _nextIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = _slots[index % SLOT_COUNT];
+
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    slot.index = index;
+    slot.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    slot.direction = direction;
+    slot.size = static_cast<uint16_t>(frame.size());
+    slot.capturedSize = static_cast<uint16_t>(std::min(frame.size(), MAX_CAPTURE_SIZE));
+    std::copy_n(frame.begin(), slot.capturedSize, slot.bytes.begin());
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void FrameTraceRing::dump(std::ostream& output) const {
+    struct Capture {
+        uint64_t index;
+        int64_t timestampUs;
+        frame_direction direction;
+        uint16_t size;
+        std::vector<uint8_t> bytes;
+    };
+
+    std::vector<Capture> captures;
+    for (const auto& slot : _slots) {
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before == 0 || before % 2 != 0) {
+            continue;
+        }
+
+        Capture capture{slot.index, slot.timestampUs, slot.direction, slot.size,
+                        std::vector<uint8_t>(slot.bytes.begin(), slot.bytes.begin() + slot.capturedSize)};
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            captures.push_back(std::move(capture));
+        }
+    }
+
+    std::sort(captures.begin(), captures.end(), [](const Capture& a, const Capture& b) { return a.index < b.index; });
+
+    output << "--- FRAME TRACE (" << captures.size() << " frames) ---\n";
+    for (const auto& capture : captures) {
+        output << std::dec << capture.timestampUs << (capture.direction == frame_direction::TX ? " TX " : " RX ")
+               << capture.size << ":" << std::hex << std::setfill('0');
+        for (auto byte : capture.bytes) {
+            output << ' ' << std::setw(2) << static_cast<int>(byte);
+        }
+        output << std::dec << std::setfill(' ') << '\n';
+    }
+    output.flush();
+}
@@ -0,0 +1,750 @@
+#include "read_plan.hpp"
+#include "poll_scheduler.hpp"
+#include "sample_store.hpp"
+#include "rollup_engine.hpp"
+#include "change_detector.hpp"
+#include "frame_capture.hpp"
+#include "latency_histogram.hpp"
+#include "register_map.hpp"
+#include "sungrow_client.hpp"
+#include "inverter_simulator.hpp"
+#include "frame_buffer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// Round-trip and edge-case checks for the components that need no inverter.
+// Registered with CTest; exits non-zero if any check fails.
+
+namespace {
+    constexpr uint8_t INPUT_REGISTERS = 0x04;
+
+    int checkCount = 0;
+    int failureCount = 0;
+
+    void check(bool condition, const char* expression, int line) {
+        ++checkCount;
+        if (!condition) {
+            ++failureCount;
+            std::cerr << "unit_tests.cpp:" << line << ": check failed: " << expression << std::endl;
+        }
+    }
+
+    bool isNear(double value, double expected) {
+        return std::fabs(value - expected) < 1e-9;
+    }
+
+    void setTimeZone(const char* zone) {
+        ::setenv("TZ", zone, 1);
+        ::tzset();
+    }
+
+    // Fresh directory per test, removed again at the end of the run
+    std::filesystem::path makeScratchDirectory(const std::string& name) {
+        auto path = std::filesystem::temp_directory_path() / ("sungrow_unit_tests_" + std::to_string(::getpid())) / name;
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+        return path;
+    }
+
+    std::chrono::system_clock::time_point fromUnixSeconds(int64_t seconds) {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+    }
+
+    constexpr int64_t MARCH_10_2026_NOON_UTC = 1773144000;
+
+    // Every loopback register holds a value derived from its address, so a
+    // response matched to the wrong request shows in the data
+    constexpr uint16_t LOOPBACK_FIRST = 5000;
+    constexpr uint16_t LOOPBACK_REGISTERS = 2500;
+
+    uint16_t getLoopbackValue(uint32_t address) {
+        return static_cast<uint16_t>(address * 7);
+    }
+
+    std::vector<ModbusReadRequest> makeLoopbackRequests(size_t count, uint16_t registerCount) {
+        std::vector<ModbusReadRequest> requests;
+        for (size_t i = 0; i < count; i++) {
+            requests.push_back({INPUT_REGISTERS, static_cast<uint16_t>(LOOPBACK_FIRST + i * registerCount), registerCount});
+        }
+        return requests;
+    }
+
+    bool hasLoopbackData(const std::vector<ModbusReadRequest>& requests, const std::vector<ModbusReadResult>& results) {
+        if (results.size() != requests.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < requests.size(); i++) {
+            const auto& registers = results[i].registers;
+            if (!results[i].success || registers.size() != requests[i].count) {
+                return false;
+            }
+            for (size_t j = 0; j < registers.size(); j++) {
+                if (registers[j] != getLoopbackValue(requests[i].address + j)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // sungrow_sim's simulator on an ephemeral loopback port, served by a
+    // thread of its own while the test drives a blocking client
+    class LoopbackInverter {
+    public:
+        LoopbackInverter() : _workGuard(_ioContext.get_executor()), _simulator(_ioContext, "127.0.0.1", 0, makeRegisters()) {
+            _simulator.start();
+            _thread = std::thread([this] { _ioContext.run(); });
+        }
+
+        ~LoopbackInverter() {
+            _simulator.stop();
+            _ioContext.stop();
+            _thread.join();
+        }
+
+        InverterSimulator& getSimulator() {
+            return _simulator;
+        }
+
+        // Null if the connect or key exchange failed
+        std::unique_ptr<SungrowTcpClient> connect() {
+            auto client = std::make_unique<SungrowTcpClient>("127.0.0.1", _simulator.getPort(), 1);
+            return client->connect() ? std::move(client) : nullptr;
+        }
+
+    private:
+        static std::shared_ptr<const SimulatedRegisterMap> makeRegisters() {
+            auto registers = std::make_shared<SimulatedRegisterMap>();
+            for (uint32_t address = LOOPBACK_FIRST; address < LOOPBACK_FIRST + LOOPBACK_REGISTERS; address++) {
+                registers->set(INPUT_REGISTERS, static_cast<uint16_t>(address), getLoopbackValue(address));
+            }
+            return registers;
+        }
+
+        boost::asio::io_context _ioContext;
+        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> _workGuard;
+        InverterSimulator _simulator;
+        std::thread _thread;
+    };
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+void testPipelinedReads() {
+    LoopbackInverter inverter;
+    auto client = inverter.connect();
+    CHECK(client != nullptr);
+    if (!client) {
+        return;
+    }
+
+    // The simulator holds each window of responses and sends it newest
+    // first, so only the transaction IDs put the results back in order
+    auto& simulator = inverter.getSimulator();
+    simulator.setReorderWindow(4);
+    client->setPipelineWindow(4);
+    std::vector<ModbusReadRequest> requests;
+    for (uint16_t i = 0; i < 8; i++) {
+        requests.push_back({INPUT_REGISTERS, static_cast<uint16_t>(LOOPBACK_FIRST + 40 * i), static_cast<uint16_t>(i + 1)});
+    }
+    uint64_t served = simulator.getRequestCount();
+    auto results = client->readPipelined(requests);
+    CHECK(hasLoopbackData(requests, results));
+    CHECK(simulator.getRequestCount() == served + requests.size());
+    CHECK(client->getStatistics().responses == requests.size() && client->getStatistics().retries == 0);
+
+    // A window of one answers in order without the reorder hold
+    simulator.setReorderWindow(0);
+    client->setPipelineWindow(1);
+    requests = makeLoopbackRequests(3, 2);
+    CHECK(hasLoopbackData(requests, client->readPipelined(requests)));
+}
+
+void testFrameBuffer() {
+    constexpr size_t CAPACITY = FrameBuffer::CAPACITY;
+    FrameBuffer buffer;
+    size_t written = 0;
+    auto append = [&](size_t count) {
+        auto writable = buffer.getWritableSpan();
+        for (size_t i = 0; i < count && i < writable.size(); i++) {
+            writable[i] = static_cast<uint8_t>(written + i);
+        }
+        buffer.commit(count);
+        written += count;
+    };
+
+    // A frame that starts ten bytes before the end of the storage is
+    // written in two pieces and read back whole across the wraparound
+    append(CAPACITY - 6);
+    buffer.consume(CAPACITY - 10);
+    CHECK(buffer.getWritableSpan().size() == 6);
+    append(6);
+    CHECK(buffer.getWritableSpan().size() == CAPACITY - 10);
+    append(10);
+    CHECK(buffer.getSize() == 20 && buffer.peek(12) == static_cast<uint8_t>(CAPACITY - 10 + 12));
+    std::vector<uint8_t> frame(20);
+    buffer.copyOut(frame.data(), frame.size());
+    bool isContiguous = true;
+    for (size_t i = 0; i < frame.size(); i++) {
+        isContiguous = isContiguous && frame[i] == static_cast<uint8_t>(CAPACITY - 10 + i);
+    }
+    CHECK(isContiguous);
+
+    // Emptied, it starts over at the front; full, it refuses more
+    buffer.consume(frame.size());
+    CHECK(buffer.isEmpty() && buffer.getWritableSpan().size() == CAPACITY);
+    append(CAPACITY);
+    CHECK(buffer.getWritableSpan().empty() && buffer.getFreeSpace() == 0);
+    bool isOverflowRejected = false;
+    try {
+        buffer.commit(1);
+    }
+    catch (const std::length_error&) {
+        isOverflowRejected = true;
+    }
+    CHECK(isOverflowRejected);
+}
+
+void testSplitResponses() {
+    LoopbackInverter inverter;
+    auto client = inverter.connect();
+    CHECK(client != nullptr);
+    if (!client) {
+        return;
+    }
+    auto& simulator = inverter.getSimulator();
+    client->setPipelineWindow(4);
+
+    // Three-byte pieces split the crypto header itself across reads
+    simulator.setWriteChunkSize(3);
+    auto requests = makeLoopbackRequests(4, 5);
+    CHECK(hasLoopbackData(requests, client->readPipelined(requests)));
+
+    // Full-size responses in odd pieces, so reads end mid-frame and start
+    // with the rest of one frame and the head of the next
+    simulator.setWriteChunkSize(61);
+    requests = makeLoopbackRequests(20, ReadPlanCompiler::MAX_BLOCK_REGISTERS);
+    CHECK(hasLoopbackData(requests, client->readPipelined(requests)));
+    CHECK(client->getStatistics().timeouts == 0 && client->getStatistics().retries == 0);
+}
+
+void testTimeoutReplay() {
+    LoopbackInverter inverter;
+    auto client = inverter.connect();
+    CHECK(client != nullptr);
+    if (!client) {
+        return;
+    }
+
+    // The second of four requests is never answered. The others complete,
+    // the client times out on it, reconnects and replays only that one.
+    auto& simulator = inverter.getSimulator();
+    client->setPipelineWindow(4);
+    client->setResponseTimeout(std::chrono::milliseconds(200));
+    client->setMaxRetries(2);
+    simulator.dropResponse(simulator.getRequestCount() + 2);
+    auto requests = makeLoopbackRequests(4, 3);
+    CHECK(hasLoopbackData(requests, client->readPipelined(requests)));
+
+    const auto& statistics = client->getStatistics();
+    CHECK(statistics.timeouts == 1 && statistics.retries == 1 && statistics.reconnects == 1);
+    CHECK(statistics.requests == requests.size() + 1);
+    CHECK(simulator.getConnectionCount() == 2 && client->isConnected());
+
+    // Out of retries, the unanswered request fails and the rest still succeed
+    client->setMaxRetries(0);
+    simulator.dropResponse(simulator.getRequestCount() + 3);
+    auto results = client->readPipelined(requests);
+    CHECK(results.size() == 4 && results[0].success && results[1].success && results[3].success);
+    CHECK(results.size() == 4 && !results[2].success && !results[2].error.empty());
+}
+
+void testBatchDecryptFailure() {
+    LoopbackInverter inverter;
+    auto client = inverter.connect();
+    CHECK(client != nullptr);
+    if (!client) {
+        return;
+    }
+
+    // The simulator queues the answers to the last three requests behind
+    // the first write, so they arrive as one run with the third one
+    // unframeable. The frame before it is still decoded, then the
+    // connection is dropped and only the third and fourth are replayed.
+    auto& simulator = inverter.getSimulator();
+    client->setPipelineWindow(4);
+    client->setMaxRetries(2);
+    simulator.corruptResponse(simulator.getRequestCount() + 3);
+    auto requests = makeLoopbackRequests(4, 6);
+    CHECK(hasLoopbackData(requests, client->readPipelined(requests)));
+
+    const auto& statistics = client->getStatistics();
+    CHECK(statistics.reconnects == 1 && statistics.timeouts == 0);
+    CHECK(statistics.requests == requests.size() + 2 && statistics.responses == requests.size());
+
+    // Nothing of the dropped connection's batch leaks into the next read
+    CHECK(hasLoopbackData(requests, client->readPipelined(requests)));
+}
+
+void testReadPlanCompiler() {
+    constexpr uint8_t FC = INPUT_REGISTERS;
+    ReadPlanCompiler compiler;
+
+    // Gaps up to maxGap are read through; overlaps merge
+    auto blocks = compiler.compile({{FC, 5003, 1}, {FC, 5000, 2}, {FC, 5002, 3}});
+    CHECK(blocks.size() == 1);
+    CHECK(blocks[0].startAddr == 5000 && blocks[0].count == 5 && blocks[0].functionCode == FC);
+
+    compiler.setMaxGap(0);
+    blocks = compiler.compile({{FC, 5000, 2}, {FC, 5002, 1}, {FC, 5004, 1}});
+    CHECK(blocks.size() == 2);
+    CHECK(blocks[0].count == 3 && blocks[1].startAddr == 5004);
+
+    // A gap holding an illegal address is never read through
+    compiler.setMaxGap(ReadPlanCompiler::DEFAULT_MAX_GAP);
+    compiler.addIllegalRange({5002, 1, FC});
+    compiler.addIllegalRange({5002, 1, FC});
+    CHECK(compiler.getIllegalRanges().size() == 1);
+    CHECK(compiler.isIllegal(FC, 5002) && !compiler.isIllegal(FC, 5003) && !compiler.isIllegal(0x03, 5002));
+    blocks = compiler.compile({{FC, 5000, 1}, {FC, 5005, 1}});
+    CHECK(blocks.size() == 2);
+    blocks = compiler.compile({{FC, 5003, 1}, {FC, 5005, 1}});
+    CHECK(blocks.size() == 1 && blocks[0].count == 3);
+
+    // Blocks never exceed the Modbus limit of 125 registers
+    ReadPlanCompiler wide(200);
+    blocks = wide.compile({{FC, 1000, 1}, {FC, 1124, 1}});
+    CHECK(blocks.size() == 1 && blocks[0].count == ReadPlanCompiler::MAX_BLOCK_REGISTERS);
+    blocks = wide.compile({{FC, 1000, 1}, {FC, 1125, 1}});
+    CHECK(blocks.size() == 2);
+    blocks = wide.compile({{FC, 100, 300}});
+    CHECK(blocks.size() == 3);
+    CHECK(blocks[0].count == 125 && blocks[1].startAddr == 225 && blocks[2].startAddr == 350 && blocks[2].count == 50);
+
+    // An overlapping span that would push the block past 125 registers starts
+    // its own block at its own address rather than being split
+    blocks = wide.compile({{FC, 5000, 124}, {FC, 5122, 4}});
+    CHECK(blocks.size() == 2 && blocks[0].count == 124);
+    CHECK(blocks.size() == 2 && blocks[1].startAddr == 5122 && blocks[1].count == 4);
+    RegisterImage image;
+    for (const auto& block : blocks) {
+        image.store(FC, block.startAddr, std::vector<uint16_t>(block.count, block.startAddr));
+    }
+    CHECK(image.contains(FC, 5000, 124) && image.contains(FC, 5122, 4));
+    CHECK(image.get(FC, 5123) == 5122 && image.get(FC, 5121) == 5000);
+
+    // A span split across blocks is found again in the adjacent blocks
+    image.clear();
+    image.store(FC, 100, std::vector<uint16_t>(125, 0));
+    CHECK(!image.contains(FC, 100, 300));
+    image.store(FC, 225, std::vector<uint16_t>(125, 0));
+    image.store(FC, 350, std::vector<uint16_t>(50, 0));
+    CHECK(image.contains(FC, 100, 300) && !image.contains(FC, 100, 301) && !image.contains(0x03, 100, 1));
+
+    // Function codes are never mixed in one block
+    blocks = compiler.compile({{0x03, 5000, 1}, {FC, 5001, 1}});
+    CHECK(blocks.size() == 2 && blocks[0].functionCode == 0x03);
+
+    CHECK(compiler.compile({}).empty());
+    auto requests = ReadPlanCompiler::toRequests({{5000, 4, FC}});
+    CHECK(requests.size() == 1 && requests[0].address == 5000 && requests[0].count == 4);
+}
+
+void testPollScheduler() {
+    using std::chrono::milliseconds;
+    auto epoch = PollScheduler::clock::time_point{} + std::chrono::hours(1);
+    PollScheduler scheduler(epoch);
+    scheduler.addGroup({register_group::POWER, {}, milliseconds(1000), milliseconds(0)});
+    scheduler.addGroup({register_group::DAILY_ENERGY, {}, milliseconds(5000), milliseconds(250)});
+    scheduler.addGroup({register_group::LIFETIME_TOTALS, {}, milliseconds(0), milliseconds(0)});
+
+    CHECK((scheduler.collectDue(epoch) == std::vector<size_t>{0, 2}));
+    CHECK(scheduler.collectDue(epoch + milliseconds(100)).empty());
+    CHECK(scheduler.getNextDeadline() == epoch + milliseconds(250));
+    CHECK((scheduler.collectDue(epoch + milliseconds(250)) == std::vector<size_t>{1}));
+
+    // A late tick skips the missed deadlines without shifting later ones
+    CHECK((scheduler.collectDue(epoch + milliseconds(3500)) == std::vector<size_t>{0}));
+    CHECK(scheduler.getNextDeadline() == epoch + milliseconds(4000));
+    CHECK((scheduler.collectDue(epoch + milliseconds(4010)) == std::vector<size_t>{0}));
+    CHECK((scheduler.collectDue(epoch + milliseconds(5250)) == std::vector<size_t>{0, 1}));
+    CHECK(scheduler.getNextDeadline() == epoch + milliseconds(6000));
+
+    scheduler.addGroup({register_group::LIFETIME_TOTALS, {{INPUT_REGISTERS, 5144, 2}}, milliseconds(60000), milliseconds(0)});
+    auto spans = scheduler.mergeSpans({3, 3});
+    CHECK(spans.size() == 2 && spans[0].address == 5144);
+}
+
+void testRegisterMapDecode() {
+    constexpr uint16_t FIRST = 5003;
+    auto setWord = [](std::vector<uint16_t>& block, uint16_t address, uint16_t word) { block[address - FIRST] = word; };
+
+    // Each register type next to its sentinels; 0x7FFF is only reserved for S16
+    std::vector<uint16_t> block(5114 - FIRST, 0);
+    setWord(block, 5003, 0x0001);
+    setWord(block, 5004, 0x0002);
+    setWord(block, 5008, 0xFF80);
+    setWord(block, 5019, 0xFFFF);
+    setWord(block, 5092, 0xFFFF);
+    setWord(block, 5093, 0xFFFF);
+    setWord(block, 5097, 0x0010);
+    setWord(block, 5100, 0x7FFF);
+    setWord(block, 5101, 0xFFFF);
+    setWord(block, 5113, 0x7FFF);
+    RegisterImage image;
+    image.store(INPUT_REGISTERS, FIRST, block);
+
+    InverterData data;
+    data.phaseAVoltage = 230.0;
+    CHECK(RegisterMap::decode(register_group::DAILY_ENERGY, image, data));
+    CHECK(isNear(data.dailyPowerYields, 65538 * 0.1) && isNear(data.internalTemperature, -12.8));
+    CHECK(data.phaseAVoltage == 0.0 && data.dailyExportEnergy == 0.0);
+    CHECK(isNear(data.dailyImportEnergy, 1.6) && isNear(data.dailyDirectConsumption, 0x7FFFFFFF * 0.1));
+    CHECK(data.dailyRunningTime == 0x7FFF);
+
+    // A group read only in part decodes what it has and keeps the rest
+    image.clear();
+    image.store(INPUT_REGISTERS, 5031, {0x0001, 0x86A0});
+    data.workStateCode = 0x8100;
+    CHECK(!RegisterMap::decode(register_group::POWER, image, data));
+    CHECK(data.totalActivePower == 100000 && data.workStateCode == 0x8100);
+    image.store(INPUT_REGISTERS, 5038, {0x0000});
+    CHECK(RegisterMap::decode(register_group::POWER, image, data) && data.workStateCode == 0);
+}
+
+void testSampleStore() {
+    auto directory = makeScratchDirectory("samples");
+
+    // Columns of StoredSample::values, which leave out "time"
+    const auto& names = SampleStore::getColumnNames();
+    auto getColumn = [&names](std::string_view name) {
+        return static_cast<size_t>(std::find(names.begin(), names.end(), name) - names.begin()) - 1;
+    };
+
+    // Irregular intervals exercise the delta-of-delta time column, negative
+    // temperatures the zigzag encoding and repeats the zero runs
+    const std::vector<int64_t> OFFSETS_MS = {0, 1000, 2000, 3000, 4500, 4600, 9000, 9000, 60000};
+    const std::vector<double> TEMPERATURES = {21.5, 21.5, 21.5, -3.2, -12.8, 0.0, 0.1, 0.1, 45.0};
+    std::vector<InverterData> written;
+    {
+        SampleStore store(directory.string());
+        for (size_t i = 0; i < OFFSETS_MS.size(); i++) {
+            InverterData data;
+            data.totalActivePower = static_cast<uint32_t>(i % 3 == 0 ? 0 : 4000000 + i * 17);
+            data.internalTemperature = TEMPERATURES[i];
+            data.phaseAVoltage = 230.0 + static_cast<double>(i) / 10.0;
+            data.workStateCode = 0x1300;
+            data.totalPowerYields = 123456.7;
+            CHECK(store.append(data, fromUnixSeconds(MARCH_10_2026_NOON_UTC) + std::chrono::milliseconds(OFFSETS_MS[i])));
+            written.push_back(data);
+        }
+    }
+
+    auto samples = SampleStore::readDay(directory.string(), "2026-03-10");
+    CHECK(samples.size() == OFFSETS_MS.size());
+    for (size_t i = 0; i < samples.size() && i < written.size(); i++) {
+        CHECK(samples[i].time == fromUnixSeconds(MARCH_10_2026_NOON_UTC) + std::chrono::milliseconds(OFFSETS_MS[i]));
+        std::vector<double> expected;
+        RegisterMap::forEachNumericField([&](const auto& field) {
+            expected.push_back(static_cast<double>(written[i].*field.target));
+        });
+        CHECK(samples[i].values.size() == expected.size());
+        for (size_t column = 0; column < expected.size() && column < samples[i].values.size(); column++) {
+            CHECK(isNear(samples[i].values[column], expected[column]));
+        }
+    }
+    if (samples.size() > 4) {
+        CHECK(isNear(samples[4].values[getColumn("internal_temperature")], -12.8));
+        CHECK(isNear(samples[1].values[getColumn("total_active_power")], 4000017.0));
+    }
+
+    CHECK(names.front() == "time" && names.size() == RegisterMap::NUMERIC_FIELD_COUNT + 1);
+    CHECK(SampleStore::readDay(directory.string(), "2026-03-11").empty());
+}
+
+void testRollupEngine() {
+    auto directory = makeScratchDirectory("rollups");
+    RegisterGroupMask allGroups;
+    allGroups.set();
+    RegisterGroupMask powerOnly;
+    powerOnly.set(static_cast<size_t>(register_group::POWER));
+    auto start = fromUnixSeconds(MARCH_10_2026_NOON_UTC);
+
+    {
+        RollupEngine engine(directory.string(), {"total_active_power", "phase_a_voltage"});
+        InverterData data;
+        data.totalActivePower = 1000;
+        data.phaseAVoltage = 230.0;
+        engine.addSample(data, allGroups, start + std::chrono::seconds(30));
+        data.totalActivePower = 2000;
+        data.phaseAVoltage = 232.0;
+        engine.addSample(data, allGroups, start + std::chrono::seconds(90));
+
+        // A scrape that skipped the voltage's group must not count its stale value
+        data.totalActivePower = 3000;
+        data.phaseAVoltage = 999.0;
+        engine.addSample(data, powerOnly, start + std::chrono::seconds(100));
+
+        // The segment across 12:01:00 is split at the boundary, at 1500 W
+        auto minutes = engine.query("total_active_power", rollup_resolution::MINUTE, start, start + std::chrono::minutes(2));
+        CHECK(minutes.size() == 2);
+        if (minutes.size() == 2) {
+            CHECK(minutes[0].start == MARCH_10_2026_NOON_UTC && minutes[0].sampleCount == 1);
+            CHECK(isNear(minutes[0].integral, (1000.0 + 1500.0) / 2.0 * 30.0 / 3600.0));
+            CHECK(minutes[1].start == MARCH_10_2026_NOON_UTC + 60 && minutes[1].sampleCount == 2);
+            CHECK(isNear(minutes[1].integral, (1500.0 + 2000.0) / 2.0 * 30.0 / 3600.0 + 2500.0 * 10.0 / 3600.0));
+        }
+
+        auto hours = engine.query("total_active_power", rollup_resolution::HOUR, start, start + std::chrono::hours(1));
+        CHECK(hours.size() == 1);
+        if (hours.size() == 1) {
+            CHECK(hours[0].sampleCount == 3 && hours[0].min == 1000.0 && hours[0].max == 3000.0);
+            CHECK(isNear(hours[0].getMean(), 2000.0));
+            CHECK(isNear(hours[0].integral, 1500.0 * 60.0 / 3600.0 + 2500.0 * 10.0 / 3600.0));
+        }
+
+        auto voltages = engine.query("phase_a_voltage", rollup_resolution::HOUR, start, start + std::chrono::hours(1));
+        CHECK(voltages.size() == 1 && voltages[0].sampleCount == 2 && voltages[0].max == 232.0);
+
+        // Samples further apart than MAX_INTEGRATION_GAP are not integrated across
+        data.totalActivePower = 4000;
+        engine.addSample(data, powerOnly, start + std::chrono::minutes(10));
+        auto late = engine.query("total_active_power", rollup_resolution::MINUTE, start + std::chrono::minutes(10), start + std::chrono::minutes(11));
+        CHECK(late.size() == 1 && late[0].integral == 0.0);
+
+        CHECK(engine.query("total_active_power", rollup_resolution::HOUR, start + std::chrono::hours(1), start + std::chrono::hours(2)).empty());
+    }
+
+    // Closed and open buckets are persisted and read back by a new engine
+    {
+        RollupEngine engine(directory.string(), {"total_active_power", "phase_a_voltage"});
+        auto minutes = engine.query("total_active_power", rollup_resolution::MINUTE, start, start + std::chrono::hours(1));
+        CHECK(minutes.size() == 3);
+        auto hours = engine.query("total_active_power", rollup_resolution::HOUR, start, start + std::chrono::hours(1));
+        CHECK(hours.size() == 1 && hours[0].sampleCount == 4 && hours[0].max == 4000.0);
+
+        // A restart within the open hour continues its record instead of adding one
+        InverterData data;
+        data.totalActivePower = 500;
+        engine.addSample(data, allGroups, start + std::chrono::minutes(20));
+    }
+    {
+        RollupEngine engine(directory.string(), {"total_active_power"});
+        auto hours = engine.query("total_active_power", rollup_resolution::HOUR, start, start + std::chrono::hours(1));
+        CHECK(hours.size() == 1 && hours[0].sampleCount == 5 && hours[0].min == 500.0);
+    }
+
+    bool isUnknownRejected = false;
+    try {
+        RollupEngine engine(directory.string(), {"no_such_field"});
+    } catch (const std::invalid_argument&) {
+        isUnknownRejected = true;
+    }
+    CHECK(isUnknownRejected);
+}
+
+// Days start at local midnight, which moves by an hour on DST changes
+void testRollupDaylightSaving() {
+    setTimeZone("Europe/Berlin");
+    std::time_t summer = static_cast<std::time_t>(MARCH_10_2026_NOON_UTC + 120 * 86400);
+    std::tm local{};
+    localtime_r(&summer, &local);
+    if (local.tm_isdst <= 0) {
+        std::cout << "Skipping the DST rollup check: Europe/Berlin is not installed" << std::endl;
+        setTimeZone("UTC");
+        return;
+    }
+
+    auto directory = makeScratchDirectory("rollups_dst");
+    RegisterGroupMask allGroups;
+    allGroups.set();
+    constexpr int64_t MARCH_29_2026_NOON_UTC = 1774785600;  // Clocks went forward at 01:00 UTC
+    {
+        RollupEngine engine(directory.string(), {"total_active_power"});
+        InverterData data;
+        engine.addSample(data, allGroups, fromUnixSeconds(MARCH_29_2026_NOON_UTC));
+        engine.addSample(data, allGroups, fromUnixSeconds(MARCH_29_2026_NOON_UTC + 86400));
+        auto days = engine.query("total_active_power", rollup_resolution::DAY, fromUnixSeconds(MARCH_29_2026_NOON_UTC - 86400),
+                                 fromUnixSeconds(MARCH_29_2026_NOON_UTC + 86400));
+        CHECK(days.size() == 2);
+        if (days.size() == 2) {
+            CHECK(days[0].start == MARCH_29_2026_NOON_UTC - 13 * 3600);  // 00:00 CET
+            CHECK(days[1].start - days[0].start == 23 * 3600);           // 00:00 CEST
+        }
+    }
+    setTimeZone("UTC");
+}
+
+void testChangeDetector() {
+    size_t powerIndex = RegisterMap::getNumericFieldIndex("total_active_power");
+    size_t voltageIndex = RegisterMap::getNumericFieldIndex("phase_a_voltage");
+    ChangeDetector detector(std::chrono::seconds(60));
+    CHECK(detector.getDeadband(voltageIndex) == 1.0 && detector.getDeadband(powerIndex) == 0.0);
+
+    InverterSnapshot snapshot;
+    snapshot.time = fromUnixSeconds(MARCH_10_2026_NOON_UTC);
+    snapshot.values[voltageIndex] = 230.0;
+    auto changes = detector.update(snapshot);
+    CHECK(changes.isKeyframe && changes.mask.all());
+
+    CHECK(detector.update(snapshot).mask.none());
+
+    // Drift within the deadband is held back until it adds up
+    snapshot.values[voltageIndex] = 230.6;
+    changes = detector.update(snapshot);
+    CHECK(!changes.isKeyframe && changes.mask.none());
+    snapshot.values[voltageIndex] = 231.2;
+    changes = detector.update(snapshot);
+    CHECK(changes.mask.count() == 1 && changes.mask.test(voltageIndex));
+
+    snapshot.values[powerIndex] = 1.0;
+    changes = detector.update(snapshot);
+    CHECK(changes.mask.count() == 1 && changes.mask.test(powerIndex));
+
+    detector.setDeadband("total_active_power", 50.0);
+    snapshot.values[powerIndex] = 51.0;
+    CHECK(detector.update(snapshot).mask.none());
+
+    snapshot.time += std::chrono::seconds(60);
+    changes = detector.update(snapshot);
+    CHECK(changes.isKeyframe && changes.mask.all());
+
+    bool isUnknownRejected = false;
+    try {
+        detector.setDeadband("serial_number", 1.0);
+    } catch (const std::invalid_argument&) {
+        isUnknownRejected = true;
+    }
+    CHECK(isUnknownRejected);
+}
+
+void testFrameCapture() {
+    auto directory = makeScratchDirectory("capture");
+    auto path = (directory / "frames.cap").string();
+    const std::vector<uint8_t> REQUEST = {0x68, 0x68, 0x00, 0x00, 0x11, 0x22};
+    const std::vector<uint8_t> RESPONSE = {0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, 0x04, 0x02, 0x12, 0x34};
+    {
+        FrameCaptureWriter writer(path);
+        writer.recordConnected();
+        writer.recordFrame(frame_direction::TX, REQUEST);
+        writer.recordFrame(frame_direction::RX, RESPONSE);
+        CHECK(writer.getRecordCount() == 3);
+    }
+
+    FrameCapture capture;
+    CHECK(capture.load(path));
+    CHECK(capture.records.size() == 3);
+    if (capture.records.size() == 3) {
+        CHECK(capture.records[0].type == capture_record::CONNECTED && capture.records[0].bytes.empty());
+        CHECK(capture.records[1].type == capture_record::TX && capture.records[1].bytes == REQUEST);
+        CHECK(capture.records[2].type == capture_record::RX && capture.records[2].bytes == RESPONSE);
+        CHECK(capture.records[1].offset <= capture.records[2].offset && capture.getDuration() == capture.records[2].offset);
+    }
+    auto age = std::chrono::system_clock::now() - capture.startTime;
+    CHECK(age >= std::chrono::seconds(0) && age < std::chrono::minutes(1));
+
+    // A record cut short by a crash ends the capture
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    FrameCapture truncated;
+    CHECK(truncated.load(path));
+    CHECK(truncated.records.size() == 2);
+
+    FrameCapture missing;
+    CHECK(!missing.load((directory / "missing.cap").string()));
+    std::ofstream((directory / "text.cap").string()) << "not a capture file";
+    CHECK(!missing.load((directory / "text.cap").string()));
+    CHECK(missing.records.empty() && missing.getDuration() == std::chrono::microseconds(0));
+
+    bool isUnwritableRejected = false;
+    try {
+        FrameCaptureWriter writer((directory / "no_such_directory" / "frames.cap").string());
+    } catch (const std::runtime_error&) {
+        isUnwritableRejected = true;
+    }
+    CHECK(isUnwritableRejected);
+}
+
+void testLatencyHistogram() {
+    using std::chrono::nanoseconds;
+    LatencyHistogram histogram;
+    CHECK(histogram.getCount() == 0 && histogram.getPercentile(50.0) == nanoseconds(0));
+
+    // Values below the first power of two past the sub-buckets are exact
+    for (int i = 1; i <= 60; i++) {
+        histogram.record(nanoseconds(i));
+    }
+    CHECK(histogram.getCount() == 60 && histogram.getMax() == nanoseconds(60));
+    CHECK(histogram.getPercentile(50.0) == nanoseconds(30));
+    CHECK(histogram.getPercentile(0.0) == nanoseconds(1));
+    CHECK(histogram.getPercentile(100.0) == nanoseconds(60));
+    CHECK(histogram.getPercentile(150.0) == nanoseconds(60));
+
+    // Larger values keep about two significant digits and never exceed the max
+    histogram.clear();
+    CHECK(histogram.getCount() == 0 && histogram.getMax() == nanoseconds(0));
+    histogram.record(nanoseconds(1000000));
+    histogram.record(nanoseconds(2000000));
+    histogram.record(nanoseconds(3000000));
+    auto median = histogram.getPercentile(50.0).count();
+    CHECK(median >= 2000000 && median <= 2000000 * 1.016);
+    CHECK(histogram.getPercentile(99.0) == nanoseconds(3000000));
+
+    // Negative durations count as zero, huge ones are clamped
+    LatencyHistogram clamped;
+    clamped.record(nanoseconds(-5));
+    CHECK(clamped.getPercentile(100.0) == nanoseconds(0));
+    clamped.record(std::chrono::hours(1));
+    CHECK(clamped.getMax() > std::chrono::seconds(68) && clamped.getMax() < std::chrono::seconds(140));
+    CHECK(clamped.getPercentile(100.0) == clamped.getMax());
+
+    histogram.merge(clamped);
+    CHECK(histogram.getCount() == 5 && histogram.getMax() == clamped.getMax());
+    CHECK(histogram.getPercentile(20.0) == nanoseconds(0));
+
+    PhaseDurations durations{};
+    durations[static_cast<size_t>(latency_phase::TOTAL)] = std::chrono::milliseconds(12);
+    LatencyStatistics statistics;
+    statistics.record(0x04, 5000, 38, durations);
+    statistics.record(0x04, 5000, 38, durations);
+    statistics.merge(statistics);
+    CHECK(statistics.getByFunctionCode().at(0x04).get(latency_phase::TOTAL).getCount() == 4);
+    CHECK(statistics.getByBlock().size() == 1);
+}
+
+int main() {
+    // Buckets and day directories follow local time
+    setTimeZone("UTC");
+
+    testPipelinedReads();
+    testFrameBuffer();
+    testSplitResponses();
+    testTimeoutReplay();
+    testBatchDecryptFailure();
+    testReadPlanCompiler();
+    testPollScheduler();
+    testRegisterMapDecode();
+    testSampleStore();
+    testRollupEngine();
+    testRollupDaylightSaving();
+    testChangeDetector();
+    testFrameCapture();
+    testLatencyHistogram();
+
+    std::filesystem::remove_all(std::filesystem::temp_directory_path() / ("sungrow_unit_tests_" + std::to_string(::getpid())));
+
+    std::cout << checkCount - failureCount << " of " << checkCount << " checks passed" << std::endl;
+    return failureCount == 0 ? 0 : 1;
+}